@@ -0,0 +1,63 @@
+// 连接表在高频建连断连下的开销: 旧的 "name-ipPort#id" 字符串 + std::map, 新的 id + IdTable
+// 保持 kLive 个存活连接, 每次新建一个并关闭最旧的一个
+// usage: bench_conn_table [churn]
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "network/IdTable.h"
+#include "unix/Time.h"
+
+using namespace rnet;
+
+namespace {
+constexpr uint64_t kLive = 10000;
+
+void Report( const char* name, Unix::Timestamp start, uint64_t churn ) {
+  double seconds = Unix::TimeDifference( Unix::Timestamp::Now(), start );
+  printf( "%-12s %8.3f s %12.0f conn/s %8.1f ns/conn\n", name, seconds, static_cast< double >( churn ) / seconds, seconds * 1e9 / static_cast< double >( churn ) );
+}
+
+// 和原来的 TcpServer 一样, 名字在建连时格式化一次, 关闭时用连接保存的名字删除
+void StringMap( uint64_t churn ) {
+  const std::string                               prefix = "127.0.0.1:2007";
+  std::map< std::string, std::shared_ptr< int > > connections;
+  std::vector< std::string >                      names( kLive );
+  std::shared_ptr< int >                          conn  = std::make_shared< int >( 0 );
+  Unix::Timestamp                                 start = Unix::Timestamp::Now();
+  for ( uint64_t id = 1; id <= churn; ++id ) {
+    std::string& name = names[ id % kLive ];
+    if ( id > kLive ) {
+      connections.erase( name );
+    }
+    char buf[ 64 ];
+    snprintf( buf, sizeof buf, "-%s#%" PRIu64, prefix.c_str(), id );
+    name                = "EchoServer" + std::string( buf );
+    connections[ name ] = conn;
+  }
+  Report( "string map", start, churn );
+}
+
+void IdTableChurn( uint64_t churn ) {
+  network::IdTable< std::shared_ptr< int > > connections;
+  std::shared_ptr< int >                     conn  = std::make_shared< int >( 0 );
+  Unix::Timestamp                            start = Unix::Timestamp::Now();
+  for ( uint64_t id = 1; id <= churn; ++id ) {
+    connections.Insert( id, conn );
+    if ( id > kLive ) {
+      connections.Erase( id - kLive );
+    }
+  }
+  Report( "id table", start, churn );
+}
+}  // namespace
+
+int main( int argc, char* argv[] ) {
+  uint64_t churn = argc > 1 ? strtoull( argv[ 1 ], nullptr, 10 ) : 2000000;
+  StringMap( churn );
+  IdTableChurn( churn );
+}
@@ -0,0 +1,109 @@
+// TcpServer 的建连断连和小消息回显开销, 服务端和客户端在同一进程里
+// churn: 每次新建连接, 发 1 字节, 等回显, 关闭
+// echo:  一个连接上反复发送 16 字节并等待回显
+// usage: bench_echo [ioThreads] [churn] [echo] [perloop] [spinUs]
+// perloop 非 0 时使用 kReusePortPerLoop, 连接在 io loop 中 accept 和释放
+// spinUs 非 0 时 io loop 开启忙轮询
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "log/Logger.h"
+#include "network/EventLoop.h"
+#include "network/LoopThreadPool.h"
+#include "network/NetAddress.h"
+#include "network/TcpConnection.h"
+#include "network/TcpServer.h"
+#include "unix/Time.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+namespace {
+constexpr uint16_t kPort = 24999;
+
+int ConnectLoopback() {
+  int fd = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  struct sockaddr_in addr;
+  MemZero( &addr, sizeof addr );
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons( kPort );
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  if ( ::connect( fd, reinterpret_cast< struct sockaddr* >( &addr ), sizeof addr ) < 0 ) {
+    perror( "connect" );
+    abort();
+  }
+  int one = 1;
+  ::setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one );
+  return fd;
+}
+
+void RoundTrip( int fd, char* buf, size_t len ) {
+  if ( ::write( fd, buf, len ) != static_cast< ssize_t >( len ) ) {
+    perror( "write" );
+    abort();
+  }
+  size_t got = 0;
+  while ( got < len ) {
+    ssize_t n = ::read( fd, buf + got, len - got );
+    if ( n <= 0 ) {
+      perror( "read" );
+      abort();
+    }
+    got += static_cast< size_t >( n );
+  }
+}
+
+void Report( const char* name, Unix::Timestamp start, int count ) {
+  double seconds = Unix::TimeDifference( Unix::Timestamp::Now(), start );
+  printf( "%-6s %8.3f s %10.0f op/s %8.2f us/op\n", name, seconds, count / seconds, seconds * 1e6 / count );
+}
+}  // namespace
+
+int main( int argc, char* argv[] ) {
+  int  ioThreads = argc > 1 ? atoi( argv[ 1 ] ) : 1;
+  int  churn     = argc > 2 ? atoi( argv[ 2 ] ) : 20000;
+  int  echo      = argc > 3 ? atoi( argv[ 3 ] ) : 200000;
+  bool perLoop   = argc > 4 && atoi( argv[ 4 ] ) != 0;
+  int  spinUs    = argc > 5 ? atoi( argv[ 5 ] ) : 0;
+  log::Logger::SetLogLevel( log::Logger::warn );
+
+  EventLoop loop;
+  TcpServer server( &loop, InetAddress( kPort, true ), "bench", perLoop ? TcpServer::kReusePortPerLoop : TcpServer::kNoReusePort );
+  server.SetThreadNum( ioThreads );
+  server.ThreadPool()->SetBusyPoll( spinUs );
+  server.SetMessageCallback( []( const TcpConnectionPtr& conn, file::Buffer* buf, Unix::Timestamp ) { conn->Send( buf ); } );
+  server.Start();
+
+  std::thread client( [ & ] {
+    char buf[ 16 ] = "0123456789abcde";
+    Unix::Timestamp start = Unix::Timestamp::Now();
+    for ( int i = 0; i < churn; ++i ) {
+      int fd = ConnectLoopback();
+      RoundTrip( fd, buf, 1 );
+      ::close( fd );
+    }
+    Report( "churn", start, churn );
+
+    int fd = ConnectLoopback();
+    start  = Unix::Timestamp::Now();
+    for ( int i = 0; i < echo; ++i ) {
+      RoundTrip( fd, buf, sizeof buf );
+    }
+    Report( "echo", start, echo );
+    ::close( fd );
+    loop.RunInLoop( [ &server ] {
+      for ( EventLoop* ioLoop : server.ThreadPool()->GetAllLoops() ) {
+        printf( "%s", ioLoop->StatsString().c_str() );
+      }
+    } );
+    loop.RunInLoop( [ &loop ] { loop.Quit(); } );
+  } );
+  loop.Loop();
+  client.join();
+}
@@ -0,0 +1,88 @@
+// cpu 密集任务的吞吐: 单线程, TaskPool 平铺提交, TaskPool 递归拆分
+// usage: bench_task_pool [threads]
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+#include "unix/TaskPool.h"
+#include "unix/Time.h"
+
+using namespace rnet;
+
+namespace {
+constexpr int kTasks      = 20000;
+constexpr int kWorkRounds = 20000;
+
+// 大约几十微秒的纯计算, 模拟一次 json 解析或一次签名
+uint64_t Work( uint64_t seed ) {
+  uint64_t x = seed;
+  for ( int i = 0; i < kWorkRounds; ++i ) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    x ^= x >> 33;
+  }
+  return x;
+}
+
+void Report( const char* name, Unix::Timestamp start, uint64_t checksum ) {
+  double seconds = Unix::TimeDifference( Unix::Timestamp::Now(), start );
+  printf( "%-12s %8.3f s %10.0f tasks/s  checksum %llx\n", name, seconds, kTasks / seconds, static_cast< unsigned long long >( checksum ) );
+}
+
+void Split( thread::TaskPool* pool, int begin, int end, std::atomic< uint64_t >* sum, thread::CountDownLatch* latch ) {
+  if ( end - begin <= 16 ) {
+    uint64_t local = 0;
+    for ( int i = begin; i < end; ++i ) {
+      local += Work( static_cast< uint64_t >( i ) );
+    }
+    sum->fetch_add( local );
+    latch->CountDown();
+    return;
+  }
+  int mid = begin + ( end - begin ) / 2;
+  pool->Submit( [ = ] { Split( pool, begin, mid, sum, latch ); } );
+  pool->Submit( [ = ] { Split( pool, mid, end, sum, latch ); } );
+}
+}  // namespace
+
+int main( int argc, char* argv[] ) {
+  int threads = argc > 1 ? atoi( argv[ 1 ] ) : 0;
+
+  Unix::Timestamp start    = Unix::Timestamp::Now();
+  uint64_t        checksum = 0;
+  for ( int i = 0; i < kTasks; ++i ) {
+    checksum += Work( static_cast< uint64_t >( i ) );
+  }
+  Report( "single", start, checksum );
+
+  thread::TaskPool pool;
+  pool.Start( threads );
+  printf( "pool threads %d\n", pool.NumThreads() );
+  {
+    std::atomic< uint64_t > sum{ 0 };
+    thread::CountDownLatch  latch( kTasks );
+    start = Unix::Timestamp::Now();
+    for ( int i = 0; i < kTasks; ++i ) {
+      pool.Submit( [ i, &sum, &latch ] {
+        sum.fetch_add( Work( static_cast< uint64_t >( i ) ) );
+        latch.CountDown();
+      } );
+    }
+    latch.Wait();
+    Report( "flat", start, sum.load() );
+  }
+  {
+    std::atomic< uint64_t > sum{ 0 };
+    // 叶子数: 把 [0, kTasks) 二分到不超过 16 个元素
+    int leaves = 1;
+    for ( int n = kTasks; n > 16; n = ( n + 1 ) / 2 ) {
+      leaves *= 2;
+    }
+    thread::CountDownLatch latch( leaves );
+    start = Unix::Timestamp::Now();
+    pool.Submit( [ & ] { Split( &pool, 0, kTasks, &sum, &latch ); } );
+    latch.Wait();
+    Report( "split", start, sum.load() );
+  }
+  printf( "steals %lld\n", static_cast< long long >( pool.Steals() ) );
+  pool.Stop();
+}
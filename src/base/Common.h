@@ -10,6 +10,8 @@
 namespace rnet {
 
 constexpr size_t kbSize = 1024;
+// 按缓存行对齐, 避免相邻对象伪共享
+constexpr size_t kCacheLineSize = 64;
 
 using SysTimep_t    = std::chrono::time_point< std::chrono::system_clock >;
 using SteadyTimep_t = std::chrono::time_point< std::chrono::steady_clock >;
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "log/LogFile.h"
+#include "log/RingLogFile.h"
 #include "unix/Time.h"
 
 using namespace rnet;
@@ -42,7 +43,19 @@ void AsyncLogging::Append( const char* logline, int len ) {
 void AsyncLogging::ThreadFunction() {
   assert( running_ == true );
   latch_.CountDown();
-  LogFile   output( basename, rollSize, false );
+  if ( ringCapacity_ > 0 ) {
+    RingLogFile output( basename + ".ring", ringCapacity_, false );
+    WriteLoop( output );
+  }
+  else {
+    // LogFile 自己的 flush 间隔保持默认的 3 秒, flushInterval 只控制后台线程等待缓冲的时间
+    LogFile output( basename, rollSize, false, 3, kbSize, archiver_.get() );
+    WriteLoop( output );
+  }
+}
+
+template < typename Output >
+void AsyncLogging::WriteLoop( Output& output ) {
   BufferPtr newBuffer1( new Buffer );
   BufferPtr newBuffer2( new Buffer );
   newBuffer1->Bzero();
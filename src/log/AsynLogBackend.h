@@ -10,6 +10,7 @@
 
 #include "base/Common.h"
 #include "file/Buffer.h"
+#include "log/LogArchiver.h"
 #include "unix/Thread.h"
 
 namespace rnet::log {
@@ -25,7 +26,23 @@ public:
 
   void Append( const char* logline, int len );
 
+  // 开启滚动文件的后台压缩与清理, 必须在 Start 之前调用
+  void SetArchiveOptions( const LogArchiver::Options& options ) {
+    assert( !running_ );
+    archiver_ = std::make_unique< LogArchiver >( basename, options );
+  }
+
+  // 输出到 basename.ring, 容量固定为 capacity 字节的 mmap 环形文件, 代替滚动的 LogFile
+  // 必须在 Start 之前调用, 与 SetArchiveOptions 互斥
+  void SetRingOutput( size_t capacity ) {
+    assert( !running_ && !archiver_ );
+    ringCapacity_ = capacity;
+  }
+
   void Start() {
+    if ( archiver_ ) {
+      archiver_->Start();
+    }
     running_ = true;
     thread_.Start();
     latch_.Wait();
@@ -35,25 +52,32 @@ public:
     running_ = false;
     cond_.notify_one();
     thread_.Join();
+    if ( archiver_ ) {
+      archiver_->Stop();
+    }
   }
 
 private:
   void ThreadFunction();
+  template < typename Output >
+  void WriteLoop( Output& output );
 
   using Buffer       = rnet::file::SizedBuffer< rnet::file::kLargeSize >;
   using BufferVector = std::vector< std::unique_ptr< Buffer > >;
   using BufferPtr    = BufferVector::value_type;
 
-  const int                    flushInterval;
-  std::atomic< bool >          running_{ false };
-  const std::string            basename;
-  const off_t                  rollSize;
-  rnet::thread::Thread         thread_;
-  rnet::thread::CountDownLatch latch_;
-  std::mutex                   mutex_;
-  std::condition_variable      cond_;
-  BufferPtr                    currentBuffer_;
-  BufferPtr                    nextBuffer_;
-  BufferVector                 buffers_;
+  const int                      flushInterval;
+  std::atomic< bool >            running_{ false };
+  const std::string              basename;
+  const off_t                    rollSize;
+  rnet::thread::Thread           thread_;
+  rnet::thread::CountDownLatch   latch_;
+  std::mutex                     mutex_;
+  std::condition_variable        cond_;
+  BufferPtr                      currentBuffer_;
+  BufferPtr                      nextBuffer_;
+  BufferVector                   buffers_;
+  std::unique_ptr< LogArchiver > archiver_;
+  size_t                         ringCapacity_ = 0;
 };
 }  // namespace rnet::log
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "log/LogArchiver.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+using namespace rnet;
+using namespace rnet::log;
+
+namespace {
+// <linux/ioprio.h> 在老的内核头文件中不存在
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle  = 3;
+constexpr int kIoprioClassShift = 13;
+
+// 当前线程降到最低优先级, 压缩和删除文件不和业务线程争抢 cpu 与磁盘
+void LowerThreadPriority() {
+  ::setpriority( PRIO_PROCESS, static_cast< id_t >( thread::Tid() ), 19 );
+  ::syscall( SYS_ioprio_set, kIoprioWhoProcess, thread::Tid(), kIoprioClassIdle << kIoprioClassShift );
+}
+
+bool IsRolledFile( const std::string& name, const std::string& prefix ) {
+  auto endsWith = [ &name ]( std::string_view suffix ) { return name.size() >= suffix.size() && name.compare( name.size() - suffix.size(), suffix.size(), suffix ) == 0; };
+  return name.compare( 0, prefix.size(), prefix ) == 0 && ( endsWith( ".log" ) || endsWith( ".log.gz" ) );
+}
+}  // namespace
+
+LogArchiver::LogArchiver( const std::string& basenameArg, const Options& optionsArg )
+  : basename( basenameArg ), options( optionsArg ), running_( false ), thread_( std::bind( &::rnet::log::LogArchiver::ThreadFunction, this ), "LogArchiver" ), mutex_(), cond_() {}
+
+LogArchiver::~LogArchiver() {
+  if ( running_ ) {
+    Stop();
+  }
+}
+
+void LogArchiver::Start() {
+  assert( !running_ );
+  running_ = true;
+  thread_.Start();
+}
+
+void LogArchiver::Stop() {
+  {
+    std::lock_guard lock( mutex_ );
+    running_ = false;
+  }
+  cond_.notify_one();
+  thread_.Join();
+}
+
+void LogArchiver::Submit( std::string filename ) {
+  {
+    std::lock_guard lock( mutex_ );
+    pending_.push_back( std::move( filename ) );
+  }
+  cond_.notify_one();
+}
+
+void LogArchiver::SetActiveFile( std::string filename ) {
+  std::lock_guard lock( mutex_ );
+  activeFile_ = std::move( filename );
+}
+
+void LogArchiver::ThreadFunction() {
+  LowerThreadPriority();
+  std::vector< std::string > files;
+  bool                       running = true;
+  while ( running ) {
+    {
+      std::unique_lock lock( mutex_ );
+      cond_.wait( lock, [ this ] { return !pending_.empty() || !running_; } );
+      files.swap( pending_ );
+      // 退出前把已经提交的文件处理完
+      running = running_;
+    }
+
+    if ( options.compress ) {
+      for ( const auto& file : files ) {
+        Compress( file );
+      }
+    }
+    files.clear();
+    EnforceRetention();
+  }
+}
+
+// 先写到 .gz.tmp 再改名, 进程中途退出不会留下不完整的 .gz
+bool LogArchiver::Compress( const std::string& filename ) const {
+  FILE* in = ::fopen( filename.c_str(), "re" );
+  if ( in == nullptr ) {
+    // 可能已经被清理掉了
+    return false;
+  }
+  std::string tmpName = filename + ".gz.tmp";
+  char        mode[ 8 ];
+  snprintf( mode, sizeof mode, "wb%d", options.compressLevel );
+  gzFile out = ::gzopen( tmpName.c_str(), mode );
+  if ( out == nullptr ) {
+    fprintf( stderr, "LogArchiver::Compress() gzopen %s failed\n", tmpName.c_str() );
+    ::fclose( in );
+    return false;
+  }
+
+  char buf[ 64 * kbSize ];
+  bool ok = true;
+  while ( ok ) {
+    size_t n = ::fread( buf, 1, sizeof buf, in );
+    if ( n == 0 ) {
+      ok = ::ferror( in ) == 0;
+      break;
+    }
+    ok = ::gzwrite( out, buf, static_cast< unsigned >( n ) ) == static_cast< int >( n );
+  }
+  ::fclose( in );
+  ok = ::gzclose( out ) == Z_OK && ok;
+
+  if ( ok && ::rename( tmpName.c_str(), ( filename + ".gz" ).c_str() ) == 0 ) {
+    ::unlink( filename.c_str() );
+    return true;
+  }
+  fprintf( stderr, "LogArchiver::Compress() %s failed %s\n", filename.c_str(), thread::GetErrnoMessage( errno ) );
+  ::unlink( tmpName.c_str() );
+  return false;
+}
+
+// 文件名以时间开头, 按名字排序即按时间排序, 从新到旧累计, 超出限制的全部删除
+void LogArchiver::EnforceRetention() {
+  if ( options.maxFiles <= 0 && options.maxTotalBytes <= 0 ) {
+    return;
+  }
+  namespace fs = std::filesystem;
+  std::string active;
+  {
+    std::lock_guard lock( mutex_ );
+    active = activeFile_;
+  }
+
+  std::string                                    prefix = basename + ".";
+  std::vector< std::pair< std::string, off_t > > rolled;
+  std::error_code                                ec;
+  for ( const auto& entry : fs::directory_iterator( ".", ec ) ) {
+    std::string name = entry.path().filename().string();
+    if ( name != active && entry.is_regular_file( ec ) && IsRolledFile( name, prefix ) ) {
+      rolled.emplace_back( std::move( name ), static_cast< off_t >( entry.file_size( ec ) ) );
+    }
+  }
+  std::sort( rolled.begin(), rolled.end(), std::greater<>() );
+
+  off_t totalBytes = 0;
+  for ( size_t i = 0; i < rolled.size(); ++i ) {
+    totalBytes += rolled[ i ].second;
+    bool tooMany  = options.maxFiles > 0 && i >= static_cast< size_t >( options.maxFiles );
+    bool tooLarge = options.maxTotalBytes > 0 && totalBytes > options.maxTotalBytes;
+    if ( tooMany || tooLarge ) {
+      ::unlink( rolled[ i ].first.c_str() );
+    }
+  }
+}
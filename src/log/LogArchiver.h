@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/Common.h"
+#include "unix/Thread.h"
+
+namespace rnet::log {
+
+// 滚动后日志文件的后台处理: gzip 压缩, 按文件数或总字节数清理旧文件
+// 工作线程以最低的 cpu/io 优先级运行
+// LogFile 滚动时只调用 Submit 把旧文件名放进队列, 不会被压缩或删除阻塞
+class LogArchiver : Noncopyable {
+public:
+  struct Options {
+    bool  compress      = true;
+    int   compressLevel = 6;
+    int   maxFiles      = 0;  // 保留的已滚动文件数, 0 不限制
+    off_t maxTotalBytes = 0;  // 已滚动文件总大小上限, 0 不限制
+  };
+
+  LogArchiver( const std::string& basenameArg, const Options& optionsArg );
+  ~LogArchiver();
+
+  void Start();
+  void Stop();
+
+  // 提交一个已经关闭的日志文件, 可在任意线程调用
+  void Submit( std::string filename );
+  // 正在写的文件, 清理时跳过
+  void SetActiveFile( std::string filename );
+
+private:
+  void ThreadFunction();
+  bool Compress( const std::string& filename ) const;
+  void EnforceRetention();
+
+  const std::string          basename;
+  const Options              options;
+  bool                       running_;
+  rnet::thread::Thread       thread_;
+  std::mutex                 mutex_;
+  std::condition_variable    cond_;
+  std::vector< std::string > pending_;
+  std::string                activeFile_;
+};
+
+}  // namespace rnet::log
@@ -7,12 +7,13 @@
 #include <optional>
 
 #include "file/File.h"
+#include "log/LogArchiver.h"
 #include "unix/ProcssInfo.h"
 
 namespace rnet::log {
 
-LogFile::LogFile( const std::string& basename, off_t rollSize, bool threadSafe, int flushInterval, int checkEveryN )
-  : basename( basename ), rollSize( rollSize ), flushInterval( flushInterval ), checkEveryN( checkEveryN ), count_( 0 ), mutex_( threadSafe ? std::make_optional< std::mutex >() : std::nullopt ),
+LogFile::LogFile( const std::string& basename, off_t rollSize, bool threadSafe, int flushInterval, int checkEveryN, LogArchiver* archiver )
+  : basename( basename ), rollSize( rollSize ), flushInterval( flushInterval ), checkEveryN( checkEveryN ), count_( 0 ), rollIndex_( 0 ), archiver_( archiver ), mutex_( threadSafe ? std::make_optional< std::mutex >() : std::nullopt ),
     startOfPeriod_( 0 ), lastRoll_( 0 ), lastFlush_( 0 ) {
   assert( basename.find( '/' ) == std::string::npos );
   RollFile();
@@ -65,20 +66,29 @@ void LogFile::AppendUnlocked( const char* logline, int len ) {
 
 bool LogFile::RollFile() {
   time_t      now      = 0;
-  std::string filename = GetLogFileName( basename, &now );
+  std::string filename = GetLogFileName( basename, &now, rollIndex_ );
   time_t      start    = now / kRollPerSeconds * kRollPerSeconds;
 
   if ( now > lastRoll_ ) {
     lastRoll_      = now;
     lastFlush_     = now;
     startOfPeriod_ = start;
+    ++rollIndex_;
+    // 先关闭旧文件(析构时 fclose 刷盘)再交给 archiver
     file_.reset( new file::AppendFile( filename ) );
+    if ( archiver_ != nullptr ) {
+      archiver_->SetActiveFile( filename );
+      if ( !filename_.empty() ) {
+        archiver_->Submit( std::move( filename_ ) );
+      }
+    }
+    filename_ = std::move( filename );
     return true;
   }
   return false;
 }
 
-std::string LogFile::GetLogFileName( const std::string& basename, time_t* now ) {
+std::string LogFile::GetLogFileName( const std::string& basename, time_t* now, int index ) {
   std::string filename;
   filename.reserve( basename.size() + 64 );
   filename = basename;
@@ -93,7 +103,7 @@ std::string LogFile::GetLogFileName( const std::string& basename, time_t* now )
   filename += Unix::Hostname();
 
   char pidbuf[ 32 ];
-  snprintf( pidbuf, sizeof pidbuf, ".%d", Unix::Pid() );
+  snprintf( pidbuf, sizeof pidbuf, ".%d.%06d", Unix::Pid(), index );
   filename += pidbuf;
 
   filename += ".log";
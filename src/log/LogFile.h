@@ -9,9 +9,14 @@
 #include "file/File.h"
 
 namespace rnet::log {
+class LogArchiver;
+
+// 文件名: basename.YYYYmmdd-HHMMSS.hostname.pid.NNNNNN.log
+// NNNNNN 为本进程内的滚动序号, 同一秒内多次滚动也能按文件名排序
+// 设置了 archiver 时,滚动出去的旧文件交给 archiver 在后台压缩和清理
 class LogFile : Noncopyable {
 public:
-  LogFile( const std::string& basename, off_t rollSize, bool threadSafe = true, int flushInterval = 3, int checkEveryN = kbSize );
+  LogFile( const std::string& basename, off_t rollSize, bool threadSafe = true, int flushInterval = 3, int checkEveryN = kbSize, LogArchiver* archiver = nullptr );
   ~LogFile();
 
   void Append( const char* logline, int len );
@@ -21,14 +26,17 @@ public:
 private:
   void AppendUnlocked( const char* logline, int len );
 
-  static std::string GetLogFileName( const std::string& basename, time_t* now );
+  static std::string GetLogFileName( const std::string& basename, time_t* now, int index );
 
   const std::string basename;
   const off_t       rollSize;
   const int         flushInterval;
   const int         checkEveryN;
 
-  int count_;
+  int          count_;
+  int          rollIndex_;
+  LogArchiver* archiver_;
+  std::string  filename_;
 
   std::optional< std::mutex >         mutex_;
   time_t                              startOfPeriod_;
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "base/Common.h"
+#include "log/LogStream.h"
+#include "unix/Time.h"
+
+namespace rnet::log {
+
+// 限频日志的调用点状态,每个 LOG_EVERY_* 调用点持有一个静态实例
+// 只用 relaxed 原子操作,多线程同时命中时允许有一两条的误差
+// 时间取 CLOCK_REALTIME_COARSE, 精度为毫秒级,足够做限频
+
+// 第 1, n+1, 2n+1 ... 次输出
+class LogEveryN : Noncopyable {
+public:
+  bool ShouldLog( uint64_t n, int64_t* suppressed ) {
+    uint64_t count = count_.fetch_add( 1, std::memory_order_relaxed );
+    if ( n <= 1 || count % n == 0 ) {
+      *suppressed = count == 0 || n <= 1 ? 0 : static_cast< int64_t >( n - 1 );
+      return true;
+    }
+    return false;
+  }
+
+private:
+  std::atomic< uint64_t > count_{ 0 };
+};
+
+// 只输出前 n 次
+class LogFirstN : Noncopyable {
+public:
+  bool ShouldLog( uint64_t n, int64_t* /*suppressed*/ ) {
+    // 先读一次,达到上限后不再写共享的cache line
+    if ( count_.load( std::memory_order_relaxed ) >= n ) {
+      return false;
+    }
+    return count_.fetch_add( 1, std::memory_order_relaxed ) < n;
+  }
+
+private:
+  std::atomic< uint64_t > count_{ 0 };
+};
+
+// 每 seconds 秒最多输出一次,被丢弃的条数记在下一条输出里
+class LogEveryT : Noncopyable {
+public:
+  bool ShouldLog( double seconds, int64_t* suppressed ) {
+    int64_t now  = Unix::Timestamp::NowCoarse().MicroSecondsSinceEpoch();
+    int64_t next = next_.load( std::memory_order_relaxed );
+    if ( now < next || !next_.compare_exchange_strong( next, now + static_cast< int64_t >( seconds * Unix::Timestamp::kMicroSecondsPerSecond ), std::memory_order_relaxed ) ) {
+      suppressed_.fetch_add( 1, std::memory_order_relaxed );
+      return false;
+    }
+    *suppressed = suppressed_.exchange( 0, std::memory_order_relaxed );
+    return true;
+  }
+
+private:
+  std::atomic< int64_t > next_{ 0 };
+  std::atomic< int64_t > suppressed_{ 0 };
+};
+
+// 令牌桶: 平均每秒 perSecond 条,允许突发 burst 条
+// 用 GCRA 实现, 整个桶只有一个原子变量 tat_ (theoretical arrival time)
+class LogTokenBucket : Noncopyable {
+public:
+  bool ShouldLog( double perSecond, int burst, int64_t* suppressed ) {
+    assert( perSecond > 0 && burst > 0 );
+    auto    interval = static_cast< int64_t >( Unix::Timestamp::kMicroSecondsPerSecond / perSecond );
+    int64_t now      = Unix::Timestamp::NowCoarse().MicroSecondsSinceEpoch();
+    int64_t tat      = tat_.load( std::memory_order_relaxed );
+    int64_t newTat   = 0;
+    do {
+      if ( tat - now > interval * ( burst - 1 ) ) {
+        suppressed_.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+      }
+      newTat = ( tat > now ? tat : now ) + interval;
+    } while ( !tat_.compare_exchange_weak( tat, newTat, std::memory_order_relaxed ) );
+    *suppressed = suppressed_.exchange( 0, std::memory_order_relaxed );
+    return true;
+  }
+
+private:
+  std::atomic< int64_t > tat_{ 0 };
+  std::atomic< int64_t > suppressed_{ 0 };
+};
+
+// 在日志行首输出被限频丢弃的条数
+struct LogSuppressed {
+  int64_t count;
+};
+
+inline LogStream& operator<<( LogStream& s, LogSuppressed v ) {
+  if ( v.count > 0 ) {
+    s << "[suppressed " << v.count << " messages] ";
+  }
+  return s;
+}
+
+}  // namespace rnet::log
@@ -0,0 +1,191 @@
+#include "log/LogModule.h"
+
+#include <strings.h>
+
+#include <array>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "log/Logger.h"
+
+namespace rnet::log {
+namespace {
+  constexpr const char* kLevelNames[ Logger::numLogLevels ] = {
+    "trace", "debug", "info", "warn", "error", "fatal",
+  };
+
+  struct ModuleTable {
+    std::mutex                                          mutex;
+    std::array< LogModule::Slot, LogModule::kMaxSlots > slots;
+    size_t                                              used = 0;
+    // 槽位用完后所有新调用点共享的槽位,只跟随全局级别
+    LogModule::Slot                                     overflow;
+    std::map< std::string, int, std::less<> >           overrides;
+  };
+
+  ModuleTable& Table() {
+    static ModuleTable table;
+    return table;
+  }
+
+  int ParseLevel( std::string_view name ) {
+    for ( int i = 0; i < Logger::numLogLevels; ++i ) {
+      if ( name.size() == strlen( kLevelNames[ i ] ) && ::strncasecmp( name.data(), kLevelNames[ i ], name.size() ) == 0 ) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  std::string_view Trim( std::string_view s ) {
+    while ( !s.empty() && ( s.front() == ' ' || s.front() == '\t' ) ) {
+      s.remove_prefix( 1 );
+    }
+    while ( !s.empty() && ( s.back() == ' ' || s.back() == '\t' ) ) {
+      s.remove_suffix( 1 );
+    }
+    return s;
+  }
+
+  // 文件级别 > 模块级别 > 全局级别
+  int EffectiveLevel( const ModuleTable& table, std::string_view file, std::string_view module ) {
+    auto it = table.overrides.find( file );
+    if ( it != table.overrides.end() ) {
+      return it->second;
+    }
+    it = table.overrides.find( module );
+    if ( it != table.overrides.end() ) {
+      return it->second;
+    }
+    return Logger::LogLevel();
+  }
+
+}  // namespace
+
+void LogModule::RecomputeLocked() {
+  ModuleTable& table = Table();
+  for ( size_t i = 0; i < table.used; ++i ) {
+    Slot& slot = table.slots[ i ];
+    slot.level_.store( EffectiveLevel( table, slot.file_, slot.module_ ), std::memory_order_relaxed );
+  }
+  table.overflow.level_.store( Logger::LogLevel(), std::memory_order_relaxed );
+}
+
+const LogModule::Slot* LogModule::Register( const char* path ) {
+  std::string_view full( path );
+  std::string_view file   = full;
+  std::string_view module = "";
+  size_t           slash  = full.rfind( '/' );
+  if ( slash != std::string_view::npos ) {
+    file = full.substr( slash + 1 );
+    std::string_view dir  = full.substr( 0, slash );
+    size_t           prev = dir.rfind( '/' );
+    module                = prev == std::string_view::npos ? dir : dir.substr( prev + 1 );
+  }
+
+  ModuleTable&    table = Table();
+  std::lock_guard lock( table.mutex );
+  for ( size_t i = 0; i < table.used; ++i ) {
+    if ( table.slots[ i ].file_ == file && table.slots[ i ].module_ == module ) {
+      return &table.slots[ i ];
+    }
+  }
+  if ( table.used == table.slots.size() ) {
+    table.overflow.level_.store( Logger::LogLevel(), std::memory_order_relaxed );
+    return &table.overflow;
+  }
+
+  Slot& slot   = table.slots[ table.used++ ];
+  slot.file_   = file;
+  slot.module_ = module;
+  slot.level_.store( EffectiveLevel( table, slot.file_, slot.module_ ), std::memory_order_relaxed );
+  return &slot;
+}
+
+void LogModule::SetLevel( std::string_view name, int level ) {
+  assert( 0 <= level && level < Logger::numLogLevels );
+  ModuleTable&    table = Table();
+  std::lock_guard lock( table.mutex );
+  table.overrides[ std::string( name ) ] = level;
+  RecomputeLocked();
+}
+
+void LogModule::ResetLevel( std::string_view name ) {
+  ModuleTable&    table = Table();
+  std::lock_guard lock( table.mutex );
+  auto            it = table.overrides.find( name );
+  if ( it != table.overrides.end() ) {
+    table.overrides.erase( it );
+    RecomputeLocked();
+  }
+}
+
+bool LogModule::ApplySpec( std::string_view spec ) {
+  std::vector< std::pair< std::string_view, int > > entries;
+  while ( !spec.empty() ) {
+    size_t           comma = spec.find( ',' );
+    std::string_view item  = Trim( spec.substr( 0, comma ) );
+    spec                   = comma == std::string_view::npos ? std::string_view() : spec.substr( comma + 1 );
+    if ( item.empty() ) {
+      continue;
+    }
+    size_t eq = item.find( '=' );
+    if ( eq == std::string_view::npos ) {
+      return false;
+    }
+    std::string_view name  = Trim( item.substr( 0, eq ) );
+    int              level = ParseLevel( Trim( item.substr( eq + 1 ) ) );
+    if ( name.empty() || level < 0 ) {
+      return false;
+    }
+    entries.emplace_back( name, level );
+  }
+
+  ModuleTable&    table = Table();
+  std::lock_guard lock( table.mutex );
+  for ( const auto& [ name, level ] : entries ) {
+    table.overrides[ std::string( name ) ] = level;
+  }
+  RecomputeLocked();
+  return true;
+}
+
+void LogModule::Refresh() {
+  ModuleTable&    table = Table();
+  std::lock_guard lock( table.mutex );
+  RecomputeLocked();
+}
+
+std::string LogModule::Dump() {
+  ModuleTable&    table = Table();
+  std::lock_guard lock( table.mutex );
+  std::string     result;
+  for ( size_t i = 0; i < table.used; ++i ) {
+    const Slot& slot = table.slots[ i ];
+    result += slot.file_;
+    result += '(';
+    result += slot.module_;
+    result += ")=";
+    result += kLevelNames[ slot.Level() ];
+    result += '\n';
+  }
+  return result;
+}
+
+namespace {
+  class InitModuleLevels {
+  public:
+    InitModuleLevels() {
+      const char* spec = ::getenv( "RNET_LOG_MODULES" );
+      if ( spec != nullptr && !LogModule::ApplySpec( spec ) ) {
+        fprintf( stderr, "invalid RNET_LOG_MODULES: %s\n", spec );
+      }
+    }
+  };
+
+  InitModuleLevels initModuleLevels;
+}  // namespace
+
+}  // namespace rnet::log
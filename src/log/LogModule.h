@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <string_view>
+
+#include "base/Common.h"
+
+namespace rnet::log {
+
+// 按源文件或模块划分的动态日志级别表
+// 模块名即源文件所在目录名(network, log, http ...),文件名为 basename(TcpConnection.cc)
+// 每个 LOG_* 调用点第一次执行时注册并缓存自己文件的槽位,之后每条日志只做一次 relaxed 原子读
+// 注册与修改级别加锁,读路径无锁,可以在运行期由管理接口修改而不用重启进程
+class LogModule : Noncopyable {
+public:
+  class Slot : Noncopyable {
+  public:
+    int Level() const {
+      return level_.load( std::memory_order_relaxed );
+    }
+
+  private:
+    friend class LogModule;
+
+    std::atomic< int > level_{ 0 };
+    // 以下成员由 LogModule 的锁保护
+    std::string file_;
+    std::string module_;
+  };
+
+  // 调用点注册,返回的槽位在进程生命周期内有效
+  static const Slot* Register( const char* file );
+
+  // name 为文件名(包含'.')或模块名, 文件级别优先于模块级别
+  static void SetLevel( std::string_view name, int level );
+  static void ResetLevel( std::string_view name );
+
+  // 解析 "network=trace,Logger.cc=debug" 形式的配置, 出错返回false且不做任何修改
+  // 进程启动时会读取环境变量 RNET_LOG_MODULES
+  static bool ApplySpec( std::string_view spec );
+
+  // 全局级别改变后重新计算所有未单独设置的槽位
+  static void Refresh();
+
+  // "file(module)=LEVEL" 每行一个, 用于管理接口查看
+  static std::string Dump();
+
+  static const int kMaxSlots = 512;
+
+private:
+  // 调用者持有表锁
+  static void RecomputeLocked();
+};
+
+}  // namespace rnet::log
@@ -14,9 +14,14 @@ using namespace rnet;
 
 namespace rnet::log {
 // 线程内缓存
+// tTimeBuf 保存 "YYYYMMDD HH:MM:SS.uuuuuuZ ", 秒以上部分每秒重建一次,
+// 每条日志只改写微秒的6位数字
+constexpr int kTimePrefixLen = 17;
+constexpr int kTimeLen       = 26;
+
 thread_local std::array< char, 512 > tErrnoBuf;
 thread_local std::array< char, 512 > tTimeBuf;
-thread_local time_t                  tLastSecond;
+thread_local time_t                  tLastSecond = -1;
 
 const char* GetErrnoMessage( int savedErrno ) {
   return strerror_r( savedErrno, tErrnoBuf.data(), tErrnoBuf.size() );
@@ -67,15 +72,42 @@ void FlushStdout() {
   fflush( stdout );
 }
 
-Logger::OutputFunc globalOutput = WriteStdout;
-Logger::FlushFunc  globalFlush  = FlushStdout;
+Logger::OutputFunc globalOutput   = WriteStdout;
+Logger::FlushFunc  globalFlush    = FlushStdout;
+Logger::TimeFunc   globalTimeFunc = Unix::Timestamp::Now;
+
+// "00" "01" ... "99", 每次写两位,除法次数减半
+constexpr char kDigitPairs[] = "00010203040506070809"
+                               "10111213141516171819"
+                               "20212223242526272829"
+                               "30313233343536373839"
+                               "40414243444546474849"
+                               "50515253545556575859"
+                               "60616263646566676869"
+                               "70717273747576777879"
+                               "80818283848586878889"
+                               "90919293949596979899";
+
+inline void FormatTwoDigits( char* buf, int value ) {
+  assert( 0 <= value && value < 100 );
+  memcpy( buf, kDigitPairs + value * 2, 2 );
+}
+
+// 定宽写入6位十进制数(微秒),不足补零
+inline void FormatSixDigits( char* buf, int value ) {
+  assert( 0 <= value && value < 1000000 );
+  FormatTwoDigits( buf + 4, value % 100 );
+  value /= 100;
+  FormatTwoDigits( buf + 2, value % 100 );
+  FormatTwoDigits( buf, value / 100 );
+}
 // TimeZone GlobalLogTimeZone;
 
 }  // namespace rnet::log
 
 using namespace rnet::log;
 
-Logger::Impl::Impl( LogLevel level, int savedErrno, const SourceFile& file, int line ) : time_( Timestamp::Now() ), stream_(), level_( level ), line_( line ), basename_( file ) {
+Logger::Impl::Impl( LogLevel level, int savedErrno, const SourceFile& file, int line ) : time_( globalTimeFunc() ), stream_(), level_( level ), line_( line ), basename_( file ) {
   FormatTime();
   thread::Tid();
   stream_ << T( thread::TidString(), thread::TidStringLength() );
@@ -89,19 +121,30 @@ void Logger::Impl::FormatTime() {
   int64_t microSecondsSinceEpoch = time_.MicroSecondsSinceEpoch();
   time_t  seconds                = static_cast< time_t >( microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond );
   int     microseconds           = static_cast< int >( microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond );
+  char*   buf                    = tTimeBuf.data();
   if ( seconds != tLastSecond ) {
     tLastSecond = seconds;
     struct tm tmTime;
     ::gmtime_r( &seconds, &tmTime );  // FIXME TimeZone::fromUtcTime
 
-    int len = snprintf( tTimeBuf.data(), tTimeBuf.size(), "%4d%02d%02d %02d:%02d:%02d", tmTime.tm_year + 1900, tmTime.tm_mon + 1, tmTime.tm_mday, tmTime.tm_hour, tmTime.tm_min, tmTime.tm_sec );
-    assert( len == 17 );
-    ( void )len;
+    int year = tmTime.tm_year + 1900;
+    FormatTwoDigits( buf, year / 100 );
+    FormatTwoDigits( buf + 2, year % 100 );
+    FormatTwoDigits( buf + 4, tmTime.tm_mon + 1 );
+    FormatTwoDigits( buf + 6, tmTime.tm_mday );
+    buf[ 8 ] = ' ';
+    FormatTwoDigits( buf + 9, tmTime.tm_hour );
+    buf[ 11 ] = ':';
+    FormatTwoDigits( buf + 12, tmTime.tm_min );
+    buf[ 14 ] = ':';
+    FormatTwoDigits( buf + 15, tmTime.tm_sec );
+    buf[ kTimePrefixLen ] = '.';
+    buf[ kTimeLen - 2 ]   = 'Z';
+    buf[ kTimeLen - 1 ]   = ' ';
   }
 
-  Fmt us( ".%06dZ ", microseconds );
-  assert( us.Length() == 9 );
-  stream_ << T( tTimeBuf.data(), 17 ) << T( us.Data(), 9 );
+  FormatSixDigits( buf + kTimePrefixLen + 1, microseconds );
+  stream_ << T( buf, kTimeLen );
 }
 
 void Logger::Impl::Finish() {
@@ -129,6 +172,7 @@ Logger::~Logger() {
 }
 void Logger::SetLogLevel( enum Logger::LogLevel level ) {
   globalLogLevel = level;
+  LogModule::Refresh();
 }
 
 void Logger::SetOutput( OutputFunc out ) {
@@ -139,4 +183,8 @@ void Logger::SetFlush( FlushFunc flush ) {
   globalFlush = flush;
 }
 
+void Logger::SetTimeFunc( TimeFunc func ) {
+  globalTimeFunc = func;
+}
+
 // void Logger::setTimeZone(const TimeZone& tz) { GlobalLogTimeZone = tz; }
@@ -5,6 +5,8 @@
 
 #include "Logger.h"
 #include "file/Buffer.h"
+#include "log/LogLimiter.h"
+#include "log/LogModule.h"
 #include "log/LogStream.h"
 #include "unix/Time.h"
 namespace rnet {
@@ -64,9 +66,13 @@ namespace log {
 
     using OutputFunc = void ( * )( const char*, size_t );
     using FlushFunc  = void ( * )();
+    // 日志时间来源,默认为 Timestamp::Now (gettimeofday)
+    // 可替换为 Timestamp::NowCoarse, 或在io线程中返回 EventLoop::PollReturnTime
+    using TimeFunc = Timestamp ( * )();
 
     static void SetOutput( OutputFunc );
     static void SetFlush( FlushFunc );
+    static void SetTimeFunc( TimeFunc );
     // static void setTimeZone(const detail::TimeZone& tz);
 
   private:
@@ -117,21 +123,81 @@ namespace log {
 
 }  // namespace log
 
-#define LOG_TRACE                                      \
-  if ( log::Logger::LogLevel() <= log::Logger::trace ) \
+// 编译期最低日志级别,低于此级别的日志语句整体被编译器消除
+// 0 trace, 1 debug, 2 info, 3 warn, 4 error, 5 fatal
+// 例如 release 构建加 -DRNET_LOG_MIN_LEVEL=2 去掉所有 LOG_TRACE/LOG_DEBUG
+#ifndef RNET_LOG_MIN_LEVEL
+#define RNET_LOG_MIN_LEVEL 0
+#endif
+
+// 运行期级别按调用点所在源文件查表(见 LogModule),每个调用点只注册一次
+#define RNET_LOG_SITE_LEVEL()                                                            \
+  ( [] {                                                                                 \
+    static const log::LogModule::Slot* rnetLogSlot = log::LogModule::Register( __FILE__ ); \
+    return rnetLogSlot;                                                                  \
+  }()                                                                                    \
+      ->Level() )
+
+#define RNET_LOG_ENABLED( level ) ( RNET_LOG_MIN_LEVEL <= ( level ) && RNET_LOG_SITE_LEVEL() <= ( level ) )
+
+#define LOG_TRACE                                \
+  if ( RNET_LOG_ENABLED( log::Logger::trace ) ) \
   log::Logger( __FILE__, __LINE__, log::Logger::trace, __func__ ).Stream()
-#define LOG_DEBUG                                      \
-  if ( log::Logger::LogLevel() <= log::Logger::debug ) \
+#define LOG_DEBUG                                \
+  if ( RNET_LOG_ENABLED( log::Logger::debug ) ) \
   log::Logger( __FILE__, __LINE__, log::Logger::debug, __func__ ).Stream()
-#define LOG_INFO                                      \
-  if ( log::Logger::LogLevel() <= log::Logger::info ) \
+#define LOG_INFO                                \
+  if ( RNET_LOG_ENABLED( log::Logger::info ) ) \
   log::Logger( __FILE__, __LINE__ ).Stream()
-#define LOG_WARN log::Logger( __FILE__, __LINE__, log::Logger::warn ).Stream()
-#define LOG_ERROR log::Logger( __FILE__, __LINE__, log::Logger::error ).Stream()
+#define LOG_WARN                                \
+  if ( RNET_LOG_ENABLED( log::Logger::warn ) ) \
+  log::Logger( __FILE__, __LINE__, log::Logger::warn ).Stream()
+#define LOG_ERROR                                \
+  if ( RNET_LOG_ENABLED( log::Logger::error ) ) \
+  log::Logger( __FILE__, __LINE__, log::Logger::error ).Stream()
 #define LOG_FATAL log::Logger( __FILE__, __LINE__, log::Logger::fatal ).Stream()
-#define LOG_SYSERR log::Logger( __FILE__, __LINE__, false ).Stream()
+#define LOG_SYSERR                               \
+  if ( RNET_LOG_ENABLED( log::Logger::error ) ) \
+  log::Logger( __FILE__, __LINE__, false ).Stream()
 #define LOG_SYSFATAL log::Logger( __FILE__, __LINE__, true ).Stream()
 
+// 限频日志, level 取 trace/debug/info/warn/error/syserr
+//   LOG_EVERY_N( error, 100 ) << ...         第 1, 101, 201 ... 次输出
+//   LOG_FIRST_N( warn, 10 ) << ...           只输出前 10 次
+//   LOG_EVERY_T( syserr, 1.0 ) << ...        每秒最多一次
+//   LOG_RATE_LIMITED( error, 10, 50 ) << ... 令牌桶, 平均每秒 10 条, 突发 50 条
+// 被丢弃的条数以 "[suppressed N messages]" 的形式出现在下一条输出的行首
+#define RNET_LOG_LEVEL_trace log::Logger::trace
+#define RNET_LOG_LEVEL_debug log::Logger::debug
+#define RNET_LOG_LEVEL_info log::Logger::info
+#define RNET_LOG_LEVEL_warn log::Logger::warn
+#define RNET_LOG_LEVEL_error log::Logger::error
+#define RNET_LOG_LEVEL_syserr log::Logger::error
+
+#define RNET_LOG_LOGGER_trace log::Logger( __FILE__, __LINE__, log::Logger::trace, __func__ )
+#define RNET_LOG_LOGGER_debug log::Logger( __FILE__, __LINE__, log::Logger::debug, __func__ )
+#define RNET_LOG_LOGGER_info log::Logger( __FILE__, __LINE__ )
+#define RNET_LOG_LOGGER_warn log::Logger( __FILE__, __LINE__, log::Logger::warn )
+#define RNET_LOG_LOGGER_error log::Logger( __FILE__, __LINE__, log::Logger::error )
+#define RNET_LOG_LOGGER_syserr log::Logger( __FILE__, __LINE__, false )
+
+// 每个调用点一个静态状态对象
+#define RNET_LOG_SITE_STATE( Type ) \
+  ( []() -> Type& {                \
+    static Type rnetLogState;      \
+    return rnetLogState;           \
+  }() )
+
+#define RNET_LOG_LIMITED( level, Type, ... )                                                                      \
+  if ( RNET_LOG_ENABLED( RNET_LOG_LEVEL_##level ) )                                                              \
+    if ( int64_t rnetSuppressed = 0; RNET_LOG_SITE_STATE( log::Type ).ShouldLog( __VA_ARGS__, &rnetSuppressed ) ) \
+  RNET_LOG_LOGGER_##level.Stream() << log::LogSuppressed{ rnetSuppressed }
+
+#define LOG_EVERY_N( level, n ) RNET_LOG_LIMITED( level, LogEveryN, static_cast< uint64_t >( n ) )
+#define LOG_FIRST_N( level, n ) RNET_LOG_LIMITED( level, LogFirstN, static_cast< uint64_t >( n ) )
+#define LOG_EVERY_T( level, seconds ) RNET_LOG_LIMITED( level, LogEveryT, static_cast< double >( seconds ) )
+#define LOG_RATE_LIMITED( level, perSecond, burst ) RNET_LOG_LIMITED( level, LogTokenBucket, static_cast< double >( perSecond ), static_cast< int >( burst ) )
+
 // Check that the input is non NULL.  This very useful in constructor
 // initializer lists.
 
@@ -0,0 +1,214 @@
+#include "log/RingLogFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "unix/Thread.h"
+
+using namespace rnet;
+using namespace rnet::log;
+
+static_assert( std::atomic< uint64_t >::is_always_lock_free, "ring offsets are shared through mmap" );
+
+namespace {
+constexpr char     kMagic[ 8 ] = { 'R', 'N', 'E', 'T', 'R', 'I', 'N', 'G' };
+constexpr uint32_t kVersion    = 1;
+constexpr uint32_t kData       = 1;
+constexpr uint32_t kPadding    = 2;
+
+constexpr uint64_t Align8( uint64_t n ) {
+  return ( n + 7 ) & ~static_cast< uint64_t >( 7 );
+}
+}  // namespace
+
+struct RingLogFile::FileHeader {
+  char                    magic[ 8 ];
+  uint32_t                version;
+  uint32_t                headerSize;
+  uint64_t                capacity;
+  std::atomic< uint64_t > head;  // 最旧一条完整记录的逻辑偏移
+  std::atomic< uint64_t > tail;  // 最后一条已发布记录的结尾
+};
+
+struct RingLogFile::RecordHeader {
+  uint32_t length;  // payload 长度, 不含对齐
+  uint32_t type;
+};
+
+RingLogFile::RingLogFile( const std::string& filenameArg, size_t capacity, bool threadSafe )
+  : filename( filenameArg ), fd_( ::open( filenameArg.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644 ) ), capacity_( Align8( capacity ) ), base_( nullptr ), header_( nullptr ), data_( nullptr ),
+    mutex_( threadSafe ? std::make_optional< std::mutex >() : std::nullopt ) {
+  assert( capacity_ >= kHeaderSize );
+  if ( fd_ < 0 ) {
+    fprintf( stderr, "RingLogFile::RingLogFile() open %s failed %s\n", filename.c_str(), thread::GetErrnoMessage( errno ) );
+    abort();
+  }
+  // ftruncate 只改变文件长度, 已有内容保留
+  off_t fileSize = static_cast< off_t >( kHeaderSize + capacity_ );
+  if ( ::ftruncate( fd_, fileSize ) < 0 ) {
+    fprintf( stderr, "RingLogFile::RingLogFile() ftruncate %s failed %s\n", filename.c_str(), thread::GetErrnoMessage( errno ) );
+    abort();
+  }
+  void* addr = ::mmap( nullptr, kHeaderSize + capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+  if ( addr == MAP_FAILED ) {
+    fprintf( stderr, "RingLogFile::RingLogFile() mmap %s failed %s\n", filename.c_str(), thread::GetErrnoMessage( errno ) );
+    abort();
+  }
+  base_   = static_cast< char* >( addr );
+  header_ = reinterpret_cast< FileHeader* >( base_ );
+  data_   = base_ + kHeaderSize;
+
+  bool reuse = memcmp( header_->magic, kMagic, sizeof kMagic ) == 0 && header_->version == kVersion && header_->headerSize == kHeaderSize && header_->capacity == capacity_
+               && header_->tail.load() - header_->head.load() <= capacity_;
+  if ( !reuse ) {
+    MemZero( header_, kHeaderSize );
+    header_->version    = kVersion;
+    header_->headerSize = static_cast< uint32_t >( kHeaderSize );
+    header_->capacity   = capacity_;
+    header_->head.store( 0 );
+    header_->tail.store( 0 );
+    // magic 最后写, 头部没有初始化完成时崩溃, 下次打开会重新初始化
+    memcpy( header_->magic, kMagic, sizeof kMagic );
+  }
+}
+
+RingLogFile::~RingLogFile() {
+  ::munmap( base_, kHeaderSize + capacity_ );
+  ::close( fd_ );
+}
+
+void RingLogFile::Append( const char* logline, int len ) {
+  if ( mutex_.has_value() ) {
+    std::lock_guard lock( mutex_.value() );
+    AppendUnlocked( logline, static_cast< size_t >( len ) );
+  }
+  else {
+    AppendUnlocked( logline, static_cast< size_t >( len ) );
+  }
+}
+
+void RingLogFile::Sync() {
+  ::msync( base_, kHeaderSize + capacity_, MS_ASYNC );
+}
+
+uint64_t RingLogFile::WrittenBytes() const {
+  return header_->tail.load( std::memory_order_acquire );
+}
+
+// AsyncLogging 一次交给我们的是整块缓冲区 (最大 kLargeSize), 按行切成多条记录写入
+// 这样 ring 放不下整块时, 覆盖掉的只是最旧的几行, 而不是把整块从前面截断
+void RingLogFile::AppendUnlocked( const char* logline, size_t len ) {
+  // 单条记录最多占数据区的 1/8, 回绕时填充浪费的空间也不超过这么多
+  size_t maxPayload = capacity_ / 8 - sizeof( RecordHeader );
+  // 超出容量的前段写进去也会马上被覆盖, 只写最后 3/4 个 ring, 从其中第一个行首开始
+  // 加上记录头和回绕填充也放得下, 写入的内容不会互相覆盖
+  if ( len > capacity_ ) {
+    size_t      keep  = capacity_ - capacity_ / 4;
+    const char* start = logline + len - keep;
+    const char* nl    = static_cast< const char* >( memchr( start, '\n', keep ) );
+    if ( nl != nullptr && nl + 1 < logline + len ) {
+      start = nl + 1;
+    }
+    len -= static_cast< size_t >( start - logline );
+    logline = start;
+  }
+  while ( len > 0 ) {
+    size_t chunk = len;
+    if ( chunk > maxPayload ) {
+      chunk = maxPayload;
+      // 在行尾切开, 一行本身就超过 maxPayload 时才在行中间切
+      const auto* nl = static_cast< const char* >( memrchr( logline, '\n', chunk ) );
+      if ( nl != nullptr ) {
+        chunk = static_cast< size_t >( nl + 1 - logline );
+      }
+    }
+    AppendRecord( logline, chunk );
+    logline += chunk;
+    len -= chunk;
+  }
+}
+
+void RingLogFile::AppendRecord( const char* data, size_t len ) {
+  uint64_t recordSize = sizeof( RecordHeader ) + Align8( len );
+  uint64_t tail       = header_->tail.load( std::memory_order_relaxed );
+  uint64_t pos        = tail % capacity_;
+
+  if ( pos + recordSize > capacity_ ) {
+    uint64_t padding = capacity_ - pos;
+    Reserve( tail + padding );
+    auto* record   = reinterpret_cast< RecordHeader* >( data_ + pos );
+    record->length = static_cast< uint32_t >( padding - sizeof( RecordHeader ) );
+    record->type   = kPadding;
+    tail += padding;
+    header_->tail.store( tail, std::memory_order_release );
+    pos = 0;
+  }
+
+  Reserve( tail + recordSize );
+  auto* record   = reinterpret_cast< RecordHeader* >( data_ + pos );
+  record->length = static_cast< uint32_t >( len );
+  record->type   = kData;
+  memcpy( data_ + pos + sizeof( RecordHeader ), data, len );
+  // 记录内容写完之后才发布 tail, 写到一半崩溃的记录不会被读出
+  header_->tail.store( tail + recordSize, std::memory_order_release );
+}
+
+// 覆盖旧记录之前先推进 head, 保证 [head, tail) 之间始终是完整记录
+void RingLogFile::Reserve( uint64_t end ) {
+  uint64_t head = header_->head.load( std::memory_order_relaxed );
+  if ( end - head <= capacity_ ) {
+    return;
+  }
+  while ( end - head > capacity_ ) {
+    const auto* record = reinterpret_cast< const RecordHeader* >( data_ + head % capacity_ );
+    head += sizeof( RecordHeader ) + Align8( record->length );
+  }
+  header_->head.store( head, std::memory_order_release );
+}
+
+bool RingLogFile::ReadAll( const std::string& path, const RecordCallback& cb ) {
+  int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+  if ( fd < 0 ) {
+    return false;
+  }
+  struct stat st;
+  if ( ::fstat( fd, &st ) < 0 || static_cast< size_t >( st.st_size ) <= kHeaderSize ) {
+    ::close( fd );
+    return false;
+  }
+  auto  size = static_cast< size_t >( st.st_size );
+  void* addr = ::mmap( nullptr, size, PROT_READ, MAP_SHARED, fd, 0 );
+  ::close( fd );
+  if ( addr == MAP_FAILED ) {
+    return false;
+  }
+
+  const char* base   = static_cast< const char* >( addr );
+  const auto* header = reinterpret_cast< const FileHeader* >( base );
+  const char* data   = base + kHeaderSize;
+  uint64_t    cap    = header->capacity;
+  uint64_t    head   = header->head.load( std::memory_order_acquire );
+  uint64_t    tail   = header->tail.load( std::memory_order_acquire );
+  bool ok = memcmp( header->magic, kMagic, sizeof kMagic ) == 0 && header->version == kVersion && cap + kHeaderSize == size && cap % 8 == 0 && tail - head <= cap;
+
+  while ( ok && head < tail ) {
+    const auto* record = reinterpret_cast< const RecordHeader* >( data + head % cap );
+    uint64_t    next   = head + sizeof( RecordHeader ) + Align8( record->length );
+    if ( next > tail || head % cap + ( next - head ) > cap ) {
+      ok = false;
+      break;
+    }
+    if ( record->type == kData ) {
+      cb( std::string_view( reinterpret_cast< const char* >( record + 1 ), record->length ) );
+    }
+    head = next;
+  }
+  ::munmap( addr, size );
+  return ok;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "base/Common.h"
+
+namespace rnet::log {
+
+// 固定大小的 mmap 文件, 作为环形缓冲区保存最近的日志
+// 写入只是一次 memcpy 加一次原子发布, 没有 write 系统调用, 由内核回写脏页
+// 进程崩溃后文件里保留最后 capacity 字节的日志, 用 RingLogFile::ReadAll 或 ring_log_reader 按顺序解出
+//
+// 文件布局: 一页文件头 + capacity 字节数据区
+// 数据区由 8 字节对齐的记录组成, [RecordHeader][payload][padding]
+// head/tail 是单调增长的逻辑偏移, 对 capacity 取模得到数据区内的位置
+// 记录不跨越数据区末尾, 剩余空间不够时写一条填充记录然后回绕
+// 一次 Append 的内容较大时按行拆成多条记录, 最多占数据区的 1/8
+class RingLogFile : Noncopyable {
+public:
+  // 已存在且容量相同的 ring 文件会接着写, 保留重启前的日志
+  RingLogFile( const std::string& filenameArg, size_t capacity, bool threadSafe = true );
+  ~RingLogFile();
+
+  void Append( const char* logline, int len );
+  // 数据由内核回写, 这里什么也不做, 只是为了和 LogFile 接口一致
+  void Flush() {}
+  // 需要落盘时显式调用 msync
+  void Sync();
+
+  uint64_t WrittenBytes() const;
+
+  using RecordCallback = std::function< void( std::string_view ) >;
+  // 按写入顺序遍历 ring 文件里的全部完整记录, 文件无效返回false
+  static bool ReadAll( const std::string& path, const RecordCallback& cb );
+
+  static const size_t kHeaderSize = 4096;
+
+private:
+  struct FileHeader;
+  struct RecordHeader;
+
+  void AppendUnlocked( const char* logline, size_t len );
+  void AppendRecord( const char* data, size_t len );
+  void Reserve( uint64_t end );
+
+  const std::string           filename;
+  int                         fd_;
+  size_t                      capacity_;
+  char*                       base_;
+  FileHeader*                 header_;
+  char*                       data_;
+  std::optional< std::mutex > mutex_;
+};
+
+}  // namespace rnet::log
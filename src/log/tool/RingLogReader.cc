@@ -0,0 +1,18 @@
+// 按写入顺序打印 RingLogFile 里的日志, 进程崩溃后也可以使用
+// usage: ring_log_reader <file.ring>
+#include <cstdio>
+
+#include "log/RingLogFile.h"
+
+int main( int argc, char* argv[] ) {
+  if ( argc != 2 ) {
+    fprintf( stderr, "usage: %s <file.ring>\n", argv[ 0 ] );
+    return 1;
+  }
+  bool ok = rnet::log::RingLogFile::ReadAll( argv[ 1 ], []( std::string_view record ) { ::fwrite( record.data(), 1, record.size(), stdout ); } );
+  if ( !ok ) {
+    fprintf( stderr, "%s: invalid or corrupted ring file\n", argv[ 1 ] );
+    return 1;
+  }
+  return 0;
+}
@@ -2,6 +2,7 @@
 #include "network/Acceptor.h"
 
 #include <fcntl.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -11,13 +12,49 @@
 #include "log/Logger.h"
 #include "network/NetAddress.h"
 #include "network/SocketOps.h"
+#include "network/UnixAddress.h"
 namespace rnet::network {
+namespace {
+// 只删除没有人在监听的 socket 文件. 路径上是普通文件或者还有服务在监听时
+// 直接退出, 不能误删别人的文件或者抢走正在运行的服务的地址
+void RemoveStaleSocket(const UnixAddress& addr, int type) {
+  std::string path = addr.ToString();
+  struct stat st;
+  if (::lstat(path.c_str(), &st) < 0) {
+    if (errno != ENOENT) {
+      LOG_SYSFATAL << "Acceptor - lstat " << path;
+    }
+    return;
+  }
+  if (!S_ISSOCK(st.st_mode)) {
+    LOG_FATAL << "Acceptor - " << path << " exists and is not a socket";
+  }
+  // 非阻塞地试连一次: 只有 ECONNREFUSED 说明没有进程在监听
+  int probe = ::socket(AF_UNIX, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (probe < 0) {
+    LOG_SYSFATAL << "Acceptor - probe socket";
+  }
+  int ret = ::connect(probe, addr.GetSockAddr(), addr.Length());
+  int savedErrno = errno;
+  ::close(probe);
+  if (ret == 0 || savedErrno != ECONNREFUSED) {
+    errno = ret == 0 ? EADDRINUSE : savedErrno;
+    LOG_SYSFATAL << "Acceptor - " << path << " is in use";
+  }
+  if (::unlink(path.c_str()) < 0) {
+    LOG_SYSFATAL << "Acceptor - unlink " << path;
+  }
+  LOG_INFO << "Acceptor - removed stale socket " << path;
+}
+}  // namespace
+
 Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr,
                    bool reuseport)
     : loop_(loop),
       acceptSocket_(sockets::CreateNonblockingOrDie(listenAddr.Family())),
       acceptChannel_(loop, acceptSocket_.Fd()),
       listening_(false),
+      acceptBatch_(kDefaultAcceptBatch),
       idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
   assert(idleFd_ >= 0);
   acceptSocket_.SetReuseAddr(true);
@@ -26,6 +63,36 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr,
   acceptChannel_.SetReadCallback(std::bind(&::rnet::network::Acceptor::HandleRead, this));
 }
 
+Acceptor::Acceptor(EventLoop* loop, const UnixAddress& listenAddr, int type)
+    : loop_(loop),
+      acceptSocket_(sockets::CreateUnixNonblockingOrDie(type)),
+      acceptChannel_(loop, acceptSocket_.Fd()),
+      listening_(false),
+      acceptBatch_(kDefaultAcceptBatch),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
+  assert(idleFd_ >= 0);
+  if (!listenAddr.Abstract()) {
+    RemoveStaleSocket(listenAddr, type);
+  }
+  acceptSocket_.BindAddress(listenAddr);
+  acceptChannel_.SetReadCallback(std::bind(&::rnet::network::Acceptor::HandleRead, this));
+}
+
+Acceptor::Acceptor(EventLoop* loop, int listenFd)
+    : loop_(loop),
+      acceptSocket_(listenFd),
+      acceptChannel_(loop, acceptSocket_.Fd()),
+      listening_(false),
+      acceptBatch_(kDefaultAcceptBatch),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
+  assert(idleFd_ >= 0);
+  // 继承来的 fd 不一定是非阻塞的, accept4 只设置新连接的标志
+  int flags = ::fcntl(listenFd, F_GETFL, 0);
+  ::fcntl(listenFd, F_SETFL, flags | O_NONBLOCK);
+  ::fcntl(listenFd, F_SETFD, FD_CLOEXEC);
+  acceptChannel_.SetReadCallback(std::bind(&::rnet::network::Acceptor::HandleRead, this));
+}
+
 Acceptor::~Acceptor() {
   acceptChannel_.DisableAll();
   acceptChannel_.Remove();
@@ -39,30 +106,47 @@ void Acceptor::Listen() {
   acceptChannel_.EnableReading();
 }
 
+// 一次可读事件里连续 accept 直到 EAGAIN 或达到 acceptBatch_,
+// SYN 突发时不必每个连接都等一轮 epoll_wait
 void Acceptor::HandleRead() {
   loop_->AssertInLoopThread();
-  InetAddress peerAddr;
-  // FIXME loop until no more
-  int connfd = acceptSocket_.Accept(&peerAddr);
-  if (connfd >= 0) {
-    // string hostport = peerAddr.ToIpPort();
-    // LOG_TRACE << "Accepts of " << hostport;
-    if (newConnectionCallback_) {
-      newConnectionCallback_(connfd, peerAddr);
-    } else {
-      sockets::Close(connfd);
+  for (int i = 0; i < acceptBatch_; ++i) {
+    InetAddress peerAddr;
+    int connfd = acceptSocket_.Accept(&peerAddr);
+    if (connfd >= 0) {
+      // string hostport = peerAddr.ToIpPort();
+      // LOG_TRACE << "Accepts of " << hostport;
+      if (newConnectionsCallback_) {
+        accepted_.push_back({connfd, peerAddr});
+      } else if (newConnectionCallback_) {
+        newConnectionCallback_(connfd, peerAddr);
+      } else {
+        sockets::Close(connfd);
+      }
+      continue;
+    }
+
+    int savedErrno = errno;
+    if (savedErrno == ECONNABORTED || savedErrno == EINTR ||
+        savedErrno == EPROTO || savedErrno == EPERM) {
+      // 只影响这一个连接, 继续 accept 后面的
+      continue;
     }
-  } else {
-    LOG_SYSERR << "in Acceptor::handleRead";
     // Read the section named "The special problem of
     // accept()ing when you can't" in libev's doc.
     // By Marc Lehmann, author of libev.
-    if (errno == EMFILE) {
+    if (savedErrno == EMFILE) {
       ::close(idleFd_);
       idleFd_ = ::accept(acceptSocket_.Fd(), nullptr, nullptr);
       ::close(idleFd_);
       idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
     }
+    break;
+  }
+
+  if (!accepted_.empty()) {
+    newConnectionsCallback_(&accepted_);
+    accepted_.clear();
   }
 }
 
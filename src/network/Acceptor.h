@@ -1,24 +1,57 @@
 #pragma once
+#include <algorithm>
 #include <functional>
+#include <vector>
 
 #include "base/Common.h"
 #include "network/Channel.h"
+#include "network/NetAddress.h"
 #include "network/Socket.h"
 namespace rnet::network {
 class EventLoop;
-class InetAddress;
+class UnixAddress;
+
+struct AcceptedConnection {
+  int sockfd;
+  InetAddress peerAddr;
+};
+
 class Acceptor : Noncopyable {
  public:
   using NewConnectionCallback = std::function<void(int, const InetAddress&)>;
+  // 一次可读事件中 accept 到的全部连接, 回调可以取走 vector 中的元素
+  using NewConnectionsCallback =
+      std::function<void(std::vector<AcceptedConnection>*)>;
+
+  static const int kDefaultAcceptBatch = 32;
 
   Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
+  // AF_UNIX, type 为 SOCK_STREAM 或 SOCK_SEQPACKET.
+  // 文件系统路径上残留的 (没有进程在监听的) socket 文件会先删除, 路径被占用时退出;
+  // 析构时不删除, 热重启时新进程还要用
+  Acceptor(EventLoop* loop, const UnixAddress& listenAddr, int type);
+  // 接管一个已经 bind 并 listen 的 socket, 例如热重启时从旧进程继承的
+  Acceptor(EventLoop* loop, int listenFd);
   ~Acceptor();
   void SetNewConnectionCallback(const NewConnectionCallback& cb) {
     newConnectionCallback_ = cb;
   }
+  // 设置后代替逐个调用的 NewConnectionCallback
+  void SetNewConnectionsCallback(const NewConnectionsCallback& cb) {
+    newConnectionsCallback_ = cb;
+  }
+  // 一次可读事件最多 accept 的连接数, 剩余的留到下一轮 epoll (水平触发).
+  // 至少为 1, 否则监听 socket 一直可读而 loop 空转
+  void SetAcceptBatch(int batch) { acceptBatch_ = std::max(batch, 1); }
   void Listen();
 
   bool Listening() const { return listening_; }
+  int Fd() const { return acceptSocket_.Fd(); }
+
+  // 只在 SO_REUSEPORT 组内的任意一个 acceptor 上调用一次
+  bool AttachReusePortCpuFilter(uint32_t groupSize) {
+    return acceptSocket_.AttachReusePortCpuFilter(groupSize);
+  }
 
  private:
   void HandleRead();
@@ -27,7 +60,10 @@ class Acceptor : Noncopyable {
   Socket acceptSocket_;
   Channel acceptChannel_;
   NewConnectionCallback newConnectionCallback_;
+  NewConnectionsCallback newConnectionsCallback_;
   bool listening_;
+  int acceptBatch_;
+  std::vector<AcceptedConnection> accepted_;
   int idleFd_;
 };
 }  // namespace rnet::Network
\ No newline at end of file
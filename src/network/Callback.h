@@ -31,4 +31,4 @@ void DefaultConnectionCallback(const TcpConnectionPtr &conn);
 void DefaultMessageCallback(const TcpConnectionPtr &conn, file::Buffer *buffer,
                             Unix::Timestamp receiveTime);
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
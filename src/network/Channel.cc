@@ -12,7 +12,7 @@ namespace rnet::network {
 const int Channel::kNoneEvent = 0;
 const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;
 const int Channel::kWriteEvent = EPOLLOUT;
-Channel::Channel(EventLoop* loop, int fd) : loop_(loop), fd(fd) {}
+Channel::Channel(EventLoop* loop, int fdArg) : loop_(loop), fd(fdArg) {}
 
 Channel::~Channel() {
   assert(!eventHandling_);
@@ -32,13 +32,13 @@ void Channel::Update() {
   loop_->UpdateChannel(this);
 }
 
-void Channel::remove() {
+void Channel::Remove() {
   assert(IsNoneEvent());
   addedToLoop_ = false;
   loop_->RemoveChannel(this);
 }
 
-void Channel::handleEvent(Unix::Timestamp receiveTime) {
+void Channel::HandleEvent(Unix::Timestamp receiveTime) {
   std::shared_ptr<void> guard;
   if (tied_) {
     guard = tie_.lock();
@@ -55,14 +55,14 @@ void Channel::HandleEventWithGuard(Unix::Timestamp receiveTime) {
   LOG_TRACE << ReventsToString();
   if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN)) {
     if (logHup_) {
-      LOG_WARN << "fd = " << fd_ << " Channel::handle_event() POLLHUP";
+      LOG_WARN << "fd = " << fd << " Channel::handle_event() POLLHUP";
     }
     if (closeCallback_) { closeCallback_();
 }
   }
 
   //   if (revents_ & POLLNVAL) {
-  //     LOG_WARN << "fd = " << fd_ << " Channel::handle_event() POLLNVAL";
+  //     LOG_WARN << "fd = " << fd << " Channel::handle_event() POLLNVAL";
   //   }
 
   if (revents_ & (EPOLLERR)) {
@@ -80,15 +80,15 @@ void Channel::HandleEventWithGuard(Unix::Timestamp receiveTime) {
   eventHandling_ = false;
 }
 
-std::string Channel::reventsToString() const {
-  return eventsToString(fd_, revents_);
+std::string Channel::ReventsToString() const {
+  return EventsToString(fd, revents_);
 }
 
-std::string Channel::eventsToString() const {
-  return eventsToString(fd_, events_);
+std::string Channel::EventsToString() const {
+  return EventsToString(fd, events_);
 }
 
-std::string Channel::eventsToString(int fd, int ev) {
+std::string Channel::EventsToString(int fd, int ev) {
   std::ostringstream oss;
   oss << fd << ": ";
   if (ev & EPOLLIN) { oss << "IN ";
@@ -109,4 +109,4 @@ std::string Channel::eventsToString(int fd, int ev) {
   return oss.str();
 }
 
-}  // namespace rnet::Network
+}  // namespace rnet::network
@@ -99,4 +99,4 @@ class Channel : Noncopyable {
   EventCallback errorCallback_;
 };
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
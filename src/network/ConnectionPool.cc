@@ -0,0 +1,179 @@
+#include "network/ConnectionPool.h"
+
+#include <cassert>
+
+#include "log/Logger.h"
+#include "network/EventLoop.h"
+#include "network/TcpClient.h"
+#include "network/TcpConnection.h"
+
+using namespace rnet;
+namespace rnet::network {
+
+ConnectionPool::ConnectionPool(EventLoop* loop, const InetAddress& serverAddr,
+                               const std::string& nameArg,
+                               const Options& options)
+    : loop_(CHECK_NOTNULL(loop)),
+      serverAddr_(serverAddr),
+      name(nameArg),
+      options_(options),
+      connectionCallback_(DefaultConnectionCallback),
+      messageCallback_(DefaultMessageCallback),
+      nextMemberId_(0),
+      started_(false) {
+  assert(options_.minSize <= options_.maxSize && options_.maxSize > 0);
+}
+
+ConnectionPool::~ConnectionPool() {
+  loop_->AssertInLoopThread();
+  Stop();
+}
+
+void ConnectionPool::Start() {
+  loop_->AssertInLoopThread();
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  while (members_.size() < options_.minSize) {
+    AddMember();
+  }
+  if (options_.healthCheckInterval > 0) {
+    healthTimer_ =
+        loop_->RunEvery(options_.healthCheckInterval, [this] { CheckHealth(); });
+  }
+}
+
+void ConnectionPool::Stop() {
+  loop_->AssertInLoopThread();
+  if (!started_) {
+    return;
+  }
+  started_ = false;
+  loop_->Cancel(healthTimer_);
+  while (!members_.empty()) {
+    RemoveMember(members_.size() - 1);
+  }
+}
+
+// 线性扫描: 池通常只有几个到几十个连接, 比维护堆更快
+TcpConnectionPtr ConnectionPool::Acquire() {
+  loop_->AssertInLoopThread();
+  Member* best = nullptr;
+  for (const auto& member : members_) {
+    if (member->conn &&
+        (best == nullptr || member->outstanding < best->outstanding)) {
+      best = member.get();
+    }
+  }
+  if (started_ && members_.size() < options_.maxSize &&
+      (best == nullptr || best->outstanding >= options_.growThreshold) &&
+      members_.size() == ConnectedCount()) {
+    // 已有的连接都忙并且没有正在建立的连接时才扩容
+    AddMember();
+  }
+  if (best == nullptr) {
+    return TcpConnectionPtr();
+  }
+  ++best->outstanding;
+  best->lastUsed = loop_->PollReturnTime();
+  return best->conn;
+}
+
+void ConnectionPool::Release(const TcpConnectionPtr& conn) {
+  loop_->AssertInLoopThread();
+  Member* member = FindMember(conn);
+  if (member != nullptr && member->outstanding > 0) {
+    --member->outstanding;
+    member->lastUsed = loop_->PollReturnTime();
+  }
+}
+
+size_t ConnectionPool::ConnectedCount() const {
+  size_t count = 0;
+  for (const auto& member : members_) {
+    if (member->conn) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+int ConnectionPool::Outstanding(const TcpConnectionPtr& conn) const {
+  Member* member = FindMember(conn);
+  return member == nullptr ? 0 : member->outstanding;
+}
+
+void ConnectionPool::AddMember() {
+  auto member = std::make_unique<Member>();
+  Member* raw = member.get();
+  member->client = std::make_unique<TcpClient>(
+      loop_, serverAddr_, name + "-" + std::to_string(nextMemberId_++));
+  member->client->EnableRetry();
+  member->client->SetConnectionCallback(
+      [this, raw](const TcpConnectionPtr& conn) { OnConnection(raw, conn); });
+  member->client->SetMessageCallback(messageCallback_);
+  member->lastUsed = Unix::Timestamp::Now();
+  members_.push_back(std::move(member));
+  raw->client->Connect();
+}
+
+// 回调里捕获了 Member, 销毁之前先断开
+void ConnectionPool::RemoveMember(size_t index) {
+  std::unique_ptr<Member> member = std::move(members_[index]);
+  members_[index] = std::move(members_.back());
+  members_.pop_back();
+  if (member->conn) {
+    member->conn->SetConnectionCallback(connectionCallback_);
+    member->conn.reset();
+  }
+  member->client->Stop();
+  member->client->Disconnect();
+}
+
+void ConnectionPool::OnConnection(Member* member, const TcpConnectionPtr& conn) {
+  if (conn->Connected()) {
+    member->conn = conn;
+    member->lastUsed = loop_->PollReturnTime();
+  } else {
+    member->conn.reset();
+    member->outstanding = 0;
+  }
+  connectionCallback_(conn);
+}
+
+ConnectionPool::Member* ConnectionPool::FindMember(
+    const TcpConnectionPtr& conn) const {
+  for (const auto& member : members_) {
+    if (member->conn == conn) {
+      return member.get();
+    }
+  }
+  return nullptr;
+}
+
+// 关闭检查失败的连接(TcpClient 会重连), 收缩空闲太久的连接
+void ConnectionPool::CheckHealth() {
+  Unix::Timestamp now = Unix::Timestamp::Now();
+  for (size_t i = members_.size(); i-- > 0;) {
+    Member* member = members_[i].get();
+    if (!member->conn) {
+      continue;
+    }
+    if (healthCheck_ && !healthCheck_(member->conn)) {
+      LOG_WARN << "ConnectionPool [" << name << "] - unhealthy connection "
+               << member->conn->Name();
+      member->conn->ForceClose();
+      continue;
+    }
+    if (options_.idleTimeout > 0 && members_.size() > options_.minSize &&
+        member->outstanding == 0 &&
+        Unix::TimeDifference(now, member->lastUsed) > options_.idleTimeout) {
+      LOG_DEBUG << "ConnectionPool [" << name << "] - close idle connection "
+                << member->conn->Name();
+      RemoveMember(i);
+    }
+  }
+}
+
+}  // namespace rnet::network
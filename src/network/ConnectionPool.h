@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/Common.h"
+#include "network/Callback.h"
+#include "network/NetAddress.h"
+#include "network/TimerId.h"
+#include "unix/Time.h"
+namespace rnet::network {
+
+class EventLoop;
+class TcpClient;
+
+// 一个 loop 内到同一个上游的长连接池, 所有操作都在 loop 线程, 不加锁
+// 每个 io loop 各建一个(例如在 ThreadInitCallback 中), 连接不跨线程共享,
+// 请求不再为建连付出握手的延迟
+class ConnectionPool : Noncopyable {
+ public:
+  struct Options {
+    // Start 时预先建立的连接数, 也是空闲收缩的下限
+    size_t minSize = 1;
+    size_t maxSize = 8;
+    // 所有已连接连接的未完成请求数都达到这个值时, 再建立一个连接
+    int growThreshold = 1;
+    // 健康检查的间隔(秒), 0 表示不检查
+    double healthCheckInterval = 5.0;
+    // 超过 minSize 的连接空闲这么久(秒)后关闭, 0 表示不收缩
+    double idleTimeout = 60.0;
+  };
+  // 返回 false 的连接被关闭, 由 TcpClient 重连
+  using HealthCheck = std::function<bool(const TcpConnectionPtr&)>;
+
+  ConnectionPool(EventLoop* loop, const InetAddress& serverAddr,
+                 const std::string& nameArg, const Options& options);
+  ~ConnectionPool();
+
+  /// 在 Start 之前设置
+  void SetConnectionCallback(ConnectionCallback cb) {
+    connectionCallback_ = std::move(cb);
+  }
+  void SetMessageCallback(MessageCallback cb) {
+    messageCallback_ = std::move(cb);
+  }
+  void SetHealthCheck(HealthCheck cb) { healthCheck_ = std::move(cb); }
+
+  // 预热: 建立 minSize 个连接, 开始健康检查
+  void Start();
+  void Stop();
+
+  // 返回未完成请求最少的已连接连接, 并把它的未完成请求数加一
+  // 没有已连接的连接时返回空, 需要时顺带发起新的连接
+  TcpConnectionPtr Acquire();
+  // 一个请求结束(收到响应或者放弃), 和 Acquire 配对
+  void Release(const TcpConnectionPtr& conn);
+
+  // 包括正在连接的
+  size_t Size() const { return members_.size(); }
+  size_t ConnectedCount() const;
+  // 连接断开时它的未完成请求数清零
+  int Outstanding(const TcpConnectionPtr& conn) const;
+
+  const std::string& Name() const { return name; }
+
+ private:
+  struct Member {
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr conn;  // 已连接时有效
+    int outstanding = 0;
+    Unix::Timestamp lastUsed;
+  };
+
+  void AddMember();
+  void RemoveMember(size_t index);
+  void OnConnection(Member* member, const TcpConnectionPtr& conn);
+  Member* FindMember(const TcpConnectionPtr& conn) const;
+  void CheckHealth();
+
+  EventLoop* loop_;
+  const InetAddress serverAddr_;
+  const std::string name;
+  const Options options_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  HealthCheck healthCheck_;
+  std::vector<std::unique_ptr<Member>> members_;
+  int nextMemberId_;
+  bool started_;
+  TimerId healthTimer_;
+};
+
+}  // namespace rnet::network
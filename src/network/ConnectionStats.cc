@@ -0,0 +1,119 @@
+#include "network/ConnectionStats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <cstdio>
+
+#include "network/TcpConnection.h"
+
+namespace rnet::network {
+
+int64_t ConnectionStats::HighWaterMarkUs(Unix::Timestamp now) const {
+  if (!highWaterSince.Valid()) {
+    return highWaterMarkUs;
+  }
+  return highWaterMarkUs + now.MicroSecondsSinceEpoch() -
+         highWaterSince.MicroSecondsSinceEpoch();
+}
+
+std::string ConnectionStats::ToString() const {
+  char buf[512];
+  snprintf(buf, sizeof buf,
+           "bytes_in=%" PRIu64 " bytes_out=%" PRIu64 " msgs_in=%" PRIu64
+           " msgs_out=%" PRIu64 " reads=%" PRIu64 " writes=%" PRIu64
+           " write_stalls=%" PRIu64 " read_pauses=%" PRIu64
+           " high_water_us=%" PRId64
+           " rtt_us=%u rttvar_us=%u cwnd=%u total_retrans=%u",
+           bytesReceived, bytesSent, messagesReceived, messagesSent, readCalls,
+           writeCalls, writeStalls, readPauses, HighWaterMarkUs(Unix::Timestamp::Now()),
+           rttUs, rttVarUs, cwnd, totalRetrans);
+  return buf;
+}
+
+void ConnectionSet::Add(TcpConnection* conn, size_t* slot) {
+  assert(*slot == kNoSlot);
+  *slot = conns_.size();
+  conns_.emplace_back(conn, slot);
+}
+
+// 最后一个连接移到空出的位置
+void ConnectionSet::Remove(size_t* slot) {
+  size_t i = *slot;
+  assert(i < conns_.size() && conns_[i].second == slot);
+  conns_[i] = conns_.back();
+  *conns_[i].second = i;
+  conns_.pop_back();
+  *slot = kNoSlot;
+}
+
+// ReleaseByLoop 会把自己从集合中删掉
+void ConnectionSet::ReleaseAll() {
+  while (!conns_.empty()) {
+    conns_.back().first->ReleaseByLoop();
+  }
+}
+
+void ConnectionSet::SampleTcpInfo() {
+  for (auto& item : conns_) {
+    item.first->SampleTcpInfo();
+  }
+}
+
+std::vector<ConnectionSample> ConnectionSet::Top(size_t n, SortKey key) const {
+  Unix::Timestamp now = Unix::Timestamp::Now();
+  auto value = [key, now](const ConnectionStats& stats) -> uint64_t {
+    switch (key) {
+      case kBytesSent:
+        return stats.bytesSent;
+      case kBytesReceived:
+        return stats.bytesReceived;
+      case kHighWaterMark:
+        return static_cast<uint64_t>(stats.HighWaterMarkUs(now));
+      case kRetrans:
+        return stats.totalRetrans;
+      case kRtt:
+        return stats.rttUs;
+      case kBytesTotal:
+      default:
+        return stats.bytesSent + stats.bytesReceived;
+    }
+  };
+
+  // 先只对指针做部分排序, 最后再复制前 n 个
+  std::vector<const TcpConnection*> conns;
+  conns.reserve(conns_.size());
+  for (const auto& item : conns_) {
+    conns.push_back(item.first);
+  }
+  n = std::min(n, conns.size());
+  std::partial_sort(conns.begin(), conns.begin() + static_cast<ptrdiff_t>(n),
+                    conns.end(),
+                    [&value](const TcpConnection* a, const TcpConnection* b) {
+                      return value(a->Stats()) > value(b->Stats());
+                    });
+
+  std::vector<ConnectionSample> result;
+  result.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    result.push_back(
+        {conns[i]->Name(), conns[i]->PeerAddress(), conns[i]->Stats()});
+  }
+  return result;
+}
+
+std::string ConnectionSet::ToString(
+    const std::vector<ConnectionSample>& samples) {
+  std::string result;
+  for (const auto& sample : samples) {
+    result += sample.name;
+    result += ' ';
+    result += sample.peerAddr.ToIpPort();
+    result += ' ';
+    result += sample.stats.ToString();
+    result += '\n';
+  }
+  return result;
+}
+
+}  // namespace rnet::network
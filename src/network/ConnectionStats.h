@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/Common.h"
+#include "network/NetAddress.h"
+#include "unix/Time.h"
+
+namespace rnet::network {
+
+class TcpConnection;
+
+// 单个连接的计数, 只在连接所在的 loop 线程更新和读取, 都是普通变量
+struct ConnectionStats {
+  Unix::Timestamp creationTime;
+  Unix::Timestamp lastReceiveTime;
+  uint64_t bytesReceived = 0;
+  uint64_t bytesSent = 0;
+  // 触发 MessageCallback 的次数和调用 Send 的次数
+  uint64_t messagesReceived = 0;
+  uint64_t messagesSent = 0;
+  // read/write 系统调用次数
+  uint64_t readCalls = 0;
+  uint64_t writeCalls = 0;
+  // 内核发送缓冲区写满, outputBuffer 由空变为非空的次数
+  uint64_t writeStalls = 0;
+  // 因为背压暂停读的次数
+  uint64_t readPauses = 0;
+  // outputBuffer 超过高水位的累计时间, 不包括正在进行的一段
+  int64_t highWaterMarkUs = 0;
+  // 当前这段高水位的开始时间, 不在高水位时无效
+  Unix::Timestamp highWaterSince;
+  // 最近一次 TCP_INFO 采样, 采样前都是 0
+  Unix::Timestamp tcpInfoTime;
+  uint32_t rttUs = 0;
+  uint32_t rttVarUs = 0;
+  uint32_t cwnd = 0;
+  uint32_t totalRetrans = 0;
+
+  // 包括正在进行的一段
+  int64_t HighWaterMarkUs(Unix::Timestamp now) const;
+  std::string ToString() const;
+};
+
+// 连接统计的快照, 可以带出 loop 线程
+struct ConnectionSample {
+  std::string name;
+  InetAddress peerAddr;
+  ConnectionStats stats;
+};
+
+// 一个 loop 上已建立的连接, 增删 O(1), 不为每个连接分配节点
+// 只能在 loop 线程访问
+class ConnectionSet : Noncopyable {
+ public:
+  static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+  enum SortKey {
+    kBytesTotal,
+    kBytesSent,
+    kBytesReceived,
+    kHighWaterMark,
+    kRetrans,
+    kRtt,
+  };
+
+  // slot 由连接持有, 记录连接在集合中的位置, 删除时用来定位
+  void Add(TcpConnection* conn, size_t* slot);
+  void Remove(size_t* slot);
+  size_t Size() const { return conns_.size(); }
+  // loop 析构时调用, 释放所有还没有 ConnectDestroyed 的连接
+  void ReleaseAll();
+
+  // 对所有连接采样一次 TCP_INFO
+  void SampleTcpInfo();
+  // 按 key 从大到小排列的前 n 个连接
+  std::vector<ConnectionSample> Top(size_t n, SortKey key) const;
+  // 每个连接一行
+  static std::string ToString(const std::vector<ConnectionSample>& samples);
+
+ private:
+  std::vector<std::pair<TcpConnection*, size_t*>> conns_;
+};
+
+}  // namespace rnet::network
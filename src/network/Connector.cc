@@ -1,36 +1,90 @@
 #include "network/Connector.h"
 
+#include <algorithm>
+
 #include "log/Logger.h"
+#include "network/Channel.h"
 #include "network/EventLoop.h"
+#include "network/SocketOps.h"
 #include "unix/Thread.h"
 
 namespace rnet::network {
 const int Connector::kMaxRetryDelayMs;
 
+namespace {
+
+// RFC 8305: 第一个地址的族优先, 之后两个族交替, 族内保持原来的顺序
+std::vector<InetAddress> InterleaveFamilies(
+    const std::vector<InetAddress>& addrs) {
+  std::vector<InetAddress> first;
+  std::vector<InetAddress> second;
+  for (const auto& addr : addrs) {
+    (addr.Family() == addrs.front().Family() ? first : second).push_back(addr);
+  }
+  std::vector<InetAddress> result;
+  result.reserve(addrs.size());
+  for (size_t i = 0; i < first.size() || i < second.size(); ++i) {
+    if (i < first.size()) {
+      result.push_back(first[i]);
+    }
+    if (i < second.size()) {
+      result.push_back(second[i]);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
 Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
+    : Connector(loop, std::vector<InetAddress>{serverAddr}) {}
+
+Connector::Connector(EventLoop* loop,
+                     const std::vector<InetAddress>& serverAddrs)
     : loop_(loop),
-      serverAddr_(serverAddr),
+      serverAddrs_(InterleaveFamilies(serverAddrs)),
+      unixType_(0),
       connect_(false),
       state_(kDisconnected),
+      nextIndex_(0),
+      connectedIndex_(0),
+      retryable_(false),
+      attemptDelay_(kDefaultAttemptDelay),
+      fastOpen_(false),
       retryDelayMs_(kInitRetryDelayMs) {
+  assert(!serverAddrs_.empty());
   LOG_DEBUG << "ctor[" << this << "]";
 }
 
+// serverAddrs_ 里只放一个 AF_UNIX 的占位地址, 按一个候选地址走同样的流程
+Connector::Connector(EventLoop* loop, const UnixAddress& serverAddr, int type)
+    : Connector(loop, UnixAddress::AsInetAddress()) {
+  unixAddr_ = serverAddr;
+  unixType_ = type;
+}
+
 Connector::~Connector() {
   LOG_DEBUG << "dtor[" << this << "]";
-  assert(!channel_);
+  assert(attempts_.empty());
+}
+
+std::string Connector::Target(size_t index) const {
+  return unixAddr_ ? unixAddr_->ToString() : serverAddrs_[index].ToIpPort();
 }
 
 void Connector::Start() {
   connect_ = true;
-  loop_->runInLoop(std::bind(&Connector::startInLoop, this));  // FIXME: unsafe
+  loop_->RunInLoop(std::bind(&Connector::StartInLoop, this));  // FIXME: unsafe
 }
 
 void Connector::StartInLoop() {
   loop_->AssertInLoopThread();
   assert(state_ == kDisconnected);
   if (connect_) {
-    connect();
+    SetState(kConnecting);
+    nextIndex_ = 0;
+    retryable_ = false;
+    ConnectNext();
   } else {
     LOG_DEBUG << "do not connect";
   }
@@ -38,141 +92,220 @@ void Connector::StartInLoop() {
 
 void Connector::Stop() {
   connect_ = false;
-  loop_->queueInLoop(std::bind(&Connector::stopInLoop, this));  // FIXME: unsafe
-  // FIXME: cancel timer
+  // 持有自身的引用, TcpClient 可能在 StopInLoop 执行前就被销毁
+  loop_->QueueInLoop(
+      std::bind(&Connector::StopInLoop, shared_from_this()));
 }
 
+// 取消等待中的重连, 正在进行的连接直接放弃
 void Connector::StopInLoop() {
   loop_->AssertInLoopThread();
+  loop_->Cancel(retryTimer_);
+  loop_->Cancel(attemptTimer_);
   if (state_ == kConnecting) {
-    setState(kDisconnected);
-    int sockfd = removeAndResetChannel();
-    retry(sockfd);
+    SetState(kDisconnected);
+    AbortAttempts();
   }
 }
 
-void Connector::Connect() {
-  int sockfd = Sockets::createNonblockingOrDie(serverAddr_.family());
-  int ret = Sockets::connect(sockfd, serverAddr_.getSockAddr());
-  int savedErrno = (ret == 0) ? 0 : errno;
-  switch (savedErrno) {
-    case 0:
-    case EINPROGRESS:
-    case EINTR:
-    case EISCONN:
-      connecting(sockfd);
-      break;
-
-    case EAGAIN:
-    case EADDRINUSE:
-    case EADDRNOTAVAIL:
-    case ECONNREFUSED:
-    case ENETUNREACH:
-      retry(sockfd);
-      break;
-
-    case EACCES:
-    case EPERM:
-    case EAFNOSUPPORT:
-    case EALREADY:
-    case EBADF:
-    case EFAULT:
-    case ENOTSOCK:
-      LOG_SYSERR << "connect error in Connector::startInLoop " << savedErrno;
-      Sockets::close(sockfd);
-      break;
-
-    default:
-      LOG_SYSERR << "Unexpected error in Connector::startInLoop " << savedErrno;
-      Sockets::close(sockfd);
-      // connectErrorCallback_();
-      break;
+// 发起下一个地址的连接; 立即失败的地址直接跳过
+// 还有地址没有尝试时, attemptDelay 后继续, 不等待当前尝试的结果
+void Connector::ConnectNext() {
+  loop_->Cancel(attemptTimer_);
+  while (state_ == kConnecting && nextIndex_ < serverAddrs_.size()) {
+    size_t index = nextIndex_++;
+    const InetAddress& addr = serverAddrs_[index];
+    int sockfd = unixAddr_ ? sockets::CreateUnixNonblockingOrDie(unixType_)
+                           : sockets::CreateNonblockingOrDie(addr.Family());
+    bool fastOpen =
+        !unixAddr_ && fastOpen_ && sockets::SetFastOpenConnect(sockfd);
+    int ret = unixAddr_ ? sockets::Connect(sockfd, unixAddr_->GetSockAddr(),
+                                           unixAddr_->Length())
+                        : sockets::Connect(sockfd, addr.GetSockAddr());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno) {
+      case 0:
+        if (fastOpen) {
+          // 已有 fast open cookie, 握手推迟到第一次发送
+          Connected(sockfd, index);
+          return;
+        }
+        [[fallthrough]];
+      case EINPROGRESS:
+      case EINTR:
+      case EISCONN:
+        Connecting(sockfd, index);
+        if (nextIndex_ < serverAddrs_.size()) {
+          attemptTimer_ =
+              loop_->RunAfter(attemptDelay_, std::bind(&Connector::ConnectNext,
+                                                       shared_from_this()));
+        }
+        return;
+
+      case EAGAIN:
+      case EADDRINUSE:
+      case EADDRNOTAVAIL:
+      case ECONNREFUSED:
+      case ENETUNREACH:
+      case ENOENT:  // unix socket 的路径还没有创建
+        LOG_DEBUG << "Connector::ConnectNext - " << Target(index) << " "
+                  << thread::GetErrnoMessage(savedErrno);
+        retryable_ = true;
+        sockets::Close(sockfd);
+        break;
+
+      case EACCES:
+      case EPERM:
+      case EAFNOSUPPORT:
+      case EALREADY:
+      case EBADF:
+      case EFAULT:
+      case ENOTSOCK:
+        LOG_SYSERR << "connect error in Connector::ConnectNext " << savedErrno;
+        sockets::Close(sockfd);
+        break;
+
+      default:
+        LOG_SYSERR << "Unexpected error in Connector::ConnectNext "
+                   << savedErrno;
+        sockets::Close(sockfd);
+        // connectErrorCallback_();
+        break;
+    }
+  }
+  if (state_ == kConnecting && attempts_.empty()) {
+    Retry();
   }
 }
 
 void Connector::Restart() {
   loop_->AssertInLoopThread();
-  setState(kDisconnected);
+  SetState(kDisconnected);
   retryDelayMs_ = kInitRetryDelayMs;
   connect_ = true;
-  startInLoop();
+  StartInLoop();
 }
 
-void Connector::Connecting(int sockfd) {
-  setState(kConnecting);
-  assert(!channel_);
-  channel_.reset(new Channel(loop_, sockfd));
-  channel_->setWriteCallback(
-      std::bind(&Connector::handleWrite, this));  // FIXME: unsafe
-  channel_->setErrorCallback(
-      std::bind(&Connector::handleError, this));  // FIXME: unsafe
+void Connector::Connecting(int sockfd, size_t index) {
+  attempts_.push_back({index, std::make_unique<Channel>(loop_, sockfd)});
+  Channel* channel = attempts_.back().channel.get();
+  channel->SetWriteCallback(
+      [this, channel] { HandleWrite(channel); });  // FIXME: unsafe
+  channel->SetErrorCallback(
+      [this, channel] { HandleError(channel); });  // FIXME: unsafe
 
   // channel_->tie(shared_from_this()); is not working,
   // as channel_ is not managed by shared_ptr
-  channel_->enableWriting();
+  channel->EnableWriting();
 }
 
-int Connector::RemoveAndResetChannel() {
-  channel_->disableAll();
-  channel_->remove();
-  int sockfd = channel_->Fd();
-  // Can't reset channel_ here, because we are inside Channel::handleEvent
-  loop_->queueInLoop(
-      std::bind(&Connector::resetChannel, this));  // FIXME: unsafe
-  return sockfd;
+// 第一个成功的连接胜出, 其余还在握手的连接直接关闭
+void Connector::Connected(int sockfd, size_t index) {
+  loop_->Cancel(attemptTimer_);
+  AbortAttempts();
+  connectedIndex_ = index;
+  SetState(kConnected);
+  if (connect_) {
+    newConnectionCallback_(sockfd);
+  } else {
+    sockets::Close(sockfd);
+  }
 }
 
-void Connector::ResetChannel() { channel_.reset(); }
+// 把正在处理事件的 channel 从本轮尝试中摘掉, 返回它的 fd
+// channel 已被 AbortAttempts 放弃(同一次 poll 中先处理了胜出的连接)时返回 false
+bool Connector::RemoveAttempt(Channel* channel, int* sockfd, size_t* index) {
+  auto it = std::find_if(attempts_.begin(), attempts_.end(),
+                         [channel](const Attempt& attempt) {
+                           return attempt.channel.get() == channel;
+                         });
+  if (it == attempts_.end()) {
+    return false;
+  }
+  channel->DisableAll();
+  channel->Remove();
+  *sockfd = channel->Fd();
+  *index = it->index;
+  // Can't reset channel here, because we are inside Channel::handleEvent
+  std::shared_ptr<Channel> dead(std::move(it->channel));
+  attempts_.erase(it);
+  loop_->QueueInLoop([dead] {});
+  return true;
+}
+
+// 其余的 channel 可能还在本次 poll 的活跃列表里, 这里只停止关注事件,
+// 从 poller 移除, 关闭 fd 和销毁都推迟到事件处理之后,
+// 以免 fd 被新的 socket 复用时 poller 里还留着旧的 channel
+void Connector::AbortAttempts() {
+  for (auto& attempt : attempts_) {
+    attempt.channel->DisableAll();
+    std::shared_ptr<Channel> dead(std::move(attempt.channel));
+    loop_->QueueInLoop([dead, self = shared_from_this()] {
+      dead->Remove();
+      sockets::Close(dead->Fd());
+    });
+  }
+  attempts_.clear();
+}
 
-void Connector::HandleWrite() {
+void Connector::HandleWrite(Channel* channel) {
   LOG_TRACE << "Connector::handleWrite " << state_;
 
-  if (state_ == kConnecting) {
-    int sockfd = removeAndResetChannel();
-    int err = Sockets::getSocketError(sockfd);
-    if (err) {
-      LOG_WARN << "Connector::handleWrite - SO_ERROR = " << err << " "
-               << Thread::getErrnoMessage(err);
-      retry(sockfd);
-    } else if (Sockets::isSelfConnect(sockfd)) {
-      LOG_WARN << "Connector::handleWrite - Self connect";
-      retry(sockfd);
-    } else {
-      setState(kConnected);
-      if (connect_) {
-        newConnectionCallback_(sockfd);
-      } else {
-        Sockets::close(sockfd);
-      }
-    }
+  int sockfd = -1;
+  size_t index = 0;
+  if (state_ != kConnecting || !RemoveAttempt(channel, &sockfd, &index)) {
+    return;
+  }
+  int err = sockets::GetSocketError(sockfd);
+  if (err) {
+    LOG_WARN << "Connector::handleWrite - " << Target(index)
+             << " SO_ERROR = " << err << " " << thread::GetErrnoMessage(err);
+    sockets::Close(sockfd);
+    AttemptFailed();
+  } else if (sockets::IsSelfConnect(sockfd)) {
+    LOG_WARN << "Connector::handleWrite - Self connect";
+    sockets::Close(sockfd);
+    AttemptFailed();
   } else {
-    // what happened?
-    assert(state_ == kDisconnected);
+    Connected(sockfd, index);
   }
 }
 
-void Connector::HandleError() {
+void Connector::HandleError(Channel* channel) {
   LOG_ERROR << "Connector::handleError state=" << state_;
-  if (state_ == kConnecting) {
-    int sockfd = removeAndResetChannel();
-    int err = Sockets::getSocketError(sockfd);
-    LOG_TRACE << "SO_ERROR = " << err << " " << Thread::getErrnoMessage(err);
-    retry(sockfd);
+  int sockfd = -1;
+  size_t index = 0;
+  if (state_ == kConnecting && RemoveAttempt(channel, &sockfd, &index)) {
+    int err = sockets::GetSocketError(sockfd);
+    LOG_TRACE << "SO_ERROR = " << err << " " << thread::GetErrnoMessage(err);
+    sockets::Close(sockfd);
+    AttemptFailed();
   }
 }
 
-void Connector::Retry(int  /*sockfd*/) {
-  Sockets::close(sockfd);
-  setState(kDisconnected);
-  if (connect_) {
+// 失败时不等错开的间隔, 立即尝试下一个地址
+void Connector::AttemptFailed() {
+  retryable_ = true;
+  if (nextIndex_ < serverAddrs_.size()) {
+    ConnectNext();
+  } else if (attempts_.empty()) {
+    Retry();
+  }
+}
+
+// 本轮所有地址都失败了
+void Connector::Retry() {
+  SetState(kDisconnected);
+  if (connect_ && retryable_) {
     LOG_INFO << "Connector::retry - Retry connecting to "
-             << serverAddr_.ToIpPort() << " in " << retryDelayMs_
+             << Target(0) << " in " << retryDelayMs_
              << " milliseconds. ";
-    loop_->runAfter(retryDelayMs_ / 1000.0,
-                    std::bind(&Connector::startInLoop, shared_from_this()));
+    retryTimer_ = loop_->RunAfter(
+        retryDelayMs_ / 1000.0,
+        std::bind(&Connector::StartInLoop, shared_from_this()));
     retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
   } else {
     LOG_DEBUG << "do not connect";
   }
 }
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
@@ -1,53 +1,100 @@
 #pragma once
 #include <functional>
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "base/Common.h"
 #include "network/NetAddress.h"
+#include "network/TimerId.h"
+#include "network/UnixAddress.h"
 namespace rnet::network {
 class Channel;
 class EventLoop;
 
+// 主动发起连接, 可以给出多个候选地址(多个副本, IPv4/IPv6 混合)
+// 候选地址按地址族交替排列, 依次错开 attemptDelay 发起连接(happy eyeballs),
+// 前一个尝试失败时立即开始下一个, 第一个成功的连接胜出, 其余的直接关闭
+// 全部失败后按指数退避重新开始一轮
 class Connector : Noncopyable, public std::enable_shared_from_this<Connector> {
  public:
   using NewConnectionCallback = std::function<void(int)>;
+  // RFC 8305 建议的 Connection Attempt Delay
+  static constexpr double kDefaultAttemptDelay = 0.25;
 
   Connector(EventLoop* loop, const InetAddress& serverAddr);
+  Connector(EventLoop* loop, const std::vector<InetAddress>& serverAddrs);
+  // 连接 unix socket, type 为 SOCK_STREAM 或 SOCK_SEQPACKET
+  // 路径还不存在或者没有人监听时按同样的退避策略重试
+  Connector(EventLoop* loop, const UnixAddress& serverAddr, int type);
   ~Connector();
 
   void SetNewConnectionCallback(const NewConnectionCallback& cb) {
     newConnectionCallback_ = cb;
   }
+  /// Not thread safe, set before Start.
+  void SetAttemptDelay(double seconds) { attemptDelay_ = seconds; }
+  /// 使用 TCP_FASTOPEN_CONNECT, 已有 cookie 时不等握手直接交出连接,
+  /// SYN 随第一次发送的数据一起发出. Not thread safe, set before Start.
+  void SetFastOpen(bool on) { fastOpen_ = on; }
 
   void Start();    // can be called in any thread
   void Restart();  // must be called in loop thread
   void Stop();     // can be called in any thread
 
-  const InetAddress& ServerAddress() const { return serverAddr_; }
+  // 最近一次连接成功的地址, 还没有成功过时是第一个候选地址
+  // 连接 unix socket 时地址族为 AF_UNIX, 见 UnixAddress::AsInetAddress
+  const InetAddress& ServerAddress() const {
+    return serverAddrs_[connectedIndex_];
+  }
+  // 交替排列之后的候选地址
+  const std::vector<InetAddress>& ServerAddresses() const {
+    return serverAddrs_;
+  }
 
  private:
   enum States { kDisconnected, kConnecting, kConnected };
   static const int kMaxRetryDelayMs = 30 * 1000;
   static const int kInitRetryDelayMs = 500;
 
+  // 一个进行中的连接尝试
+  struct Attempt {
+    size_t index;
+    std::unique_ptr<Channel> channel;
+  };
+
   void SetState(States s) { state_ = s; }
+  // 日志里显示的目标地址
+  std::string Target(size_t index) const;
   void StartInLoop();
   void StopInLoop();
-  void Connect();
-  void Connecting(int sockfd);
-  void HandleWrite();
-  void HandleError();
-  void Retry(int sockfd);
-  int RemoveAndResetChannel();
-  void ResetChannel();
+  void ConnectNext();
+  void Connecting(int sockfd, size_t index);
+  void Connected(int sockfd, size_t index);
+  void HandleWrite(Channel* channel);
+  void HandleError(Channel* channel);
+  void AttemptFailed();
+  void Retry();
+  bool RemoveAttempt(Channel* channel, int* sockfd, size_t* index);
+  void AbortAttempts();
 
   EventLoop* loop_;
-  InetAddress serverAddr_;
+  std::vector<InetAddress> serverAddrs_;
+  std::optional<UnixAddress> unixAddr_;
+  int unixType_;
   bool connect_;  // atomic
   States state_;  // FIXME: use atomic variable
-  std::unique_ptr<Channel> channel_;
+  std::vector<Attempt> attempts_;
+  size_t nextIndex_;       // 本轮下一个要尝试的地址
+  size_t connectedIndex_;  // 最近一次成功的地址
+  bool retryable_;         // 本轮是否有值得重试的失败
+  double attemptDelay_;
+  bool fastOpen_;
   NewConnectionCallback newConnectionCallback_;
   int retryDelayMs_;
+  TimerId retryTimer_;
+  TimerId attemptTimer_;
 };
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
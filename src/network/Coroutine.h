@@ -0,0 +1,263 @@
+#pragma once
+// C++20 协程接口, 用顺序的代码写协议处理, 代替 MessageCallback + context 状态机
+// 库本身按 C++17 编译, 这里全部是头文件实现, 只有使用者以 -std=c++20 编译时才生效
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "file/ConnBuffer.h"
+#include "log/Logger.h"
+#include "network/EventLoop.h"
+#include "network/TcpConnection.h"
+
+namespace rnet::network {
+
+namespace detail {
+// 协程帧的分配池. 一个线程一个 loop, 线程局部的池即每个 loop 一个池
+// 按 64 字节分级, 超过 kMaxPooledFrame 的帧直接走 operator new
+class FramePool : Noncopyable {
+ public:
+  static constexpr size_t kGranularity = 64;
+  static constexpr size_t kMaxPooledFrame = 4096;
+
+  static FramePool& Instance() {
+    thread_local FramePool pool;
+    return pool;
+  }
+
+  void* Allocate(size_t size) {
+    if (size > kMaxPooledFrame) {
+      return ::operator new(size);
+    }
+    std::vector<void*>& list = free_[ClassOf(size)];
+    if (list.empty()) {
+      return ::operator new(RoundUp(size));
+    }
+    void* p = list.back();
+    list.pop_back();
+    return p;
+  }
+
+  // 协程帧总是在它的 loop 线程中销毁, 归还到本线程的池里
+  void Deallocate(void* p, size_t size) {
+    if (size > kMaxPooledFrame) {
+      ::operator delete(p);
+      return;
+    }
+    free_[ClassOf(size)].push_back(p);
+  }
+
+  ~FramePool() {
+    for (auto& list : free_) {
+      for (void* p : list) {
+        ::operator delete(p);
+      }
+    }
+  }
+
+ private:
+  static size_t ClassOf(size_t size) {
+    return (size + kGranularity - 1) / kGranularity;
+  }
+  static size_t RoundUp(size_t size) { return ClassOf(size) * kGranularity; }
+
+  std::vector<void*> free_[kMaxPooledFrame / kGranularity + 1];
+};
+}  // namespace detail
+
+// 即发即忘的协程, 创建后立即执行到第一个挂起点, 结束时自动释放帧
+// 例如在 ConnectionCallback 里: if (conn->Connected()) Serve(conn);
+struct CoTask {
+  struct promise_type {
+    CoTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() {
+      try {
+        std::rethrow_exception(std::current_exception());
+      } catch (const std::exception& ex) {
+        LOG_FATAL << "unhandled exception in coroutine: " << ex.what();
+      } catch (...) {
+        LOG_FATAL << "unhandled exception in coroutine";
+      }
+    }
+
+    static void* operator new(size_t size) {
+      return detail::FramePool::Instance().Allocate(size);
+    }
+    static void operator delete(void* p, size_t size) {
+      detail::FramePool::Instance().Deallocate(p, size);
+    }
+  };
+};
+
+// TcpConnection 的协程视图, 只能在连接所在的 loop 线程中使用
+// 构造时接管连接的 message/writeComplete/connection 回调, 数据到达时
+// 在 Channel 的读回调里直接恢复等待的协程, 中间不经过 QueueInLoop.
+// 读协程只在它等待的数据到齐或者连接关闭时恢复
+// 数据直接在 TcpConnection 的 inputBuffer 中等待, 不另外缓存
+class CoConnection : Noncopyable {
+  struct State {
+    TcpConnectionPtr conn;
+    std::coroutine_handle<> reader;
+    std::coroutine_handle<> writer;
+    // 等待中的读取条件: delimiter 非空时等它出现, 否则等 readBytes 个字节
+    size_t readBytes = 0;
+    std::string_view delimiter;
+    bool closed = false;
+    bool detached = false;
+
+    // 数据分几次到达时, 条件满足之前不恢复读协程
+    bool ReaderReady() const {
+      file::Buffer* input = conn->InputBuffer();
+      if (!delimiter.empty()) {
+        return input->ToStringView().find(delimiter) != std::string_view::npos;
+      }
+      return input->ReadableBytes() >= readBytes;
+    }
+
+    void Resume(std::coroutine_handle<>* handle) {
+      if (*handle) {
+        std::coroutine_handle<> h = *handle;
+        *handle = nullptr;
+        h.resume();
+      }
+    }
+  };
+
+ public:
+  explicit CoConnection(const TcpConnectionPtr& conn)
+      : state_(std::make_shared<State>()) {
+    conn->GetLoop()->AssertInLoopThread();
+    state_->conn = conn;
+    state_->closed = !conn->Connected();
+    // 回调持有 State 的 shared_ptr, CoConnection 先于连接销毁时回调变为空操作
+    std::shared_ptr<State> state = state_;
+    conn->SetMessageCallback(
+        [state](const TcpConnectionPtr&, file::Buffer*, Unix::Timestamp) {
+          if (!state->detached && state->reader && state->ReaderReady()) {
+            state->Resume(&state->reader);
+          }
+        });
+    // 立即写完的 Write 也会留下一个排队的 writeComplete, 它可能在后一个 Write
+    // 挂起之后才执行, 所以只在 outputBuffer 真正写空时恢复写协程
+    conn->SetWriteCompleteCallback([state](const TcpConnectionPtr& c) {
+      if (!state->detached && c->OutputBuffer()->ReadableBytes() == 0) {
+        state->Resume(&state->writer);
+      }
+    });
+    conn->SetConnectionCallback([state](const TcpConnectionPtr& c) {
+      if (!c->Connected() && !state->detached) {
+        state->closed = true;
+        state->Resume(&state->reader);
+        state->Resume(&state->writer);
+      }
+    });
+  }
+
+  ~CoConnection() { state_->detached = true; }
+
+  const TcpConnectionPtr& Connection() const { return state_->conn; }
+  bool Closed() const { return state_->closed; }
+
+  // 读取恰好 n 个字节, 连接关闭时返回 nullopt
+  auto Read(size_t n) {
+    struct Awaiter {
+      State* state;
+      size_t n;
+      bool await_ready() const {
+        return state->closed || Input()->ReadableBytes() >= n;
+      }
+      void await_suspend(std::coroutine_handle<> h) {
+        state->reader = h;
+        state->readBytes = n;
+        state->delimiter = {};
+      }
+      std::optional<std::string> await_resume() {
+        if (Input()->ReadableBytes() < n) {
+          return std::nullopt;
+        }
+        return Input()->RetrieveAsString(n);
+      }
+      file::Buffer* Input() const { return state->conn->InputBuffer(); }
+    };
+    return Awaiter{state_.get(), n};
+  }
+
+  // 读取到 delimiter 为止, 返回的内容不含 delimiter, delimiter 本身被消费
+  // 连接关闭时返回 nullopt
+  auto ReadUntil(std::string_view delimiter) {
+    struct Awaiter {
+      State* state;
+      std::string_view delimiter;
+
+      bool await_ready() const { return state->closed || Find() != nullptr; }
+      void await_suspend(std::coroutine_handle<> h) {
+        state->reader = h;
+        state->delimiter = delimiter;
+      }
+      std::optional<std::string> await_resume() {
+        const char* found = Find();
+        if (found == nullptr) {
+          return std::nullopt;
+        }
+        file::Buffer* input = state->conn->InputBuffer();
+        std::string result(input->Peek(), found);
+        input->Retrieve(result.size() + delimiter.size());
+        return result;
+      }
+      const char* Find() const {
+        std::string_view data = state->conn->InputBuffer()->ToStringView();
+        size_t pos = data.find(delimiter);
+        return pos == std::string_view::npos ? nullptr : data.data() + pos;
+      }
+    };
+    return Awaiter{state_.get(), delimiter};
+  }
+
+  // 发送数据, 直到全部写入内核才恢复; 连接关闭时返回 false
+  auto Write(std::string_view data) {
+    struct Awaiter {
+      State* state;
+      std::string_view data;
+      bool await_ready() {
+        if (state->closed) {
+          return true;
+        }
+        // 在 loop 线程中 Send 会直接尝试 write, 写完了就不需要挂起
+        state->conn->Send(data);
+        return state->conn->OutputBuffer()->ReadableBytes() == 0;
+      }
+      void await_suspend(std::coroutine_handle<> h) { state->writer = h; }
+      bool await_resume() const { return !state->closed; }
+    };
+    return Awaiter{state_.get(), data};
+  }
+
+ private:
+  std::shared_ptr<State> state_;
+};
+
+// co_await Sleep(loop, seconds), 由定时器回调直接恢复
+inline auto Sleep(EventLoop* loop, double seconds) {
+  struct Awaiter {
+    EventLoop* loop;
+    double seconds;
+    bool await_ready() const { return seconds <= 0; }
+    void await_suspend(std::coroutine_handle<> h) {
+      loop->RunAfter(seconds, [h] { h.resume(); });
+    }
+    void await_resume() const {}
+  };
+  return Awaiter{loop, seconds};
+}
+
+}  // namespace rnet::network
+#endif
@@ -15,4 +15,4 @@ inline uint64_t NetworkToHost64(uint64_t net64) { return be64toh(net64); }
 inline uint32_t NetworkToHost32(uint32_t net32) { return be32toh(net32); }
 
 inline uint16_t NetworkToHost16(uint16_t net16) { return be16toh(net16); }
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
@@ -16,9 +16,9 @@ using namespace rnet::Unix;
 namespace rnet::network {
 
 Epoll::Epoll(EventLoop* loop)
-    : ownerLoop_(loop),
-      epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
-      events_(kInitEventListSize) {
+    : epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
+      events_(kInitEventListSize),
+      ownerLoop_(loop) {
   if (epollfd_ < 0) {
     LOG_SYSFATAL << "Epoll::Epoll";
   }
@@ -82,7 +82,7 @@ void Epoll::Update(int operation, Channel* channel) {
   event.data.ptr = channel;
   int fd = channel->Fd();
   LOG_TRACE << "epoll_ctl op = " << OperationToString(operation)
-            << " fd = " << fd << " event = { " << channel->eventsToString()
+            << " fd = " << fd << " event = { " << channel->EventsToString()
             << " }";
   if (::epoll_ctl(epollfd_, operation, fd, &event) < 0) {
     if (operation == EPOLL_CTL_DEL) {
@@ -147,7 +147,7 @@ void Epoll::RemoveChannel(Channel* channel) {
   assert(n == 1);
 
   if (index == kAdded) {
-    update(EPOLL_CTL_DEL, channel);
+    Update(EPOLL_CTL_DEL, channel);
   }
   channel->SetIndex(kNew);
 }
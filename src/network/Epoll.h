@@ -42,4 +42,4 @@ class Epoll : Noncopyable {
   EventLoop* ownerLoop_;
 };
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
@@ -3,7 +3,10 @@
 #include <sys/eventfd.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cinttypes>
 #include <csignal>
+#include <cstdio>
 #include <mutex>
 
 #include "log/Logger.h"
@@ -15,8 +18,15 @@
 using namespace rnet;
 using namespace rnet::log;
 namespace {
-thread_local Network::EventLoop* tLoopInThisThread = nullptr;
+thread_local network::EventLoop* tLoopInThisThread = nullptr;
 constexpr int kPollTimeMs = 10000;
+// 负载统计窗口, 每个窗口结束时更新一次 busyPermille_
+constexpr int64_t kLoadWindowUs = 100 * 1000;
+
+// 时钟回拨时按 0 记录
+uint64_t Elapsed(int64_t startUs, int64_t endUs) {
+  return endUs > startUs ? static_cast<uint64_t>(endUs - startUs) : 0;
+}
 
 int CreateEventFd() {
   int eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -39,7 +49,7 @@ IgnoreSigPipe initSignal;
 
 }  // namespace
 
-namespace rnet::Network {
+namespace rnet::network {
 EventLoop* EventLoop::GetEventLoopOfCurrentThread() {
   return tLoopInThisThread;
 }
@@ -49,30 +59,43 @@ EventLoop::EventLoop()
       quit_(false),
       eventHandling_(false),
       callingPendingFunctors_(false),
+      callingIterationEndFunctors_(false),
       iteration_(0),
       threadId(thread::Tid()),
       poller_(new Epoll(this)),
       timerQueue_(new TimerQueue(this)),
       wakeupFd_(CreateEventFd()),
       wakeupChannel_(new Channel(this, wakeupFd_)),
-      currentActiveChannel_(nullptr) {
-  LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
+      currentActiveChannel_(nullptr),
+      queueSize_(0),
+      numConnections_(0),
+      busyPermille_(0),
+      busySinceUs_(0),
+      windowStartUs_(0),
+      windowBusyUs_(0),
+      busyPollUs_(0),
+      spinHits_(0),
+      spinMisses_(0),
+      iterationEndUs_(0) {
+  LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId;
   if (tLoopInThisThread) {
     LOG_FATAL << "Another EventLoop " << tLoopInThisThread
-              << " exists in this thread " << threadId_;
+              << " exists in this thread " << threadId;
   } else {
     tLoopInThisThread = this;
   }
-  wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleWakeUp, this));
+  wakeupChannel_->SetReadCallback(std::bind(&EventLoop::HandleWakeUp, this));
   // we are always reading the wakeup fd
-  wakeupChannel_->enableReading();
+  wakeupChannel_->EnableReading();
 }
 
 EventLoop::~EventLoop() {
-  LOG_DEBUG << "EventLoop " << this << " of thread " << threadId_
+  LOG_DEBUG << "EventLoop " << this << " of thread " << threadId
             << " destructs in thread " << thread::Tid();
-  wakeupChannel_->disableAll();
-  wakeupChannel_->remove();
+  // 连接的引用由 loop 持有, 没有等到 ConnectDestroyed 的连接在这里放手
+  connections_.ReleaseAll();
+  wakeupChannel_->DisableAll();
+  wakeupChannel_->Remove();
   ::close(wakeupFd_);
   tLoopInThisThread = nullptr;
 }
@@ -83,23 +106,44 @@ void EventLoop::Loop() {
   looping_ = true;
   quit_ = false;  // FIXME: what if someone calls quit() before loop() ?
   LOG_TRACE << "EventLoop " << this << " start looping";
+  windowStartUs_ = Unix::Timestamp::Now().MicroSecondsSinceEpoch();
+  iterationEndUs_ = windowStartUs_;
 
   while (!quit_) {
     activeChannels_.clear();
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    pollReturnTime_ = busyPollUs_ > 0
+                          ? BusyPoll()
+                          : poller_->Poll(kPollTimeMs, &activeChannels_);
+    int64_t pollReturnUs = pollReturnTime_.MicroSecondsSinceEpoch();
+    busySinceUs_.store(pollReturnUs, std::memory_order_relaxed);
     ++iteration_;
-    if (Logger::logLevel() <= Logger::TRACE) {
-      printActiveChannels();
+    stats_.eventsPerPoll.Record(activeChannels_.size());
+    stats_.pollWaitUs.Record(Elapsed(iterationEndUs_, pollReturnUs));
+    if (Logger::LogLevel() <= Logger::trace) {
+      PrintActiveChannels();
     }
     // TODO sort channel by priority
     eventHandling_ = true;
+    int64_t callbackStartUs = pollReturnUs;
     for (Channel* channel : activeChannels_) {
+      // 回调里 channel 可能被销毁, 先取出 fd
+      int fd = channel->Fd();
       currentActiveChannel_ = channel;
-      currentActiveChannel_->handleEvent(pollReturnTime_);
+      currentActiveChannel_->HandleEvent(pollReturnTime_);
+      int64_t nowUs = Unix::Timestamp::Now().MicroSecondsSinceEpoch();
+      stats_.RecordCallback(fd, nowUs - callbackStartUs);
+      callbackStartUs = nowUs;
     }
     currentActiveChannel_ = nullptr;
     eventHandling_ = false;
-    doPendingFunctors();
+    stats_.callbackUs.Record(Elapsed(pollReturnUs, callbackStartUs));
+    DoPendingFunctors();
+    DoIterationEndFunctors();
+    Unix::Timestamp end = Unix::Timestamp::Now();
+    iterationEndUs_ = end.MicroSecondsSinceEpoch();
+    stats_.pendingFunctorsUs.Record(Elapsed(callbackStartUs, iterationEndUs_));
+    stats_.EndIteration(iterationEndUs_);
+    AccountBusyTime(pollReturnTime_, end);
   }
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
@@ -111,16 +155,16 @@ void EventLoop::Quit() {
   // There is a chance that loop() just executes while(!quit_) and exits,
   // then EventLoop destructs, then we are accessing an invalid object.
   // Can be fixed using mutex_ in both places.
-  if (!isInLoopThread()) {
-    wakeup();
+  if (!IsInLoopThread()) {
+    Wakeup();
   }
 }
 
 void EventLoop::RunInLoop(Functor cb) {
-  if (isInLoopThread()) {
+  if (IsInLoopThread()) {
     cb();
   } else {
-    queueInLoop(std::move(cb));
+    QueueInLoop(std::move(cb));
   }
 }
 
@@ -128,66 +172,140 @@ void EventLoop::QueueInLoop(Functor cb) {
   {
     std::lock_guard lock{mutex_};
     pendingFunctors_.push_back(std::move(cb));
+    queueSize_.store(pendingFunctors_.size(), std::memory_order_relaxed);
+  }
+
+  // 本轮已过了 DoPendingFunctors, 不唤醒就要等到下次 poll 超时
+  if (!IsInLoopThread() || callingPendingFunctors_ ||
+      callingIterationEndFunctors_) {
+    Wakeup();
+  }
+}
+
+void EventLoop::RunAtIterationEnd(Functor cb) {
+  AssertInLoopThread();
+  iterationEndFunctors_.push_back(std::move(cb));
+  // 不在事件处理和 DoPendingFunctors 中时, 本轮不会再执行到它
+  // (Loop 之前, 或者正在执行 iteration end 任务), 需要唤醒
+  if (!eventHandling_ && !callingPendingFunctors_) {
+    Wakeup();
   }
+}
+
+int EventLoop::BusyPermille() const {
+  int64_t busySince = busySinceUs_.load(std::memory_order_relaxed);
+  if (busySince != 0 &&
+      Unix::Timestamp::NowCoarse().MicroSecondsSinceEpoch() - busySince >
+          kLoadWindowUs) {
+    return 1000;
+  }
+  return busyPermille_.load(std::memory_order_relaxed);
+}
+
+// 窗口结束时 busyPermille_ = (旧值 + 本窗口占比) / 2
+void EventLoop::AccountBusyTime(Unix::Timestamp pollReturn,
+                                Unix::Timestamp end) {
+  busySinceUs_.store(0, std::memory_order_relaxed);
+  int64_t endUs = end.MicroSecondsSinceEpoch();
+  windowBusyUs_ += endUs - pollReturn.MicroSecondsSinceEpoch();
+  int64_t elapsed = endUs - windowStartUs_;
+  if (elapsed >= kLoadWindowUs) {
+    auto permille = static_cast<int>(
+        std::min<int64_t>(windowBusyUs_ * 1000 / elapsed, 1000));
+    busyPermille_.store(
+        (busyPermille_.load(std::memory_order_relaxed) + permille) / 2,
+        std::memory_order_relaxed);
+    windowStartUs_ = endUs;
+    windowBusyUs_ = 0;
+  }
+}
 
-  if (!isInLoopThread() || callingPendingFunctors_) {
-    wakeup();
+// 自旋的时间算作空闲, 不计入 BusyPermille
+// wakeup fd 和 timerfd 都在 epoll 里, 其他线程投递任务和定时器到期同样能结束自旋
+Unix::Timestamp EventLoop::BusyPoll() {
+  Unix::Timestamp now = poller_->Poll(0, &activeChannels_);
+  int64_t deadline = now.MicroSecondsSinceEpoch() + busyPollUs_;
+  while (activeChannels_.empty() && !quit_) {
+    if (now.MicroSecondsSinceEpoch() >= deadline) {
+      spinMisses_.store(spinMisses_.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+      return poller_->Poll(kPollTimeMs, &activeChannels_);
+    }
+    now = poller_->Poll(0, &activeChannels_);
+  }
+  if (!activeChannels_.empty()) {
+    spinHits_.store(spinHits_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
   }
+  return now;
+}
+
+std::string EventLoop::StatsString() const {
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "connections=%d queue_size=%zu busy_permille=%d spin_hits=%" PRIu64
+           " spin_misses=%" PRIu64 "\n",
+           NumConnections(), QueueSize(), BusyPermille(), SpinHits(),
+           SpinMisses());
+  return buf + stats_.ToString();
 }
 
-size_t EventLoop::QueueSize() const {
-  std::lock_guard lock{mutex_};
-  return pendingFunctors_.size();
+void EventLoop::ResetStats() {
+  RunInLoop([this] { stats_.Reset(); });
+}
+
+void EventLoop::RecordTimerLateness(int64_t us) {
+  stats_.timerLatenessUs.Record(us > 0 ? static_cast<uint64_t>(us) : 0);
 }
 
 TimerId EventLoop::RunAt(Unix::Timestamp time, TimerCallback cb) {
-  return timerQueue_->addTimer(std::move(cb), time, 0.0);
+  return timerQueue_->AddTimer(std::move(cb), time, 0.0);
 }
 
 TimerId EventLoop::RunAfter(double delay, TimerCallback cb) {
-  Unix::Timestamp time(addTime(Unix::Timestamp::now(), delay));
-  return runAt(time, std::move(cb));
+  Unix::Timestamp time(AddTime(Unix::Timestamp::Now(), delay));
+  return RunAt(time, std::move(cb));
 }
 
 TimerId EventLoop::RunEvery(double interval, TimerCallback cb) {
-  Unix::Timestamp time(addTime(Unix::Timestamp::now(), interval));
-  return timerQueue_->addTimer(std::move(cb), time, interval);
+  Unix::Timestamp time(AddTime(Unix::Timestamp::Now(), interval));
+  return timerQueue_->AddTimer(std::move(cb), time, interval);
 }
 
-void EventLoop::Cancel(TimerId timerId) { return timerQueue_->cancel(timerId); }
+void EventLoop::Cancel(TimerId timerId) { return timerQueue_->Cancel(timerId); }
 
 void EventLoop::UpdateChannel(Channel* channel) {
-  assert(channel->ownerLoop() == this);
+  assert(channel->OwnerLoop() == this);
   AssertInLoopThread();
-  poller_->updateChannel(channel);
+  poller_->UpdateChannel(channel);
 }
 
 void EventLoop::RemoveChannel(Channel* channel) {
-  assert(channel->ownerLoop() == this);
+  assert(channel->OwnerLoop() == this);
   AssertInLoopThread();
   if (eventHandling_) {
     assert(currentActiveChannel_ == channel ||
            std::find(activeChannels_.begin(), activeChannels_.end(), channel) ==
                activeChannels_.end());
   }
-  poller_->removeChannel(channel);
+  poller_->RemoveChannel(channel);
 }
 
 bool EventLoop::HasChannel(Channel* channel) {
-  assert(channel->ownerLoop() == this);
+  assert(channel->OwnerLoop() == this);
   AssertInLoopThread();
-  return poller_->hasChannel(channel);
+  return poller_->HasChannel(channel);
 }
 
 void EventLoop::AbortNotInLoopThread() {
-  LOG_FATAL << "EventLoop::abortNotInLoopThread - EventLoop " << this
-            << " was created in threadId_ = " << threadId_
-            << ", current thread id = " << Thread::tid();
+  LOG_FATAL << "EventLoop::AbortNotInLoopThread - EventLoop " << this
+            << " was created in threadId = " << threadId
+            << ", current thread id = " << thread::Tid();
 }
 
 void EventLoop::Wakeup() {
   uint64_t one = 1;
-  ssize_t n = Sockets::write(wakeupFd_, &one, sizeof one);
+  ssize_t n = sockets::Write(wakeupFd_, &one, sizeof one);
   if (n != sizeof one) {
     LOG_ERROR << "EventLoop::wakeup() writes " << n << " bytes instead of 8";
   }
@@ -195,7 +313,7 @@ void EventLoop::Wakeup() {
 
 void EventLoop::HandleWakeUp() {
   uint64_t one = 1;
-  ssize_t n = Sockets::read(wakeupFd_, &one, sizeof one);
+  ssize_t n = sockets::Read(wakeupFd_, &one, sizeof one);
   if (n != sizeof one) {
     LOG_ERROR << "EventLoop::handleRead() reads " << n << " bytes instead of 8";
   }
@@ -208,6 +326,10 @@ void EventLoop::DoPendingFunctors() {
   {
     std::lock_guard lock{mutex_};
     functors.swap(pendingFunctors_);
+    queueSize_.store(0, std::memory_order_relaxed);
+  }
+  if (!functors.empty()) {
+    stats_.pendingFunctorsDepth.Record(functors.size());
   }
 
   for (const Functor& functor : functors) {
@@ -216,10 +338,29 @@ void EventLoop::DoPendingFunctors() {
   callingPendingFunctors_ = false;
 }
 
+// 执行中新加入的任务留到下一轮
+void EventLoop::DoIterationEndFunctors() {
+  if (iterationEndFunctors_.empty()) {
+    return;
+  }
+  std::vector<Functor> functors;
+  functors.swap(iterationEndFunctors_);
+  callingIterationEndFunctors_ = true;
+  for (const Functor& functor : functors) {
+    functor();
+  }
+  callingIterationEndFunctors_ = false;
+  // 把容量还回去, 下一轮不再分配
+  functors.clear();
+  if (iterationEndFunctors_.empty()) {
+    iterationEndFunctors_.swap(functors);
+  }
+}
+
 void EventLoop::PrintActiveChannels() const {
   for (const Channel* channel : activeChannels_) {
-    LOG_TRACE << "{" << channel->reventsToString() << "} ";
+    LOG_TRACE << "{" << channel->ReventsToString() << "} ";
   }
 }
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
@@ -1,15 +1,19 @@
 #pragma once
 #include <any>
+#include <atomic>
 #include <functional>
 #include <mutex>
+#include <string>
 
 #include "base/Common.h"
 #include "network/Channel.h"
+#include "network/ConnectionStats.h"
+#include "network/LoopStats.h"
 #include "network/Timer.h"
 #include "network/TimerId.h"
 #include "unix/Thread.h"
 #include "unix/Time.h"
-namespace rnet::Network {
+namespace rnet::network {
 
 class Epoll;
 class Channel;
@@ -52,7 +56,45 @@ class EventLoop : Noncopyable {
   /// Safe to call from other threads.
   void QueueInLoop(Functor cb);
 
-  size_t QueueSize() const;
+  /// 在本轮 DoPendingFunctors 之后执行, 用于把一轮中的多次操作合并成一次.
+  /// 在 iteration end 任务中调用时留到下一轮, 并唤醒 loop.
+  /// 只能在 loop 线程调用
+  void RunAtIterationEnd(Functor cb);
+
+  // 不加锁, 任意线程可读
+  size_t QueueSize() const {
+    return queueSize_.load(std::memory_order_relaxed);
+  }
+
+  // 负载计数, 只用 relaxed 原子变量, 任意线程可读, 供 EventLoopThreadPool 选择 loop
+  // 属于本 loop 的 TcpConnection 数量, 连接构造时加一, 析构时减一
+  int NumConnections() const {
+    return numConnections_.load(std::memory_order_relaxed);
+  }
+  // 最近一段时间在 epoll_wait 之外(处理事件, 定时器, pending functors)的时间占比, 千分比
+  // 当前一轮已经连续忙了一个统计窗口以上时直接返回 1000, 卡住的 loop 能立刻被发现
+  int BusyPermille() const;
+
+  // 忙轮询: 阻塞前先用 0 超时的 epoll_wait 自旋最多 spinUs 微秒
+  // 事件在自旋期间到达时省去一次睡眠和唤醒, 代价是自旋期间占满 cpu,
+  // 只适合独占 cpu 的延迟敏感 loop. 0 表示关闭(默认), 在 loop 线程或 Loop 之前调用
+  void SetBusyPoll(int64_t spinUs) { busyPollUs_ = spinUs; }
+  int64_t BusyPollUs() const { return busyPollUs_; }
+  // 自旋期间等到事件的次数, 和自旋预算用完转为阻塞等待的次数, 任意线程可读
+  uint64_t SpinHits() const { return spinHits_.load(std::memory_order_relaxed); }
+  uint64_t SpinMisses() const {
+    return spinMisses_.load(std::memory_order_relaxed);
+  }
+
+  // 每轮的事件数和各阶段耗时分布, 任意线程可读
+  const LoopStats& Stats() const { return stats_; }
+  // 文本形式导出负载计数和 Stats(), 任意线程可调用
+  std::string StatsString() const;
+  // 清空 Stats(), 任意线程可调用, 在 loop 线程中执行
+  void ResetStats();
+
+  // 本 loop 上已建立的连接, 用于 TCP_INFO 采样和按流量排序, 只能在 loop 线程使用
+  ConnectionSet* Connections() { return &connections_; }
 
   // timers
 
@@ -78,6 +120,10 @@ class EventLoop : Noncopyable {
   void Cancel(network::TimerId timerId);
 
   // internal usage
+  void AdjustConnections(int delta) {
+    numConnections_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  void RecordTimerLateness(int64_t us);
   void Wakeup();
   void UpdateChannel(Channel* channel);
   void RemoveChannel(Channel* channel);
@@ -105,6 +151,9 @@ class EventLoop : Noncopyable {
   void AbortNotInLoopThread();
   void HandleWakeUp();  // waked up
   void DoPendingFunctors();
+  void DoIterationEndFunctors();
+  void AccountBusyTime(Unix::Timestamp pollReturn, Unix::Timestamp end);
+  Unix::Timestamp BusyPoll();
 
   void PrintActiveChannels() const;  // DEBUG
 
@@ -114,6 +163,7 @@ class EventLoop : Noncopyable {
   std::atomic<bool> quit_;
   bool eventHandling_;          /* atomic */
   bool callingPendingFunctors_; /* atomic */
+  bool callingIterationEndFunctors_;
   int64_t iteration_;
   const pid_t threadId;
   Unix::Timestamp pollReturnTime_;
@@ -131,5 +181,22 @@ class EventLoop : Noncopyable {
 
   mutable std::mutex mutex_;
   std::vector<Functor> pendingFunctors_;
+  // 只在 loop 线程访问, 不需要锁
+  std::vector<Functor> iterationEndFunctors_;
+
+  std::atomic<size_t> queueSize_;
+  std::atomic<int> numConnections_;
+  std::atomic<int> busyPermille_;
+  // 本轮从 epoll_wait 返回的时间, 在 epoll_wait 中为 0
+  std::atomic<int64_t> busySinceUs_;
+  int64_t windowStartUs_;
+  int64_t windowBusyUs_;
+  int64_t busyPollUs_;
+  std::atomic<uint64_t> spinHits_;
+  std::atomic<uint64_t> spinMisses_;
+  LoopStats stats_;
+  ConnectionSet connections_;
+  // 上一轮结束的时间, 用来计算 epoll_wait 的等待时间
+  int64_t iterationEndUs_;
 };
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
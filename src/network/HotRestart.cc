@@ -0,0 +1,350 @@
+#include "network/HotRestart.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cassert>
+
+#include "log/Logger.h"
+#include "network/EventLoop.h"
+#include "network/SocketOps.h"
+#include "network/TcpConnection.h"
+
+namespace rnet::network {
+
+HotRestartServer::HotRestartServer(EventLoop* loop,
+                                   const UnixAddress& controlAddr)
+    : loop_(loop),
+      control_(loop, controlAddr, "hot-restart"),
+      drainTimeout_(kDefaultDrainTimeout),
+      handOffIdle_(false),
+      handingOver_(false),
+      pendingDrains_(0) {
+  control_.SetMessageCallback(
+      [this](const TcpConnectionPtr& conn, file::Buffer* buf,
+             Unix::Timestamp receiveTime) {
+        OnMessage(conn, buf, receiveTime);
+      });
+  control_.SetWriteCompleteCallback(
+      [this](const TcpConnectionPtr& conn) { SendNextBatch(conn); });
+  control_.SetConnectionCallback([this](const TcpConnectionPtr& conn) {
+    if (!conn->Connected() && transfer_.conn == conn.get()) {
+      LOG_ERROR << "HotRestartServer - control connection closed while "
+                   "sending file descriptors";
+      FinishSend(false);
+    }
+  });
+}
+
+HotRestartServer::~HotRestartServer() = default;
+
+void HotRestartServer::AddServer(TcpServer* server) {
+  assert(server->GetLoop() == loop_);
+  servers_.push_back(server);
+}
+
+void HotRestartServer::Start() { control_.Start(); }
+
+void HotRestartServer::OnMessage(const TcpConnectionPtr& conn,
+                                 file::Buffer* buf, Unix::Timestamp) {
+  while (const char* eol = buf->FindEol()) {
+    std::string line(buf->Peek(), eol);
+    buf->RetrieveUntil(eol + 1);
+    if (line == "listeners") {
+      SendListeners(conn);
+    } else if (line == "ready") {
+      HandOver(conn);
+    } else {
+      LOG_ERROR << "HotRestartServer - unknown request '" << line << "'";
+      conn->Shutdown();
+      return;
+    }
+  }
+}
+
+void HotRestartServer::SendListeners(const TcpConnectionPtr& conn) {
+  std::vector<std::pair<std::string, int>> fds;
+  for (TcpServer* server : servers_) {
+    int fd = server->ListenFd();
+    if (fd >= 0) {
+      fds.emplace_back(server->Name(), fd);
+    } else {
+      LOG_ERROR << "HotRestartServer - TcpServer [" << server->Name()
+                << "] has no single listening socket";
+    }
+  }
+  LOG_INFO << "HotRestartServer - sending " << fds.size()
+           << " listening sockets";
+  SendFds(conn, 'L', std::move(fds),
+          [conn](bool ok) { EndReply(conn, ok); });
+}
+
+// 新进程已经在继承的 socket 上 accept, 本进程的监听 socket 可以关闭了
+void HotRestartServer::HandOver(const TcpConnectionPtr& conn) {
+  if (handingOver_) {
+    return;
+  }
+  handingOver_ = true;
+  LOG_INFO << "HotRestartServer - new process is ready, handing over";
+  control_.StopAccepting();
+  for (TcpServer* server : servers_) {
+    server->StopAccepting();
+  }
+  // 排在 StopAccepting 之后: 新进程收到 end 时本进程的控制地址已经释放
+  loop_->QueueInLoop([this, conn] { HandOffConnections(conn, 0, {}); });
+}
+
+// 依次收集各个 TcpServer 交出的空闲连接, 最后一起发送
+void HotRestartServer::HandOffConnections(const TcpConnectionPtr& conn,
+                                          size_t index,
+                                          std::vector<int> released) {
+  for (int fd : released) {
+    released_.emplace_back(servers_[index - 1]->Name(), fd);
+  }
+  if (handOffIdle_ && index < servers_.size()) {
+    servers_[index]->ReleaseIdleConnections(
+        [this, conn, index](std::vector<int> fds) {
+          HandOffConnections(conn, index + 1, std::move(fds));
+        });
+    return;
+  }
+  if (!released_.empty()) {
+    LOG_INFO << "HotRestartServer - handing off " << released_.size()
+             << " idle connections";
+  }
+  SendFds(conn, 'C', released_, [this, conn](bool ok) {
+    // 成功时对端已经有了自己的一份, 失败时这些连接也无处可去
+    for (const auto& item : released_) {
+      sockets::Close(item.second);
+    }
+    released_.clear();
+    EndReply(conn, ok);
+    DrainAll();
+  });
+}
+
+void HotRestartServer::DrainAll() {
+  pendingDrains_ = servers_.size();
+  if (pendingDrains_ == 0) {
+    if (drainedCallback_) {
+      drainedCallback_();
+    }
+    return;
+  }
+  for (TcpServer* server : servers_) {
+    server->Drain(drainTimeout_, [this] {
+      if (--pendingDrains_ == 0 && drainedCallback_) {
+        drainedCallback_();
+      }
+    });
+  }
+}
+
+void HotRestartServer::SendFds(const TcpConnectionPtr& conn, char tag,
+                               std::vector<std::pair<std::string, int>> fds,
+                               SendDoneCallback done) {
+  if (transfer_.done) {
+    LOG_ERROR << "HotRestartServer - another transfer is in progress";
+    done(false);
+    return;
+  }
+  transfer_.conn = conn.get();
+  transfer_.tag = tag;
+  transfer_.fds = std::move(fds);
+  transfer_.next = 0;
+  transfer_.done = std::move(done);
+  SendNextBatch(conn);
+}
+
+// 也由 writeComplete 回调调用, 不属于当前发送或者上一批还没写完时什么也不做
+void HotRestartServer::SendNextBatch(const TcpConnectionPtr& conn) {
+  if (!transfer_.done || transfer_.conn != conn.get() ||
+      conn->OutputBuffer()->ReadableBytes() > 0) {
+    return;
+  }
+  const auto& fds = transfer_.fds;
+  if (transfer_.next == fds.size()) {
+    FinishSend(true);
+    return;
+  }
+  size_t begin = transfer_.next;
+  size_t end = std::min(fds.size(), begin + sockets::kMaxFdsPerMessage);
+  std::string lines;
+  std::vector<int> batch;
+  for (size_t i = begin; i < end; ++i) {
+    lines += transfer_.tag;
+    lines += ' ';
+    lines += fds[i].first;
+    lines += '\n';
+    batch.push_back(fds[i].second);
+  }
+  if (!conn->SendWithFds(lines, batch.data(), batch.size())) {
+    LOG_ERROR << "HotRestartServer - failed to send " << fds.size() - begin
+              << " file descriptors";
+    FinishSend(false);
+    return;
+  }
+  // 写完之后 (立即或者在 HandleWrite 中) 由 writeComplete 接着发送
+  transfer_.next = end;
+}
+
+void HotRestartServer::FinishSend(bool ok) {
+  SendDoneCallback done = std::move(transfer_.done);
+  transfer_ = FdTransfer();
+  done(ok);
+}
+
+void HotRestartServer::EndReply(const TcpConnectionPtr& conn, bool ok) {
+  if (ok) {
+    conn->Send("end\n");
+  } else {
+    conn->ForceClose();
+  }
+}
+
+HotRestartClient::HotRestartClient(const UnixAddress& controlAddr,
+                                   double timeout)
+    : controlAddr_(controlAddr), timeout_(timeout), sockfd_(-1) {}
+
+HotRestartClient::~HotRestartClient() {
+  if (sockfd_ >= 0) {
+    sockets::Close(sockfd_);
+  }
+  for (int fd : fds_) {
+    sockets::Close(fd);
+  }
+  for (const auto& item : listenFds_) {
+    sockets::Close(item.second);
+  }
+  for (const auto& item : connections_) {
+    for (int fd : item.second) {
+      sockets::Close(fd);
+    }
+  }
+}
+
+bool HotRestartClient::Fetch() {
+  assert(sockfd_ < 0);
+  sockfd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd_ < 0) {
+    LOG_SYSERR << "HotRestartClient::Fetch";
+    return false;
+  }
+  struct timeval tv;
+  tv.tv_sec = static_cast<time_t>(timeout_);
+  tv.tv_usec = static_cast<suseconds_t>(
+      (timeout_ - static_cast<double>(tv.tv_sec)) * 1e6);
+  ::setsockopt(sockfd_, SOL_SOCKET, SO_RCVTIMEO, &tv,
+               static_cast<socklen_t>(sizeof tv));
+  ::setsockopt(sockfd_, SOL_SOCKET, SO_SNDTIMEO, &tv,
+               static_cast<socklen_t>(sizeof tv));
+  if (sockets::Connect(sockfd_, controlAddr_.GetSockAddr(),
+                       controlAddr_.Length()) < 0) {
+    if (errno == ENOENT || errno == ECONNREFUSED) {
+      LOG_INFO << "HotRestartClient - no running process at "
+               << controlAddr_.ToString();
+    } else {
+      LOG_SYSERR << "HotRestartClient::Fetch - connect";
+    }
+    sockets::Close(sockfd_);
+    sockfd_ = -1;
+    return false;
+  }
+  return Request("listeners\n") && ReadUntilEnd();
+}
+
+int HotRestartClient::TakeListenFd(const std::string& name) {
+  auto it = listenFds_.find(name);
+  if (it == listenFds_.end()) {
+    return -1;
+  }
+  int fd = it->second;
+  listenFds_.erase(it);
+  return fd;
+}
+
+bool HotRestartClient::Ready() {
+  if (sockfd_ < 0) {
+    return false;
+  }
+  bool ok = Request("ready\n") && ReadUntilEnd();
+  sockets::Close(sockfd_);
+  sockfd_ = -1;
+  return ok;
+}
+
+std::vector<int> HotRestartClient::TakeConnections(const std::string& name) {
+  auto it = connections_.find(name);
+  if (it == connections_.end()) {
+    return {};
+  }
+  std::vector<int> fds = std::move(it->second);
+  connections_.erase(it);
+  return fds;
+}
+
+bool HotRestartClient::Request(const char* line) {
+  std::string_view data(line);
+  while (!data.empty()) {
+    ssize_t n = ::send(sockfd_, data.data(), data.size(), MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_SYSERR << "HotRestartClient::Request";
+      return false;
+    }
+    data.remove_prefix(static_cast<size_t>(n));
+  }
+  return true;
+}
+
+// 一条消息的 fd 随它的第一个字节到达, 解析到带 fd 的行时对应的 fd 一定已经收到
+bool HotRestartClient::ReadUntilEnd() {
+  char buf[4096];
+  for (;;) {
+    size_t eol;
+    while ((eol = pending_.find('\n')) != std::string::npos) {
+      std::string line = pending_.substr(0, eol);
+      pending_.erase(0, eol + 1);
+      if (line == "end") {
+        return true;
+      }
+      if (line.size() < 3 || (line[0] != 'L' && line[0] != 'C') ||
+          line[1] != ' ' || fds_.empty()) {
+        LOG_ERROR << "HotRestartClient - unexpected reply '" << line << "'";
+        return false;
+      }
+      int fd = fds_.front();
+      fds_.erase(fds_.begin());
+      std::string name = line.substr(2);
+      if (line[0] == 'L') {
+        auto it = listenFds_.find(name);
+        if (it != listenFds_.end()) {
+          sockets::Close(it->second);
+        }
+        listenFds_[name] = fd;
+      } else {
+        connections_[name].push_back(fd);
+      }
+    }
+    struct iovec iov = {buf, sizeof buf};
+    ssize_t n = sockets::RecvWithFds(sockfd_, &iov, 1, &fds_);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      if (n < 0) {
+        LOG_SYSERR << "HotRestartClient::ReadUntilEnd";
+      } else {
+        LOG_ERROR << "HotRestartClient - control connection closed";
+      }
+      return false;
+    }
+    pending_.append(buf, static_cast<size_t>(n));
+  }
+}
+
+}  // namespace rnet::network
@@ -0,0 +1,130 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/Common.h"
+#include "network/Callback.h"
+#include "network/TcpServer.h"
+#include "network/UnixAddress.h"
+#include "unix/Time.h"
+namespace rnet::network {
+
+class EventLoop;
+
+// 不停机重启: 旧进程通过 unix socket 把监听 socket 交给新进程,
+// 两个进程共享同一个 accept 队列, 重启期间不会有连接被拒绝.
+//
+//   旧进程 HotRestartServer                 新进程 HotRestartClient
+//                                   <-  Fetch: 请求监听 socket
+//   按名字发送各个 TcpServer 的监听 fd  ->
+//                                       用继承的 fd 构造 TcpServer 并 Start
+//                                   <-  Ready
+//   停止 accept, 可选交出空闲连接     ->  TakeConnections, TcpServer::AdoptConnection
+//   等待旧连接排空 (有期限), 回调后退出
+//
+// 新进程在 Ready 返回之后才能在同一个控制地址上启动自己的 HotRestartServer
+// 控制协议按行分隔: 请求 "listeners" 和 "ready"; 应答中 "L name" 和 "C name"
+// 各带一个 fd (SCM_RIGHTS), "end" 结束一次应答
+
+// 旧进程一端, 和注册的 TcpServer 在同一个 loop 中运行
+class HotRestartServer : Noncopyable {
+ public:
+  using DrainedCallback = std::function<void()>;
+  static constexpr double kDefaultDrainTimeout = 30.0;
+
+  HotRestartServer(EventLoop* loop, const UnixAddress& controlAddr);
+  ~HotRestartServer();
+
+  /// 要交给新进程的 TcpServer, 新进程按 Name() 取回监听 socket.
+  /// 不支持 kReusePortPerLoop. Must be called before Start
+  void AddServer(TcpServer* server);
+  /// 交出监听 socket 后等待旧连接自己关闭的期限, 到期强制关闭
+  void SetDrainTimeout(double seconds) { drainTimeout_ = seconds; }
+  /// 同时把空闲连接交给新进程, 见 TcpConnection::ReleaseIfIdle.
+  /// 只适合连接上没有应用状态的协议
+  void SetHandOffIdleConnections(bool on) { handOffIdle_ = on; }
+  /// 所有 TcpServer 的连接都排空后在 loop 中回调, 一般在这里退出进程
+  void SetDrainedCallback(DrainedCallback cb) {
+    drainedCallback_ = std::move(cb);
+  }
+
+  void Start();
+  /// 已经收到新进程的 ready, 正在交接或者排空
+  bool HandingOver() const { return handingOver_; }
+
+ private:
+  void OnMessage(const TcpConnectionPtr& conn, file::Buffer* buf,
+                 Unix::Timestamp);
+  void SendListeners(const TcpConnectionPtr& conn);
+  void HandOver(const TcpConnectionPtr& conn);
+  void HandOffConnections(const TcpConnectionPtr& conn, size_t index,
+                          std::vector<int> released);
+  void DrainAll();
+  using SendDoneCallback = std::function<void(bool)>;
+  // 每个 fd 对应一行 "tag name", 超过一条消息能带的 fd 数时分几次发送.
+  // SendWithFds 要求输出缓冲区为空, 下一批在上一批写完后的 writeComplete
+  // 回调中发送. 全部写完时 done(true); 发送失败或者连接断开时 done(false)
+  void SendFds(const TcpConnectionPtr& conn, char tag,
+               std::vector<std::pair<std::string, int>> fds,
+               SendDoneCallback done);
+  void SendNextBatch(const TcpConnectionPtr& conn);
+  void FinishSend(bool ok);
+  // 结束一次应答: 成功时发送 "end", 失败时强制关闭, 对端看到连接关闭就知道失败了
+  static void EndReply(const TcpConnectionPtr& conn, bool ok);
+
+  // 正在进行的 SendFds, 同一时间只有一个
+  struct FdTransfer {
+    const TcpConnection* conn = nullptr;
+    char tag = 0;
+    std::vector<std::pair<std::string, int>> fds;
+    size_t next = 0;
+    SendDoneCallback done;
+  };
+
+  EventLoop* loop_;
+  TcpServer control_;
+  std::vector<TcpServer*> servers_;
+  double drainTimeout_;
+  bool handOffIdle_;
+  bool handingOver_;
+  // 交出的空闲连接, 按 servers_ 的顺序收集, 一起发送
+  std::vector<std::pair<std::string, int>> released_;
+  size_t pendingDrains_;
+  DrainedCallback drainedCallback_;
+  FdTransfer transfer_;
+};
+
+// 新进程一端, 在启动时同步调用, 每一步最多阻塞 timeout 秒
+class HotRestartClient : Noncopyable {
+ public:
+  explicit HotRestartClient(const UnixAddress& controlAddr,
+                            double timeout = 5.0);
+  ~HotRestartClient();  // 关闭控制连接和没有取走的 fd
+
+  /// 向旧进程取回监听 socket. 没有旧进程 (第一次启动) 时返回 false
+  bool Fetch();
+  /// 名为 name 的 TcpServer 的监听 fd, 没有时返回 -1; 取走后归调用者所有
+  int TakeListenFd(const std::string& name);
+  /// 继承的 TcpServer 已经 Start, 通知旧进程停止 accept 并交出空闲连接,
+  /// 然后关闭控制连接
+  bool Ready();
+  /// 旧进程交过来的名为 name 的 TcpServer 的空闲连接, 取走后归调用者所有
+  std::vector<int> TakeConnections(const std::string& name);
+
+ private:
+  bool Request(const char* line);
+  // 读到 "end" 为止, 把带 fd 的行按名字归类
+  bool ReadUntilEnd();
+
+  const UnixAddress controlAddr_;
+  const double timeout_;
+  int sockfd_;
+  std::string pending_;
+  std::vector<int> fds_;  // 已经收到还没有对上行的 fd
+  std::map<std::string, int> listenFds_;
+  std::map<std::string, std::vector<int>> connections_;
+};
+
+}  // namespace rnet::network
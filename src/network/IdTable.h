@@ -0,0 +1,128 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "base/Common.h"
+
+namespace rnet::network {
+
+// 以 64 位整数 id 为键的开放寻址哈希表, 线性探测, 删除时向后移位不留墓碑
+// 所有槽位在一块连续内存里, 插入删除不分配节点, 不比较字符串
+// id 0 保留表示空槽, 负载超过 1/2 时容量翻倍
+template <typename Value>
+class IdTable : Noncopyable {
+ public:
+  explicit IdTable(size_t initialCapacity = 64) { Rehash(initialCapacity); }
+
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+  size_t Capacity() const { return slots_.size(); }
+
+  // id 已存在时覆盖原值
+  void Insert(uint64_t id, Value value) {
+    assert(id != 0);
+    if ((size_ + 1) * 2 > slots_.size()) {
+      Rehash(slots_.size() * 2);
+    }
+    size_t i = Probe(id);
+    if (slots_[i].id == 0) {
+      slots_[i].id = id;
+      ++size_;
+    }
+    slots_[i].value = std::move(value);
+  }
+
+  Value* Find(uint64_t id) {
+    size_t i = Probe(id);
+    return slots_[i].id == 0 ? nullptr : &slots_[i].value;
+  }
+
+  size_t Erase(uint64_t id) {
+    size_t i = Probe(id);
+    if (slots_[i].id == 0) {
+      return 0;
+    }
+    // 把后面探测链上的元素前移填补空位, 保证查找遇到空槽即可停止
+    size_t hole = i;
+    for (size_t j = Next(i); slots_[j].id != 0; j = Next(j)) {
+      size_t home = Home(slots_[j].id);
+      // home 不在 (hole, j] 之间时, j 可以移到 hole
+      if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+        slots_[hole] = std::move(slots_[j]);
+        hole = j;
+      }
+    }
+    slots_[hole].id = 0;
+    slots_[hole].value = Value();
+    --size_;
+    return 1;
+  }
+
+  // func(uint64_t id, Value& value), 遍历期间不能插入或删除
+  template <typename Func>
+  void ForEach(Func&& func) {
+    for (auto& slot : slots_) {
+      if (slot.id != 0) {
+        func(slot.id, slot.value);
+      }
+    }
+  }
+
+  void Clear() {
+    for (auto& slot : slots_) {
+      slot.id = 0;
+      slot.value = Value();
+    }
+    size_ = 0;
+  }
+
+ private:
+  struct Slot {
+    uint64_t id = 0;
+    Value value{};
+  };
+
+  // fibonacci 哈希, 连续分配的 id 也能均匀分散
+  size_t Home(uint64_t id) const {
+    return static_cast<size_t>((id * 0x9E3779B97F4A7C15ULL) >> shift_);
+  }
+  size_t Next(size_t i) const { return (i + 1) & mask_; }
+
+  // 返回 id 所在的槽, 不存在时返回探测链结尾的空槽
+  size_t Probe(uint64_t id) const {
+    size_t i = Home(id);
+    while (slots_[i].id != 0 && slots_[i].id != id) {
+      i = Next(i);
+    }
+    return i;
+  }
+
+  void Rehash(size_t capacity) {
+    size_t n = 8;
+    int bits = 3;
+    while (n < capacity) {
+      n <<= 1;
+      ++bits;
+    }
+    std::vector<Slot> old(n);
+    old.swap(slots_);
+    mask_ = n - 1;
+    shift_ = 64 - bits;
+    for (auto& slot : old) {
+      if (slot.id != 0) {
+        size_t i = Probe(slot.id);
+        slots_[i] = std::move(slot);
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  size_t mask_ = 0;
+  int shift_ = 64;
+  size_t size_ = 0;
+};
+
+}  // namespace rnet::network
@@ -0,0 +1,63 @@
+#include "network/LoopStats.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace rnet::network {
+
+LoopStats::LoopStats()
+    : intervalStartUs_(0),
+      intervalSlowestUs_(0),
+      intervalSlowestFd_(-1),
+      slowestUs_(0),
+      slowestFd_(-1) {}
+
+void LoopStats::EndIteration(int64_t nowUs) {
+  if (intervalStartUs_ == 0) {
+    intervalStartUs_ = nowUs;
+  }
+  if (nowUs - intervalStartUs_ < kSlowestIntervalUs) {
+    return;
+  }
+  slowestUs_.store(intervalSlowestUs_, std::memory_order_relaxed);
+  slowestFd_.store(intervalSlowestFd_, std::memory_order_relaxed);
+  intervalStartUs_ = nowUs;
+  intervalSlowestUs_ = 0;
+  intervalSlowestFd_ = -1;
+}
+
+std::string LoopStats::ToString() const {
+  std::string result;
+  result += eventsPerPoll.ToString("events_per_poll");
+  result += '\n';
+  result += pollWaitUs.ToString("poll_wait_us");
+  result += '\n';
+  result += callbackUs.ToString("callback_us");
+  result += '\n';
+  result += pendingFunctorsUs.ToString("pending_functors_us");
+  result += '\n';
+  result += pendingFunctorsDepth.ToString("pending_functors_depth");
+  result += '\n';
+  result += timerLatenessUs.ToString("timer_lateness_us");
+  result += '\n';
+  char buf[64];
+  snprintf(buf, sizeof buf, "slowest_callback us=%" PRId64 " fd=%d\n",
+           SlowestCallbackUs(), SlowestCallbackFd());
+  result += buf;
+  return result;
+}
+
+void LoopStats::Reset() {
+  eventsPerPoll.Reset();
+  pollWaitUs.Reset();
+  callbackUs.Reset();
+  pendingFunctorsUs.Reset();
+  pendingFunctorsDepth.Reset();
+  timerLatenessUs.Reset();
+  intervalSlowestUs_ = 0;
+  intervalSlowestFd_ = -1;
+  slowestUs_.store(0, std::memory_order_relaxed);
+  slowestFd_.store(-1, std::memory_order_relaxed);
+}
+
+}  // namespace rnet::network
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "base/Common.h"
+#include "unix/Histogram.h"
+
+namespace rnet::network {
+
+// EventLoop 每一轮的耗时分布, 只由 loop 线程写入, 任意线程可读
+// 时间单位都是微秒
+struct LoopStats : Noncopyable {
+  // 统计最慢回调的周期
+  static constexpr int64_t kSlowestIntervalUs = 1000 * 1000;
+
+  Unix::Histogram eventsPerPoll;
+  // 上一轮结束到 epoll_wait 返回, 包括忙轮询的自旋
+  Unix::Histogram pollWaitUs;
+  // 一轮中处理全部 channel 事件的时间, 定时器回调也在其中
+  Unix::Histogram callbackUs;
+  Unix::Histogram pendingFunctorsUs;
+  // 每次 DoPendingFunctors 取出的任务数
+  Unix::Histogram pendingFunctorsDepth;
+  // 定时器实际执行时间减去到期时间
+  Unix::Histogram timerLatenessUs;
+
+  LoopStats();
+
+  // loop 线程调用, 记录一次 channel 回调
+  void RecordCallback(int fd, int64_t us) {
+    if (us > intervalSlowestUs_) {
+      intervalSlowestUs_ = us;
+      intervalSlowestFd_ = fd;
+    }
+  }
+  // loop 线程在每轮结束时调用, 周期结束时发布本周期最慢的回调
+  void EndIteration(int64_t nowUs);
+
+  // 上一个完整周期内最慢的一次 channel 回调, 没有时为 0 和 -1
+  int64_t SlowestCallbackUs() const {
+    return slowestUs_.load(std::memory_order_relaxed);
+  }
+  int SlowestCallbackFd() const {
+    return slowestFd_.load(std::memory_order_relaxed);
+  }
+
+  // 每个直方图一行, 最后一行是最慢回调
+  std::string ToString() const;
+
+  // 只能在 loop 线程调用
+  void Reset();
+
+ private:
+  int64_t intervalStartUs_;
+  int64_t intervalSlowestUs_;
+  int intervalSlowestFd_;
+  std::atomic<int64_t> slowestUs_;
+  std::atomic<int> slowestFd_;
+};
+
+}  // namespace rnet::network
@@ -10,7 +10,7 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback& cb,
                                  const std::string& name)
     : loop_(nullptr),
       exiting_(false),
-      thread_(std::bind(&EventLoopThread::threadFunc, this), name),
+      thread_(std::bind(&EventLoopThread::ThreadFunc, this), name),
       mutex_(),
       cond_(),
       callback_(cb) {}
@@ -24,11 +24,11 @@ EventLoopThread::~EventLoopThread() {
     // still a tiny chance to call destructed object, if threadFunc exits just
     // now. but when EventLoopThread destructs, usually programming is exiting
     // anyway.
-    loop_->quit();
+    loop_->Quit();
     thread_.Join();
   }
 }
-EventLoop* EventLoopThread::startLoop() {
+EventLoop* EventLoopThread::StartLoop() {
   assert(!thread_.Started());
   thread_.Start();
 
@@ -44,7 +44,7 @@ EventLoop* EventLoopThread::startLoop() {
   return loop;
 }
 
-void EventLoopThread::threadFunc() {
+void EventLoopThread::ThreadFunc() {
   EventLoop loop;
 
   if (callback_) {
@@ -57,7 +57,7 @@ void EventLoopThread::threadFunc() {
     cond_.notify_one();
   }
   //开启事件循环等待io
-  loop.loop();
+  loop.Loop();
   // 程序一般不会走到这里
   // assert(exiting_);
   std::lock_guard lock(mutex_);
@@ -65,4 +65,4 @@ void EventLoopThread::threadFunc() {
   // ? set tLocalThread to nullptr
 }
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
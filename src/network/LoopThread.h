@@ -33,4 +33,4 @@ class EventLoopThread : Noncopyable {
   std::condition_variable cond_;
   ThreadInitCallback callback_;
 };
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
@@ -2,8 +2,11 @@
 
 #include <cassert>
 
+#include "log/Logger.h"
 #include "network/EventLoop.h"
 #include "network/LoopThread.h"
+#include "unix/CpuSet.h"
+#include "unix/Thread.h"
 
 namespace rnet::network {
 
@@ -14,48 +17,147 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop,
       name_(nameArg),
       started_(false),
       numThreads_(0),
-      next_(0) {}
+      next_(0),
+      strategy_(kRoundRobin),
+      randomState_(reinterpret_cast<uintptr_t>(this) | 1),
+      numaLocalMemory_(false),
+      busyPollUs_(0) {}
 
 // loop thread 析构会自动join线程
 EventLoopThreadPool::~EventLoopThreadPool() = default;
 
-void EventLoopThreadPool::start(const ThreadInitCallback& cb) {
+void EventLoopThreadPool::Start(const ThreadInitCallback& cb) {
   assert(!started_);
   baseLoop_->AssertInLoopThread();
 
   started_ = true;
 
+  placements_.resize(numThreads_ == 0 ? 1 : static_cast<size_t>(numThreads_));
   for (int i = 0; i < numThreads_; ++i) {
     char buf[name_.size() + 32];
     snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-    auto t = new EventLoopThread(cb, buf);
+    auto t = new EventLoopThread(PlacedInitCallback(i, cb), buf);
     threads_.push_back(std::unique_ptr<EventLoopThread>(t));
-    loops_.push_back(t->startLoop());
+    loops_.push_back(t->StartLoop());
   }
-  if (numThreads_ == 0 && cb) {
-    cb(baseLoop_);
+  if (numThreads_ == 0) {
+    PlacedInitCallback(0, cb)(baseLoop_);
   }
 }
 
+// 回调在 loop 线程中执行, StartLoop 返回前已经执行完毕, 可以直接写 placements_
+// 绑定放在用户回调之前, 回调里分配的内存也落在本地节点上
+EventLoopThreadPool::ThreadInitCallback EventLoopThreadPool::PlacedInitCallback(
+    int index, const ThreadInitCallback& cb) {
+  return [this, index, cb](EventLoop* loop) {
+    LoopPlacement& placement = placements_[static_cast<size_t>(index)];
+    placement.name = thread::Name();
+    placement.cpu = -1;
+    placement.numaNode = -1;
+    if (!cpus_.empty()) {
+      int cpu = cpus_[static_cast<size_t>(index) % cpus_.size()];
+      if (Unix::SetThreadAffinity({cpu})) {
+        placement.cpu = cpu;
+        placement.numaNode = Unix::NumaNodeOfCpu(cpu);
+        if (numaLocalMemory_ && !Unix::PreferNumaNode(placement.numaNode)) {
+          LOG_SYSERR << "EventLoopThreadPool [" << name_
+                     << "] set_mempolicy node " << placement.numaNode;
+        }
+      } else {
+        LOG_SYSERR << "EventLoopThreadPool [" << name_ << "] pin "
+                   << placement.name << " to cpu " << cpu;
+      }
+      LOG_INFO << "EventLoopThreadPool [" << name_ << "] " << placement.name
+               << " -> cpu " << placement.cpu << " node "
+               << placement.numaNode;
+    }
+    loop->SetBusyPoll(busyPollUs_);
+    if (cb) {
+      cb(loop);
+    }
+  };
+}
+
 // 如果只有base loop 就返回
-// 如果有工作线程,将从返回工作线程loop
-EventLoop* EventLoopThreadPool::getNextLoop() {
+// 如果有工作线程,按 strategy 从工作线程中选一个
+EventLoop* EventLoopThreadPool::GetNextLoop() {
   baseLoop_->AssertInLoopThread();
   assert(started_);
   EventLoop* loop = baseLoop_;
 
   if (!loops_.empty()) {
-    // round-robin
-    loop = loops_[next_];
-    ++next_;
-    if (implicit_cast<size_t>(next_) >= loops_.size()) {
-      next_ = 0;
+    size_t index = 0;
+    if (selector_) {
+      index = selector_(loops_);
+      assert(index < loops_.size());
+    } else {
+      switch (strategy_) {
+        case kRoundRobin:
+          index = static_cast<size_t>(next_);
+          ++next_;
+          if (implicit_cast<size_t>(next_) >= loops_.size()) {
+            next_ = 0;
+          }
+          break;
+        case kLeastConnections:
+          index = SelectLeast(
+              [](const EventLoop* l) { return l->NumConnections(); });
+          break;
+        case kLeastQueueSize:
+          index = SelectLeast([](const EventLoop* l) {
+            return static_cast<int>(l->QueueSize());
+          });
+          break;
+        case kPowerOfTwoBusy:
+          index = SelectPowerOfTwo();
+          break;
+      }
     }
+    loop = loops_[index];
   }
   return loop;
 }
 
-EventLoop* EventLoopThreadPool::getLoopForHash(size_t hashCode) {
+// 从 next_ 开始找, 负载相同时轮流选择, 避免总是落在第一个 loop 上
+size_t EventLoopThreadPool::SelectLeast(int (*load)(const EventLoop*)) {
+  size_t best = static_cast<size_t>(next_) % loops_.size();
+  int bestLoad = load(loops_[best]);
+  for (size_t i = 1; i < loops_.size() && bestLoad > 0; ++i) {
+    size_t index = (static_cast<size_t>(next_) + i) % loops_.size();
+    int current = load(loops_[index]);
+    if (current < bestLoad) {
+      best = index;
+      bestLoad = current;
+    }
+  }
+  next_ = static_cast<int>((best + 1) % loops_.size());
+  return best;
+}
+
+// 只读两个 loop 的计数, 比全量扫描便宜, 也不会让所有连接同时涌向同一个最空闲的 loop
+size_t EventLoopThreadPool::SelectPowerOfTwo() {
+  size_t n = loops_.size();
+  if (n == 1) {
+    return 0;
+  }
+  // xorshift64
+  randomState_ ^= randomState_ << 13;
+  randomState_ ^= randomState_ >> 7;
+  randomState_ ^= randomState_ << 17;
+  size_t first = randomState_ % n;
+  size_t second = (first + 1 + (randomState_ >> 32) % (n - 1)) % n;
+
+  const EventLoop* a = loops_[first];
+  const EventLoop* b = loops_[second];
+  int busyA = a->BusyPermille();
+  int busyB = b->BusyPermille();
+  if (busyA != busyB) {
+    return busyA < busyB ? first : second;
+  }
+  return a->NumConnections() <= b->NumConnections() ? first : second;
+}
+
+EventLoop* EventLoopThreadPool::GetLoopForHash(size_t hashCode) {
   baseLoop_->AssertInLoopThread();
   EventLoop* loop = baseLoop_;
 
@@ -65,7 +167,7 @@ EventLoop* EventLoopThreadPool::getLoopForHash(size_t hashCode) {
   return loop;
 }
 
-std::vector<EventLoop*> EventLoopThreadPool::getAllLoops() {
+std::vector<EventLoop*> EventLoopThreadPool::GetAllLoops() {
   baseLoop_->AssertInLoopThread();
   assert(started_);
   if (loops_.empty()) {
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -14,17 +15,54 @@ class EventLoopThreadPool : Noncopyable {
   //事件回调,注册到loop thread中
   using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+  // GetNextLoop 选择 io loop 的策略
+  enum Strategy {
+    kRoundRobin,
+    // 当前连接数最少的 loop
+    kLeastConnections,
+    // pending functor 队列最短的 loop
+    kLeastQueueSize,
+    // 随机取两个 loop, 选最近忙碌时间占比低的, 相同时选连接少的
+    kPowerOfTwoBusy,
+  };
+  // 自定义策略, 参数为全部 io loop, 返回选中的下标. 在 base loop 线程调用
+  using LoopSelector = std::function<size_t(const std::vector<EventLoop*>&)>;
+
+  // 一个 io 线程的放置结果, cpu 和 numaNode 为 -1 表示没有绑定
+  struct LoopPlacement {
+    std::string name;
+    int cpu;
+    int numaNode;
+  };
+
   EventLoopThreadPool(EventLoop* baseLoop, const std::string& nameArg);
   ~EventLoopThreadPool();
   // 设置io线程数量,默认为0 即io都在主线程做
   void SetThreadNum(int numThreads) { numThreads_ = numThreads; }
   void Start(const ThreadInitCallback& cb = ThreadInitCallback());
 
+  // 第 i 个 io 线程固定在 cpus[i % cpus.size()] 上, 必须在 start 之前调用
+  // 为空时不绑定, 由调度器决定, 没有io线程时绑定的是 base loop 所在线程
+  void SetCpuAffinity(std::vector<int> cpus) { cpus_ = std::move(cpus); }
+  // 绑定cpu后, io 线程自己分配的内存(如连接缓冲区扩容)优先取自该cpu的numa节点
+  void SetNumaLocalMemory(bool on) { numaLocalMemory_ = on; }
+  // 所有 io loop 开启忙轮询, 见 EventLoop::SetBusyPoll. 必须在 start 之前调用
+  // 通常和 SetCpuAffinity 一起使用, 让自旋的 loop 独占各自的 cpu
+  void SetBusyPoll(int64_t spinUs) { busyPollUs_ = spinUs; }
+  // start 之后可用, 下标与 GetAllLoops 一致
+  const std::vector<LoopPlacement>& Placements() const { return placements_; }
+
+  void SetStrategy(Strategy strategy) { strategy_ = strategy; }
+  // 设置后代替 strategy
+  void SetLoopSelector(LoopSelector selector) {
+    selector_ = std::move(selector);
+  }
+
   // 暴露给tcp server用于分发tcp connection任务,
   // 在start调用后才能调用,否则断言失败程序崩溃
   EventLoop* GetNextLoop();
 
-  // 简单对hash code 取余选取loop
+  // 简单对hash code 取余选取loop, 同一个 hash 总是落在同一个 loop, 不受 strategy 影响
   EventLoop* GetLoopForHash(size_t hashCode);
 
   std::vector<EventLoop*> GetAllLoops();
@@ -34,13 +72,25 @@ class EventLoopThreadPool : Noncopyable {
   const std::string& Name() const { return name_; }
 
  private:
+  // 包装用户的回调, 在 loop 线程里先绑定 cpu 和 numa 节点, 设置忙轮询
+  ThreadInitCallback PlacedInitCallback(int index, const ThreadInitCallback& cb);
+  size_t SelectLeast(int (*load)(const EventLoop*));
+  size_t SelectPowerOfTwo();
+
   EventLoop* baseLoop_;
   std::string name_;
   bool started_;
   int numThreads_;
   int next_;
+  Strategy strategy_;
+  LoopSelector selector_;
+  uint64_t randomState_;
   std::vector<std::unique_ptr<EventLoopThread>> threads_;
   std::vector<EventLoop*> loops_;
+  std::vector<int> cpus_;
+  bool numaLocalMemory_;
+  int64_t busyPollUs_;
+  std::vector<LoopPlacement> placements_;
 };
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
@@ -41,7 +41,7 @@ InetAddress::InetAddress(uint16_t portArg, bool loopbackOnly, bool ipv6) {
 InetAddress::InetAddress(std::string_view ip, uint16_t portArg, bool ipv6) {
   if (ipv6 || strchr(ip.data(), ':')) {
     MemZero(&addr6_, sizeof addr6_);
-    network::sockets::fromIpPort(ip.data(), portArg, &addr6_);
+    network::sockets::FromIpPort(ip.data(), portArg, &addr6_);
   } else {
     MemZero(&addr_, sizeof addr_);
     network::sockets::FromIpPort(ip.data(), portArg, &addr_);
@@ -65,7 +65,7 @@ uint32_t InetAddress::Ipv4NetEndian() const {
   return addr_.sin_addr.s_addr;
 }
 
-uint16_t InetAddress::port() const { return networkToHost16(portNetEndian()); }
+uint16_t InetAddress::Port() const { return NetworkToHost16(PortNetEndian()); }
 
 // host name resolve buffer
 static thread_local char tResolveBuffer[64 * 1024];
@@ -92,7 +92,7 @@ bool InetAddress::Resolve(std::string_view hostname, InetAddress* out) {
 }
 
 void InetAddress::SetScopeId(uint32_t scope_id) {
-  if (family() == AF_INET6) {
+  if (Family() == AF_INET6) {
     addr6_.sin6_scope_id = scope_id;
   }
 }
\ No newline at end of file
@@ -33,7 +33,7 @@ class InetAddress : public Copyable {
   // default copy/assignment are Okay
 
   const struct sockaddr* GetSockAddr() const {
-    return network::sockets::sockaddr_cast(&addr6_);
+    return network::sockets::SockaddrCast(&addr6_);
   }
   void SetSockAddrInet6(const struct sockaddr_in6& addr6) { addr6_ = addr6; }
 
@@ -43,6 +43,7 @@ class InetAddress : public Copyable {
   // resolve hostname to IP address, not changing port or sin_family
   // return true on success.
   // thread safe
+  // 阻塞调用, 不要在 loop 线程中使用, 改用 network::Resolver
   static bool Resolve(std::string_view hostname, InetAddress* result);
   // static std::vector<InetAddress> resolveAll(const char* hostname, uint16_t
   // port = 0);
@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "network/EventLoop.h"
+#include "unix/TaskPool.h"
+
+namespace rnet::network {
+
+// 在计算线程池中执行 work, 完成后回到 loop 所在线程调用 done(work 的返回值)
+// work 在计算线程执行, 不要访问 loop 上的对象, 需要的数据按值捕获
+// done 在 loop 线程执行, 可以直接使用该 loop 上的 TcpConnection, 例如:
+//   Offload(pool, conn->GetLoop(),
+//           [request] { return Render(request); },
+//           [conn](std::string response) { conn->Send(response); });
+// work 和 done 需要可复制 (存放在 std::function 中)
+template <typename Work, typename Done>
+void Offload(thread::TaskPool* pool, EventLoop* loop, Work work, Done done) {
+  using Result = std::invoke_result_t<Work&>;
+  pool->Submit([loop, work = std::move(work), done = std::move(done)]() mutable {
+    if constexpr (std::is_void_v<Result>) {
+      work();
+      loop->QueueInLoop(std::move(done));
+    } else {
+      auto result = std::make_shared<Result>(work());
+      loop->QueueInLoop([done = std::move(done), result]() mutable {
+        done(std::move(*result));
+      });
+    }
+  });
+}
+
+}  // namespace rnet::network
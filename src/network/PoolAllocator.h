@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "base/Common.h"
+
+namespace rnet::network {
+
+// 给 std::allocate_shared 用的分配器, 单个对象的内存块缓存在线程局部的空闲链表里,
+// 对象和 shared_ptr 的控制块在同一块按缓存行对齐的内存里
+// 块缓存在释放它的线程, 不会还给分配它的线程: 只有分配和释放在同一个线程时才能复用.
+// TcpServer 在连接所属的 io loop 中创建连接, 连接也在那里销毁.
+// 总是在 A 线程分配, B 线程释放时, B 的缓存只进不出, A 每次都向系统申请.
+// 每个线程最多缓存 kMaxCachedBlocks 块, 超出的直接归还给系统
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  static constexpr size_t kMaxCachedBlocks = 1024;
+
+  PoolAllocator() = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}  // NOLINT: rebind
+
+  T* allocate(size_t n) {
+    if (n == 1) {
+      std::vector<void*>& blocks = Cache().blocks;
+      if (!blocks.empty()) {
+        void* p = blocks.back();
+        blocks.pop_back();
+        return static_cast<T*>(p);
+      }
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T), kAlign));
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (n == 1) {
+      std::vector<void*>& blocks = Cache().blocks;
+      if (blocks.size() < kMaxCachedBlocks) {
+        blocks.push_back(p);
+        return;
+      }
+    }
+    ::operator delete(p, kAlign);
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>&) const {
+    return false;
+  }
+
+ private:
+  static constexpr std::align_val_t kAlign{
+      alignof(T) > kCacheLineSize ? alignof(T) : kCacheLineSize};
+
+  struct BlockCache {
+    std::vector<void*> blocks;
+    ~BlockCache() {
+      for (void* p : blocks) {
+        ::operator delete(p, kAlign);
+      }
+    }
+  };
+
+  static BlockCache& Cache() {
+    thread_local BlockCache cache;
+    return cache;
+  }
+};
+
+}  // namespace rnet::network
@@ -0,0 +1,525 @@
+#include "network/Resolver.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+#include "log/Logger.h"
+#include "network/Endian.h"
+#include "network/EventLoop.h"
+#include "network/SocketOps.h"
+
+using namespace rnet;
+namespace rnet::network {
+
+namespace {
+
+const uint16_t kTypeA = 1;
+const uint16_t kTypeAAAA = 28;
+const uint16_t kTypeSOA = 6;
+const uint16_t kClassIN = 1;
+const uint16_t kFlagResponse = 0x8000;
+const uint16_t kFlagTruncated = 0x0200;
+const uint16_t kFlagRecursionDesired = 0x0100;
+const int kRcodeNoError = 0;
+const int kRcodeNxDomain = 3;
+const size_t kHeaderSize = 12;
+const size_t kMaxMessageSize = 4096;
+
+void Put16(std::string* out, uint16_t value) {
+  out->push_back(static_cast<char>(value >> 8));
+  out->push_back(static_cast<char>(value & 0xff));
+}
+
+// "www.example.com" -> 3www7example3com0
+bool EncodeName(std::string_view name, std::string* out) {
+  if (!name.empty() && name.back() == '.') {
+    name.remove_suffix(1);
+  }
+  if (name.empty() || name.size() > 253) {
+    return false;
+  }
+  for (size_t start = 0; start <= name.size();) {
+    size_t dot = std::min(name.find('.', start), name.size());
+    size_t len = dot - start;
+    if (len == 0 || len > 63) {
+      return false;
+    }
+    out->push_back(static_cast<char>(len));
+    out->append(name.substr(start, len));
+    start = dot + 1;
+  }
+  out->push_back('\0');
+  return true;
+}
+
+bool EncodeQuery(uint16_t id, std::string_view name, uint16_t qtype,
+                 std::string* packet) {
+  packet->clear();
+  Put16(packet, id);
+  Put16(packet, kFlagRecursionDesired);
+  Put16(packet, 1);  // qdcount
+  Put16(packet, 0);
+  Put16(packet, 0);
+  Put16(packet, 0);
+  if (!EncodeName(name, packet)) {
+    return false;
+  }
+  Put16(packet, qtype);
+  Put16(packet, kClassIN);
+  return true;
+}
+
+// 按顺序读取报文, 越界后 ok 变为 false, 之后读到的都是 0
+class Reader {
+ public:
+  Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  bool Ok() const { return ok_; }
+  size_t Position() const { return pos_; }
+
+  uint16_t U16() {
+    if (!Require(2)) {
+      return 0;
+    }
+    auto value = static_cast<uint16_t>(data_[pos_] << 8 | data_[pos_ + 1]);
+    pos_ += 2;
+    return value;
+  }
+  uint32_t U32() {
+    uint32_t high = U16();
+    return high << 16 | U16();
+  }
+  const uint8_t* Bytes(size_t n) {
+    if (!Require(n)) {
+      return nullptr;
+    }
+    const uint8_t* p = data_ + pos_;
+    pos_ += n;
+    return p;
+  }
+  // 跳过一个名字, 遇到压缩指针即结束
+  void SkipName() {
+    while (Require(1)) {
+      uint8_t len = data_[pos_];
+      if ((len & 0xc0) == 0xc0) {
+        Bytes(2);
+        return;
+      }
+      if ((len & 0xc0) != 0) {
+        ok_ = false;
+        return;
+      }
+      Bytes(1u + len);
+      if (len == 0) {
+        return;
+      }
+    }
+  }
+
+ private:
+  bool Require(size_t n) {
+    if (ok_ && size_ - pos_ < n) {
+      ok_ = false;
+    }
+    return ok_;
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+struct Response {
+  uint16_t flags = 0;
+  std::vector<InetAddress> addrs;
+  uint32_t ttl = UINT32_MAX;     // 回答中最小的 TTL
+  uint32_t soaTtl = UINT32_MAX;  // 否定响应的缓存时间, RFC 2308
+};
+
+// 名字按 ASCII 不区分大小写比较 (RFC 4343), 结尾的 QTYPE 和 QCLASS 逐字节比较.
+// 比较 question 的全部字节, 不能在名字结尾的 '\0' 处停下
+bool SameQuestion(const uint8_t* data, std::string_view question) {
+  const size_t kTypeAndClass = 4;
+  size_t nameSize = question.size() - kTypeAndClass;
+  for (size_t i = 0; i < question.size(); ++i) {
+    auto c = static_cast<unsigned char>(question[i]);
+    if (i < nameSize ? std::tolower(data[i]) != std::tolower(c)
+                     : data[i] != c) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// question 是查询报文中头部之后的部分, 响应中的问题必须与之相同
+bool ParseResponse(const uint8_t* data, size_t size, uint16_t qtype,
+                   std::string_view question, Response* response) {
+  if (size < kHeaderSize + question.size() ||
+      !SameQuestion(data + kHeaderSize, question)) {
+    return false;
+  }
+  Reader reader(data, size);
+  reader.U16();  // id
+  response->flags = reader.U16();
+  uint16_t qdcount = reader.U16();
+  uint16_t ancount = reader.U16();
+  uint16_t nscount = reader.U16();
+  reader.U16();  // arcount
+  if (!(response->flags & kFlagResponse) || qdcount != 1) {
+    return false;
+  }
+  reader.Bytes(question.size());
+
+  for (uint16_t i = 0; i < ancount && reader.Ok(); ++i) {
+    reader.SkipName();
+    uint16_t type = reader.U16();
+    uint16_t cls = reader.U16();
+    uint32_t ttl = reader.U32();
+    uint16_t rdlength = reader.U16();
+    const uint8_t* rdata = reader.Bytes(rdlength);
+    if (rdata == nullptr || cls != kClassIN) {
+      continue;
+    }
+    // CNAME 链上每一条记录的 TTL 都要算上
+    response->ttl = std::min(response->ttl, ttl);
+    if (type == kTypeA && type == qtype && rdlength == 4) {
+      struct sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      std::copy(rdata, rdata + 4, reinterpret_cast<uint8_t*>(&addr.sin_addr));
+      response->addrs.emplace_back(addr);
+    } else if (type == kTypeAAAA && type == qtype && rdlength == 16) {
+      struct sockaddr_in6 addr = {};
+      addr.sin6_family = AF_INET6;
+      std::copy(rdata, rdata + 16, addr.sin6_addr.s6_addr);
+      response->addrs.emplace_back(addr);
+    }
+  }
+  // 否定缓存时间取 SOA 记录的 TTL 与其 MINIMUM 字段中较小的一个
+  for (uint16_t i = 0; i < nscount && reader.Ok(); ++i) {
+    reader.SkipName();
+    uint16_t type = reader.U16();
+    reader.U16();
+    uint32_t ttl = reader.U32();
+    uint16_t rdlength = reader.U16();
+    const uint8_t* rdata = reader.Bytes(rdlength);
+    if (rdata != nullptr && type == kTypeSOA && rdlength >= 4) {
+      Reader minimum(rdata + rdlength - 4, 4);
+      response->soaTtl = std::min({response->soaTtl, ttl, minimum.U32()});
+    }
+  }
+  return reader.Ok();
+}
+
+InetAddress WithPort(const InetAddress& addr, uint16_t port) {
+  if (addr.Family() == AF_INET) {
+    struct sockaddr_in sa = *sockets::SockaddrInCast(addr.GetSockAddr());
+    sa.sin_port = HostToNetwork16(port);
+    return InetAddress(sa);
+  }
+  struct sockaddr_in6 sa = *sockets::SockaddrIn6Cast(addr.GetSockAddr());
+  sa.sin6_port = HostToNetwork16(port);
+  return InetAddress(sa);
+}
+
+std::string CacheKey(std::string_view hostname, uint16_t qtype) {
+  std::string key(hostname);
+  if (!key.empty() && key.back() == '.') {
+    key.pop_back();
+  }
+  std::transform(key.begin(), key.end(), key.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  key += qtype == kTypeA ? "/A" : "/AAAA";
+  return key;
+}
+
+}  // namespace
+
+const std::shared_ptr<DnsCache>& DnsCache::Default() {
+  static const std::shared_ptr<DnsCache> cache = std::make_shared<DnsCache>();
+  return cache;
+}
+
+DnsCache::Result DnsCache::Lookup(const std::string& key, Unix::Timestamp now,
+                                  std::vector<InetAddress>* addrs) {
+  std::lock_guard lock{mutex_};
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return kMiss;
+  }
+  if (!(now < it->second.expiration)) {
+    entries_.erase(it);
+    return kMiss;
+  }
+  *addrs = it->second.addrs;
+  return addrs->empty() ? kNegative : kHit;
+}
+
+void DnsCache::Insert(const std::string& key, std::vector<InetAddress> addrs,
+                      double ttl, Unix::Timestamp now) {
+  if (ttl <= 0) {
+    return;
+  }
+  std::lock_guard lock{mutex_};
+  if (entries_.size() >= kMaxEntries && entries_.count(key) == 0) {
+    // 先清掉过期的, 仍然满时整个丢弃, 缓存只是优化
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      it = now < it->second.expiration ? std::next(it) : entries_.erase(it);
+    }
+    if (entries_.size() >= kMaxEntries) {
+      entries_.clear();
+    }
+  }
+  Entry& entry = entries_[key];
+  entry.addrs = std::move(addrs);
+  entry.expiration = Unix::AddTime(now, ttl);
+}
+
+size_t DnsCache::Size() const {
+  std::lock_guard lock{mutex_};
+  return entries_.size();
+}
+
+void DnsCache::Clear() {
+  std::lock_guard lock{mutex_};
+  entries_.clear();
+}
+
+Resolver::Resolver(EventLoop* loop, const InetAddress& nameserver)
+    : Resolver(loop, nameserver, Options()) {}
+
+Resolver::Resolver(EventLoop* loop, const InetAddress& nameserver,
+                   const Options& options, std::shared_ptr<DnsCache> cache)
+    : loop_(CHECK_NOTNULL(loop)),
+      options_(options),
+      cache_(std::move(cache)),
+      socket_(sockets::CreateUdpNonblockingOrDie(nameserver.Family())),
+      channel_(loop, socket_.Fd()),
+      idGenerator_(std::random_device()()) {
+  // connect 之后内核只接收来自 nameserver 的报文
+  if (sockets::Connect(socket_.Fd(), nameserver.GetSockAddr()) < 0) {
+    LOG_SYSERR << "Resolver::Resolver connect " << nameserver.ToIpPort();
+  }
+  channel_.SetReadCallback([this](Unix::Timestamp) { HandleRead(); });
+}
+
+Resolver::~Resolver() {
+  for (auto& [id, query] : queries_) {
+    loop_->Cancel(query->timer);
+  }
+  if (channel_.IsReading()) {
+    channel_.DisableAll();
+    channel_.Remove();
+  }
+}
+
+void Resolver::Resolve(std::string_view hostname, uint16_t port, Callback cb,
+                       sa_family_t family) {
+  loop_->AssertInLoopThread();
+  std::string host(hostname);
+  if (family == AF_INET6) {
+    struct sockaddr_in6 addr = {};
+    if (::inet_pton(AF_INET6, host.c_str(), &addr.sin6_addr) == 1) {
+      addr.sin6_family = AF_INET6;
+      cb({WithPort(InetAddress(addr), port)});
+      return;
+    }
+  } else {
+    struct sockaddr_in addr = {};
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) == 1) {
+      addr.sin_family = AF_INET;
+      cb({WithPort(InetAddress(addr), port)});
+      return;
+    }
+  }
+
+  uint16_t qtype = family == AF_INET6 ? kTypeAAAA : kTypeA;
+  std::string key = CacheKey(hostname, qtype);
+  std::vector<InetAddress> addrs;
+  switch (cache_->Lookup(key, Unix::Timestamp::Now(), &addrs)) {
+    case DnsCache::kHit:
+      for (auto& addr : addrs) {
+        addr = WithPort(addr, port);
+      }
+      cb(addrs);
+      return;
+    case DnsCache::kNegative:
+      cb(addrs);
+      return;
+    case DnsCache::kMiss:
+      break;
+  }
+
+  auto inflight = inflight_.find(key);
+  if (inflight != inflight_.end()) {
+    queries_[inflight->second]->waiters.emplace_back(port, std::move(cb));
+    return;
+  }
+
+  auto query = std::make_unique<Query>();
+  query->id = NextId();
+  query->qtype = qtype;
+  query->key = key;
+  query->attemptsLeft = options_.attempts;
+  if (!EncodeQuery(query->id, hostname, qtype, &query->packet)) {
+    LOG_ERROR << "Resolver::Resolve - invalid hostname " << host;
+    cb({});
+    return;
+  }
+  query->waiters.emplace_back(port, std::move(cb));
+  Query* raw = query.get();
+  inflight_[key] = raw->id;
+  queries_[raw->id] = std::move(query);
+  Send(raw);
+}
+
+// 随机的 id, 避免与未完成的查询重复
+uint16_t Resolver::NextId() {
+  std::uniform_int_distribution<uint16_t> dist;
+  uint16_t id = dist(idGenerator_);
+  while (queries_.count(id) != 0) {
+    id = dist(idGenerator_);
+  }
+  return id;
+}
+
+void Resolver::Send(Query* query) {
+  if (!channel_.IsReading()) {
+    channel_.EnableReading();
+  }
+  --query->attemptsLeft;
+  ssize_t n =
+      sockets::Write(socket_.Fd(), query->packet.data(), query->packet.size());
+  if (n < 0) {
+    // 发送失败按超时处理, 由定时器重发
+    LOG_SYSERR << "Resolver::Send " << query->key;
+  }
+  uint16_t id = query->id;
+  query->timer =
+      loop_->RunAfter(options_.timeout, [this, id] { HandleTimeout(id); });
+}
+
+void Resolver::HandleRead() {
+  loop_->AssertInLoopThread();
+  uint8_t buf[kMaxMessageSize];
+  for (;;) {
+    ssize_t n = sockets::Read(socket_.Fd(), buf, sizeof buf);
+    if (n < 0) {
+      if (errno == ECONNREFUSED) {
+        // nameserver 端口不可达, 等超时重发
+        LOG_WARN << "Resolver::HandleRead - nameserver unreachable";
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG_SYSERR << "Resolver::HandleRead";
+      }
+      break;
+    }
+    auto size = static_cast<size_t>(n);
+    if (size < kHeaderSize) {
+      continue;
+    }
+    auto id = static_cast<uint16_t>(buf[0] << 8 | buf[1]);
+    auto it = queries_.find(id);
+    if (it == queries_.end()) {
+      continue;
+    }
+    Query* query = it->second.get();
+    Response response;
+    std::string_view question(query->packet);
+    question.remove_prefix(kHeaderSize);
+    if (!ParseResponse(buf, size, query->qtype, question, &response)) {
+      LOG_WARN << "Resolver::HandleRead - malformed response for "
+               << query->key;
+      continue;
+    }
+
+    int rcode = response.flags & 0x0f;
+    if (response.flags & kFlagTruncated) {
+      LOG_WARN << "Resolver::HandleRead - truncated response for "
+               << query->key;
+      Finish(id, {}, 0, false);
+    } else if (rcode == kRcodeNxDomain ||
+               (rcode == kRcodeNoError && response.addrs.empty())) {
+      double ttl = response.soaTtl == UINT32_MAX
+                       ? options_.negativeTtl
+                       : static_cast<double>(response.soaTtl);
+      Finish(id, {}, std::min(ttl, options_.maxTtl), true);
+    } else if (rcode == kRcodeNoError) {
+      Finish(id, response.addrs,
+             std::min(static_cast<double>(response.ttl), options_.maxTtl),
+             true);
+    } else {
+      // SERVFAIL, REFUSED 等不缓存
+      LOG_WARN << "Resolver::HandleRead - rcode " << rcode << " for "
+               << query->key;
+      Finish(id, {}, 0, false);
+    }
+  }
+}
+
+void Resolver::HandleTimeout(uint16_t id) {
+  auto it = queries_.find(id);
+  if (it == queries_.end()) {
+    return;
+  }
+  Query* query = it->second.get();
+  if (query->attemptsLeft > 0) {
+    LOG_DEBUG << "Resolver::HandleTimeout - resend " << query->key;
+    Send(query);
+  } else {
+    LOG_WARN << "Resolver::HandleTimeout - " << query->key << " timed out";
+    Finish(id, {}, 0, false);
+  }
+}
+
+// 先把查询摘下再回调, 回调里可以再次 Resolve
+void Resolver::Finish(uint16_t id, const std::vector<InetAddress>& addrs,
+                      double ttl, bool cacheable) {
+  auto it = queries_.find(id);
+  std::unique_ptr<Query> query = std::move(it->second);
+  queries_.erase(it);
+  inflight_.erase(query->key);
+  loop_->Cancel(query->timer);
+  if (cacheable) {
+    cache_->Insert(query->key, addrs, ttl, Unix::Timestamp::Now());
+  }
+
+  std::vector<InetAddress> result;
+  for (auto& [port, cb] : query->waiters) {
+    result.clear();
+    for (const auto& addr : addrs) {
+      result.push_back(WithPort(addr, port));
+    }
+    cb(result);
+  }
+}
+
+InetAddress Resolver::SystemNameserver() {
+  std::ifstream in("/etc/resolv.conf");
+  std::string line;
+  while (std::getline(in, line)) {
+    const std::string_view kKeyword = "nameserver";
+    if (line.compare(0, kKeyword.size(), kKeyword) != 0) {
+      continue;
+    }
+    size_t begin = line.find_first_not_of(" \t", kKeyword.size());
+    if (begin == std::string::npos || begin == kKeyword.size()) {
+      continue;
+    }
+    size_t end = line.find_first_of(" \t#;", begin);
+    std::string ip = line.substr(begin, end - begin);
+    // 带 scope id 的链路本地地址不支持
+    if (ip.find('%') != std::string::npos) {
+      continue;
+    }
+    bool ipv6 = ip.find(':') != std::string::npos;
+    return InetAddress(ip, 53, ipv6);
+  }
+  return InetAddress("127.0.0.1", 53);
+}
+
+}  // namespace rnet::network
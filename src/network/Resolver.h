@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "base/Common.h"
+#include "network/Channel.h"
+#include "network/NetAddress.h"
+#include "network/Socket.h"
+#include "network/TimerId.h"
+#include "unix/Time.h"
+namespace rnet::network {
+
+class EventLoop;
+
+// 多个 loop 共享的解析结果缓存, 线程安全
+// 记录按 TTL 过期; 不存在的名字(NXDOMAIN 或没有记录)也缓存, addrs 为空
+class DnsCache : Noncopyable {
+ public:
+  enum Result { kMiss, kHit, kNegative };
+  static const size_t kMaxEntries = 64 * 1024;
+
+  // 进程内默认的缓存, Resolver 未指定缓存时使用
+  static const std::shared_ptr<DnsCache>& Default();
+
+  Result Lookup(const std::string& key, Unix::Timestamp now,
+                std::vector<InetAddress>* addrs);
+  void Insert(const std::string& key, std::vector<InetAddress> addrs,
+              double ttl, Unix::Timestamp now);
+  size_t Size() const;
+  void Clear();
+
+ private:
+  struct Entry {
+    std::vector<InetAddress> addrs;
+    Unix::Timestamp expiration;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;  // guarded by mutex_
+};
+
+// 非阻塞的 DNS 解析, 绑定一个 EventLoop, 只能在 loop 线程中使用
+// 通过一个连接到 nameserver 的 UDP socket 发送查询, 响应由 Channel 的读事件处理,
+// 超时由定时器重发; 同一个名字正在查询时, 后来的请求合并到同一个查询上
+// 不支持截断响应后的 TCP 重试, 也不解析 /etc/hosts
+class Resolver : Noncopyable {
+ public:
+  // 解析失败时 addrs 为空
+  using Callback = std::function<void(const std::vector<InetAddress>& addrs)>;
+
+  struct Options {
+    // 单次查询的超时(秒)
+    double timeout = 1.0;
+    // 包括第一次在内的发送次数
+    int attempts = 3;
+    // 缓存时间的上限(秒)
+    double maxTtl = 3600;
+    // 否定响应没有带 SOA 记录时的缓存时间(秒)
+    double negativeTtl = 30;
+  };
+
+  Resolver(EventLoop* loop, const InetAddress& nameserver);
+  Resolver(EventLoop* loop, const InetAddress& nameserver,
+           const Options& options,
+           std::shared_ptr<DnsCache> cache = DnsCache::Default());
+  // 未完成的查询直接丢弃, 不再回调
+  ~Resolver();
+
+  // family 为 AF_INET 时查询 A 记录, AF_INET6 时查询 AAAA 记录,
+  // 结果中的地址端口都设为 port
+  // hostname 本身是 IP 地址或者缓存命中时, 在返回前回调
+  void Resolve(std::string_view hostname, uint16_t port, Callback cb,
+               sa_family_t family = AF_INET);
+
+  size_t PendingQueries() const { return queries_.size(); }
+
+  // /etc/resolv.conf 中的第一个 nameserver, 没有时为 127.0.0.1:53
+  static InetAddress SystemNameserver();
+
+ private:
+  struct Query {
+    uint16_t id;
+    uint16_t qtype;
+    std::string key;
+    std::string packet;  // 重发时原样发送
+    std::vector<std::pair<uint16_t, Callback>> waiters;  // (port, cb)
+    int attemptsLeft;
+    TimerId timer;
+  };
+
+  void Send(Query* query);
+  void HandleRead();
+  void HandleTimeout(uint16_t id);
+  void Finish(uint16_t id, const std::vector<InetAddress>& addrs, double ttl,
+              bool cacheable);
+  uint16_t NextId();
+
+  EventLoop* loop_;
+  const Options options_;
+  std::shared_ptr<DnsCache> cache_;
+  Socket socket_;
+  Channel channel_;
+  std::unordered_map<uint16_t, std::unique_ptr<Query>> queries_;
+  std::unordered_map<std::string, uint16_t> inflight_;  // key -> id
+  std::mt19937 idGenerator_;
+};
+
+}  // namespace rnet::network
@@ -1,5 +1,6 @@
 #include "network/Socket.h"
 
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
@@ -8,14 +9,15 @@
 #include "log/Logger.h"
 #include "network/NetAddress.h"
 #include "network/SocketOps.h"
+#include "network/UnixAddress.h"
 
 using namespace rnet;
 using namespace rnet::network;
 
 rnet::network::Socket::~Socket() {
   if (sockfd_ != nonValidSocketFd) {
-    LOG_ERROR << "close socket:" << sockfd_ << "\n";
-    Sockets::close(sockfd);
+    LOG_TRACE << "close socket:" << sockfd_;
+    sockets::Close(sockfd_);
   }
 }
 
@@ -50,38 +52,42 @@ bool rnet::network::Socket::GetTcpInfoString(char* buf, int len) const {
 }
 
 void rnet::network::Socket::BindAddress(const InetAddress& addr) {
-  Sockets::bindOrDie(sockfd_, addr.getSockAddr());
+  sockets::BindOrDie(sockfd_, addr.GetSockAddr());
 }
 
-void rnet::network::Socket::Listen() { Sockets::listenOrDie(sockfd); }
+void rnet::network::Socket::BindAddress(const UnixAddress& addr) {
+  sockets::BindOrDie(sockfd_, addr.GetSockAddr(), addr.Length());
+}
+
+void rnet::network::Socket::Listen() { sockets::ListenOrDie(sockfd_); }
 
 int rnet::network::Socket::Accept(InetAddress* peeraddr) {
   struct sockaddr_in6 addr;
   MemZero(&addr, sizeof addr);
-  int connfd = Sockets::accept(sockfd_, &addr);
+  int connfd = sockets::Accept(sockfd_, &addr);
   if (connfd >= 0) {
-    peeraddr->setSockAddrInet6(addr);
+    peeraddr->SetSockAddrInet6(addr);
   }
   return connfd;
 }
 
-void Socket::shutdownWrite() { Sockets::shutdownWrite(sockfd_); }
+void Socket::ShutdownWrite() { sockets::ShutdownWrite(sockfd_); }
 
-void Socket::setTcpNoDelay(bool on) {
+void Socket::SetTcpNoDelay(bool on) {
   int optval = on ? 1 : 0;
   ::setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY, &optval,
                static_cast<socklen_t>(sizeof optval));
   // FIXME CHECK
 }
 
-void Socket::setReuseAddr(bool on) {
+void Socket::SetReuseAddr(bool on) {
   int optval = on ? 1 : 0;
   ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &optval,
                static_cast<socklen_t>(sizeof optval));
   // FIXME CHECK
 }
 
-void Socket::setReusePort(bool on) {
+void Socket::SetReusePort(bool on) {
 #ifdef SO_REUSEPORT
   int optval = on ? 1 : 0;
   int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &optval,
@@ -96,9 +102,47 @@ void Socket::setReusePort(bool on) {
 #endif
 }
 
-void Socket::setKeepAlive(bool on) {
+void Socket::SetKeepAlive(bool on) {
   int optval = on ? 1 : 0;
   ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval,
                static_cast<socklen_t>(sizeof optval));
   // FIXME CHECK
 }
+
+bool Socket::SetBusyPoll(int usec) {
+#ifdef SO_BUSY_POLL
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec,
+                         static_cast<socklen_t>(sizeof usec));
+  if (ret < 0) {
+    LOG_SYSERR << "SO_BUSY_POLL failed.";
+  }
+  return ret == 0;
+#else
+  LOG_ERROR << "SO_BUSY_POLL is not supported.";
+  return false;
+#endif
+}
+
+// 组内 socket 的下标是加入 reuseport 组(listen)的顺序
+bool Socket::AttachReusePortCpuFilter(uint32_t groupSize) {
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  // A = 处理该连接 SYN 的 cpu; return A % groupSize
+  struct sock_filter code[] = {
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+       static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+      {BPF_ALU | BPF_MOD | BPF_K, 0, 0, groupSize},
+      {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  struct sock_fprog prog = {
+      static_cast<unsigned short>(sizeof code / sizeof code[0]), code};
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                         static_cast<socklen_t>(sizeof prog));
+  if (ret < 0) {
+    LOG_SYSERR << "SO_ATTACH_REUSEPORT_CBPF failed.";
+  }
+  return ret == 0;
+#else
+  LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF is not supported.";
+  return false;
+#endif
+}
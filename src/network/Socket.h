@@ -1,10 +1,13 @@
 #pragma once
 #include <netinet/tcp.h>
 
+#include <cstdint>
+
 #include "base/Common.h"
 
 namespace rnet::network {
 class InetAddress;
+class UnixAddress;
 
 ///
 /// Wrapper of socket file descriptor.
@@ -35,6 +38,7 @@ class Socket : Noncopyable {
 
   /// abort if address in use
   void BindAddress(const InetAddress& localaddr);
+  void BindAddress(const UnixAddress& localaddr);
   /// abort if address in use
   void Listen();
 
@@ -66,7 +70,19 @@ class Socket : Noncopyable {
   ///
   void SetKeepAlive(bool on);
 
+  ///
+  /// Set SO_BUSY_POLL, busy poll the device queue for up to @c usec
+  /// on blocking reads. Values above net.core.busy_read need CAP_NET_ADMIN.
+  ///
+  bool SetBusyPoll(int usec);
+
+  ///
+  /// Attach a SO_ATTACH_REUSEPORT_CBPF program to the reuseport group,
+  /// selecting socket (cpu % groupSize) for each incoming connection.
+  ///
+  bool AttachReusePortCpuFilter(uint32_t groupSize);
+
  private:
   int sockfd_;
 };
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
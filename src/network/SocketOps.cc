@@ -1,9 +1,11 @@
 #include "network/SocketOps.h"
 
+#include <netinet/tcp.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
 #include <cstdio>
+#include <cstring>
 #include <istream>
 
 #include "log/Logger.h"
@@ -12,6 +14,18 @@
 using namespace rnet;
 using namespace rnet::network;
 
+namespace {
+
+// 读到 sockaddr_in6 里的 AF_UNIX 地址只剩路径的开头几个字节, 没有意义, 清零
+void ClearUnixPath(struct sockaddr_in6* addr) {
+  if (addr->sin6_family == AF_UNIX) {
+    MemZero(addr, sizeof *addr);
+    addr->sin6_family = AF_UNIX;
+  }
+}
+
+}  // namespace
+
 const struct sockaddr* sockets::SockaddrCast(const struct sockaddr_in6* addr) {
   return static_cast<const struct sockaddr*>(implicit_cast<const void*>(addr));
 }
@@ -54,9 +68,30 @@ int sockets::CreateNonblockingOrDie(sa_family_t family) {
   return sockfd;
 }
 
+int sockets::CreateUdpNonblockingOrDie(sa_family_t family) {
+  int sockfd =
+      ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+  if (sockfd < 0) {
+    LOG_SYSFATAL << "sockets::CreateUdpNonblockingOrDie";
+  }
+  return sockfd;
+}
+
+int sockets::CreateUnixNonblockingOrDie(int type) {
+  int sockfd = ::socket(AF_UNIX, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sockfd < 0) {
+    LOG_SYSFATAL << "sockets::CreateUnixNonblockingOrDie";
+  }
+  return sockfd;
+}
+
 void sockets::BindOrDie(int sockfd, const struct sockaddr* addr) {
-  int ret =
-      ::bind(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+  BindOrDie(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+}
+
+void sockets::BindOrDie(int sockfd, const struct sockaddr* addr,
+                        socklen_t addrlen) {
+  int ret = ::bind(sockfd, addr, addrlen);
   if (ret < 0) {
     LOG_SYSFATAL << "sockets::bindOrDie";
   }
@@ -69,18 +104,24 @@ void sockets::ListenOrDie(int sockfd) {
   }
 }
 
-int Sockets::accept(int sockfd, struct sockaddr_in6* addr) {
+int sockets::Accept(int sockfd, struct sockaddr_in6* addr) {
   auto addrlen = static_cast<socklen_t>(sizeof *addr);
 #if VALGRIND || defined(NO_ACCEPT4)
-  int connfd = ::accept(sockfd, sockaddr_cast(addr), &addrlen);
+  int connfd = ::accept(sockfd, SockaddrCast(addr), &addrlen);
   setNonBlockAndCloseOnExec(connfd);
 #else
-  int connfd = ::accept4(sockfd, sockaddr_cast(addr), &addrlen,
+  int connfd = ::accept4(sockfd, SockaddrCast(addr), &addrlen,
                          SOCK_NONBLOCK | SOCK_CLOEXEC);
 #endif
+  if (connfd >= 0) {
+    ClearUnixPath(addr);
+  }
   if (connfd < 0) {
     int savedErrno = errno;
-    LOG_SYSERR << "Sockets::accept";
+    // acceptor 会一直 accept 到 EAGAIN, 这不是错误
+    if (savedErrno != EAGAIN) {
+      LOG_SYSERR << "sockets::Accept";
+    }
     switch (savedErrno) {
       case EAGAIN:
       case ECONNABORTED:
@@ -110,85 +151,158 @@ int Sockets::accept(int sockfd, struct sockaddr_in6* addr) {
   return connfd;
 }
 
-int Sockets::connect(int sockfd, const struct sockaddr* addr) {
-  return ::connect(sockfd, addr,
-                   static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+int sockets::Connect(int sockfd, const struct sockaddr* addr) {
+  return Connect(sockfd, addr,
+                 static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
 }
 
-ssize_t Sockets::read(int sockfd, void* buf, size_t count) {
+int sockets::Connect(int sockfd, const struct sockaddr* addr,
+                     socklen_t addrlen) {
+  return ::connect(sockfd, addr, addrlen);
+}
+
+ssize_t sockets::Read(int sockfd, void* buf, size_t count) {
   return ::read(sockfd, buf, count);
 }
 
-ssize_t Sockets::readv(int sockfd, const struct iovec* iov, int iovcnt) {
+ssize_t sockets::Readv(int sockfd, const struct iovec* iov, int iovcnt) {
   return ::readv(sockfd, iov, iovcnt);
 }
 
-ssize_t Sockets::write(int sockfd, const void* buf, size_t count) {
+ssize_t sockets::Write(int sockfd, const void* buf, size_t count) {
   return ::write(sockfd, buf, count);
 }
 
-void Sockets::close(int sockfd) {
+ssize_t sockets::Writev(int sockfd, const struct iovec* iov, int iovcnt) {
+  return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::SendWithFds(int sockfd, const void* buf, size_t count,
+                             const int* fds, size_t numFds) {
+  assert(count > 0);
+  assert(numFds <= kMaxFdsPerMessage);
+  struct iovec iov = {const_cast<void*>(buf), count};
+  struct msghdr msg;
+  MemZero(&msg, sizeof msg);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) *
+                                                  kMaxFdsPerMessage)];
+  if (numFds > 0) {
+    MemZero(control, sizeof control);
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * numFds);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * numFds);
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * numFds);
+  }
+  // 对端已关闭时返回 EPIPE 而不是收到 SIGPIPE
+  return ::sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+}
+
+ssize_t sockets::RecvWithFds(int sockfd, const struct iovec* iov, int iovcnt,
+                             std::vector<int>* fds) {
+  struct msghdr msg;
+  MemZero(&msg, sizeof msg);
+  msg.msg_iov = const_cast<struct iovec*>(iov);
+  msg.msg_iovlen = static_cast<size_t>(iovcnt);
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) *
+                                                  kMaxFdsPerMessage)];
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  ssize_t n = ::recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+  if (n < 0) {
+    return n;
+  }
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const unsigned char* data = CMSG_DATA(cmsg);
+      for (size_t i = 0; i < count; ++i) {
+        int fd;
+        std::memcpy(&fd, data + i * sizeof fd, sizeof fd);
+        fds->push_back(fd);
+      }
+    }
+  }
+  if (msg.msg_flags & MSG_CTRUNC) {
+    // 进程的文件描述符用完时内核丢弃放不下的部分
+    LOG_ERROR << "sockets::RecvWithFds - file descriptors truncated";
+  }
+  return n;
+}
+
+void sockets::Close(int sockfd) {
   if (::close(sockfd) < 0) {
     LOG_SYSERR << "sockets::close";
   }
 }
 
-void Sockets::shutdownWrite(int sockfd) {
+void sockets::ShutdownWrite(int sockfd) {
   if (::shutdown(sockfd, SHUT_WR) < 0) {
     LOG_SYSERR << "sockets::shutdownWrite";
   }
 }
 
-void Sockets::toIpPort(char* buf, size_t size, const struct sockaddr* addr) {
+void sockets::ToIpPort(char* buf, size_t size, const struct sockaddr* addr) {
+  if (addr->sa_family == AF_UNIX) {
+    ToIp(buf, size, addr);
+    return;
+  }
   if (addr->sa_family == AF_INET6) {
     buf[0] = '[';
-    toIp(buf + 1, size - 1, addr);
+    ToIp(buf + 1, size - 1, addr);
     size_t end = ::strlen(buf);
-    const struct sockaddr_in6* addr6 = sockaddr_in6_cast(addr);
-    uint16_t port = networkToHost16(addr6->sin6_port);
+    const struct sockaddr_in6* addr6 = SockaddrIn6Cast(addr);
+    uint16_t port = NetworkToHost16(addr6->sin6_port);
     assert(size > end);
     snprintf(buf + end, size - end, "]:%u", port);
     return;
   }
-  toIp(buf, size, addr);
+  ToIp(buf, size, addr);
   size_t end = ::strlen(buf);
-  const struct sockaddr_in* addr4 = sockaddr_in_cast(addr);
-  uint16_t port = networkToHost16(addr4->sin_port);
+  const struct sockaddr_in* addr4 = SockaddrInCast(addr);
+  uint16_t port = NetworkToHost16(addr4->sin_port);
   assert(size > end);
   snprintf(buf + end, size - end, ":%u", port);
 }
 
-void Sockets::toIp(char* buf, size_t size, const struct sockaddr* addr) {
+void sockets::ToIp(char* buf, size_t size, const struct sockaddr* addr) {
   if (addr->sa_family == AF_INET) {
     assert(size >= INET_ADDRSTRLEN);
-    const struct sockaddr_in* addr4 = sockaddr_in_cast(addr);
+    const struct sockaddr_in* addr4 = SockaddrInCast(addr);
     ::inet_ntop(AF_INET, &addr4->sin_addr, buf, static_cast<socklen_t>(size));
   } else if (addr->sa_family == AF_INET6) {
     assert(size >= INET6_ADDRSTRLEN);
-    const struct sockaddr_in6* addr6 = sockaddr_in6_cast(addr);
+    const struct sockaddr_in6* addr6 = SockaddrIn6Cast(addr);
     ::inet_ntop(AF_INET6, &addr6->sin6_addr, buf, static_cast<socklen_t>(size));
+  } else if (addr->sa_family == AF_UNIX) {
+    snprintf(buf, size, "unix");
   }
 }
 
-void Sockets::fromIpPort(const char* ip, uint16_t port,
+void sockets::FromIpPort(const char* ip, uint16_t port,
                          struct sockaddr_in* addr) {
   addr->sin_family = AF_INET;
-  addr->sin_port = hostToNetwork16(port);
+  addr->sin_port = HostToNetwork16(port);
   if (::inet_pton(AF_INET, ip, &addr->sin_addr) <= 0) {
     LOG_SYSERR << "sockets::fromIpPort";
   }
 }
 
-void Sockets::fromIpPort(const char* ip, uint16_t port,
+void sockets::FromIpPort(const char* ip, uint16_t port,
                          struct sockaddr_in6* addr) {
   addr->sin6_family = AF_INET6;
-  addr->sin6_port = hostToNetwork16(port);
+  addr->sin6_port = HostToNetwork16(port);
   if (::inet_pton(AF_INET6, ip, &addr->sin6_addr) <= 0) {
     LOG_SYSERR << "sockets::fromIpPort";
   }
 }
 
-int Sockets::getSocketError(int sockfd) {
+int sockets::GetSocketError(int sockfd) {
   int optval;
   auto optlen = static_cast<socklen_t>(sizeof optval);
 
@@ -199,29 +313,42 @@ int Sockets::getSocketError(int sockfd) {
   }
 }
 
-struct sockaddr_in6 Sockets::getLocalAddr(int sockfd) {
+bool sockets::SetFastOpenConnect(int sockfd) {
+#ifdef TCP_FASTOPEN_CONNECT
+  int optval = 1;
+  return ::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &optval,
+                      static_cast<socklen_t>(sizeof optval)) == 0;
+#else
+  (void)sockfd;
+  return false;
+#endif
+}
+
+struct sockaddr_in6 sockets::GetLocalAddr(int sockfd) {
   struct sockaddr_in6 localaddr;
   MemZero(&localaddr, sizeof localaddr);
   auto addrlen = static_cast<socklen_t>(sizeof localaddr);
-  if (::getsockname(sockfd, sockaddr_cast(&localaddr), &addrlen) < 0) {
+  if (::getsockname(sockfd, SockaddrCast(&localaddr), &addrlen) < 0) {
     LOG_SYSERR << "sockets::getLocalAddr";
   }
+  ClearUnixPath(&localaddr);
   return localaddr;
 }
 
-struct sockaddr_in6 Sockets::getPeerAddr(int sockfd) {
+struct sockaddr_in6 sockets::GetPeerAddr(int sockfd) {
   struct sockaddr_in6 peeraddr;
   MemZero(&peeraddr, sizeof peeraddr);
   auto addrlen = static_cast<socklen_t>(sizeof peeraddr);
-  if (::getpeername(sockfd, sockaddr_cast(&peeraddr), &addrlen) < 0) {
+  if (::getpeername(sockfd, SockaddrCast(&peeraddr), &addrlen) < 0) {
     LOG_SYSERR << "sockets::getPeerAddr";
   }
+  ClearUnixPath(&peeraddr);
   return peeraddr;
 }
 
-bool Sockets::isSelfConnect(int sockfd) {
-  struct sockaddr_in6 localaddr = getLocalAddr(sockfd);
-  struct sockaddr_in6 peeraddr = getPeerAddr(sockfd);
+bool sockets::IsSelfConnect(int sockfd) {
+  struct sockaddr_in6 localaddr = GetLocalAddr(sockfd);
+  struct sockaddr_in6 peeraddr = GetPeerAddr(sockfd);
   if (localaddr.sin6_family == AF_INET) {
     const struct sockaddr_in* laddr4 =
         reinterpret_cast<struct sockaddr_in*>(&localaddr);
@@ -2,15 +2,24 @@
 #pragma once
 
 #include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <vector>
 
 namespace rnet::network::sockets {
 ///
 /// Creates a non-blocking socket file descriptor,
 /// abort if any error.
 int CreateNonblockingOrDie(sa_family_t family);
+int CreateUdpNonblockingOrDie(sa_family_t family);
+// AF_UNIX, type 为 SOCK_STREAM 或 SOCK_SEQPACKET
+int CreateUnixNonblockingOrDie(int type);
 
 int Connect(int sockfd, const struct sockaddr* addr);
+int Connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
 void BindOrDie(int sockfd, const struct sockaddr* addr);
+void BindOrDie(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
 void ListenOrDie(int sockfd);
 
 // 获取非阻塞套接字
@@ -18,6 +27,16 @@ int Accept(int sockfd, struct sockaddr_in6* addr);
 ssize_t Read(int sockfd, void* buf, size_t count);
 ssize_t Readv(int sockfd, const struct iovec* iov, int iovcnt);
 ssize_t Write(int sockfd, const void* buf, size_t count);
+ssize_t Writev(int sockfd, const struct iovec* iov, int iovcnt);
+// 一条消息最多携带的文件描述符个数 (内核的 SCM_MAX_FD)
+const size_t kMaxFdsPerMessage = 253;
+// unix socket 上随数据发送文件描述符 (SCM_RIGHTS), 内核为对端复制一份,
+// 调用者仍然持有 fds. stream socket 上 fds 随实际发出的第一个字节到达
+ssize_t SendWithFds(int sockfd, const void* buf, size_t count, const int* fds,
+                    size_t numFds);
+// 同 Readv, 收到的文件描述符追加到 *fds, 已经设置 close-on-exec
+ssize_t RecvWithFds(int sockfd, const struct iovec* iov, int iovcnt,
+                    std::vector<int>* fds);
 void Close(int sockfd);
 void ShutdownWrite(int sockfd);
 
@@ -28,6 +47,9 @@ void FromIpPort(const char* ip, uint16_t port, struct sockaddr_in* addr);
 void FromIpPort(const char* ip, uint16_t port, struct sockaddr_in6* addr);
 
 int GetSocketError(int sockfd);
+// TCP_FASTOPEN_CONNECT: 有 cookie 时 connect 立即返回 0, SYN 随第一次 write 带数据发出
+// 内核或头文件不支持时返回 false
+bool SetFastOpenConnect(int sockfd);
 
 const struct sockaddr* SockaddrCast(const struct sockaddr_in* addr);
 const struct sockaddr* SockaddrCast(const struct sockaddr_in6* addr);
@@ -39,4 +61,4 @@ struct sockaddr_in6 GetLocalAddr(int sockfd);
 struct sockaddr_in6 GetPeerAddr(int sockfd);
 bool IsSelfConnect(int sockfd);
 
-} // namespace rnet::Network::Sockets
\ No newline at end of file
+}  // namespace rnet::network::sockets
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "network/TcpClient.h"
+
+#include "log/Logger.h"
+#include "network/Connector.h"
+#include "network/EventLoop.h"
+#include "network/PoolAllocator.h"
+#include "network/SocketOps.h"
+#include "network/TcpConnection.h"
+
+using namespace rnet;
+namespace rnet::network {
+
+namespace {
+
+void DestroyConnection(EventLoop* loop, const TcpConnectionPtr& conn) {
+  loop->QueueInLoop([conn] { conn->ConnectDestroyed(); });
+}
+
+void DestroyConnector(const ConnectorPtr&) {
+  // connector 的最后一个引用, 在这里析构
+}
+
+}  // namespace
+
+TcpClient::TcpClient(EventLoop* loop, const InetAddress& serverAddr,
+                     const std::string& nameArg)
+    : TcpClient(loop, std::vector<InetAddress>{serverAddr}, nameArg) {}
+
+TcpClient::TcpClient(EventLoop* loop,
+                     const std::vector<InetAddress>& serverAddrs,
+                     const std::string& nameArg)
+    : TcpClient(loop, std::make_shared<Connector>(loop, serverAddrs),
+                serverAddrs.front().ToIpPort(), nameArg) {}
+
+TcpClient::TcpClient(EventLoop* loop, const UnixAddress& serverAddr,
+                     const std::string& nameArg, int type)
+    : TcpClient(loop, std::make_shared<Connector>(loop, serverAddr, type),
+                serverAddr.ToString(), nameArg) {}
+
+TcpClient::TcpClient(EventLoop* loop, ConnectorPtr connector,
+                     const std::string& target, const std::string& nameArg)
+    : loop_(CHECK_NOTNULL(loop)),
+      connector_(std::move(connector)),
+      name(nameArg),
+      connNamePrefix_(
+          std::make_shared<const std::string>(nameArg + ":" + target + "#")),
+      connectionCallback_(DefaultConnectionCallback),
+      messageCallback_(DefaultMessageCallback),
+      retry_(false),
+      connect_(true),
+      nextConnId_(1) {
+  connector_->SetNewConnectionCallback(
+      [this](int sockfd) { NewConnection(sockfd); });
+  LOG_DEBUG << "TcpClient::TcpClient[" << name << "] - connector "
+            << connector_.get();
+}
+
+// 连接还在时交给连接自己结束: close 回调不再指向本对象
+// 只有本对象和 loop (连接的 self_) 持有连接时, 没有人会再使用它, 直接关闭
+TcpClient::~TcpClient() {
+  LOG_DEBUG << "TcpClient::~TcpClient[" << name << "] - connector "
+            << connector_.get();
+  TcpConnectionPtr conn;
+  bool unique = false;
+  {
+    std::lock_guard lock{mutex_};
+    unique = connection_.use_count() == 2;
+    conn = connection_;
+  }
+  if (conn) {
+    assert(loop_ == conn->GetLoop());
+    // FIXME: not 100% safe, if we are in different thread
+    EventLoop* loop = loop_;
+    loop_->RunInLoop([conn, loop] {
+      conn->SetCloseCallback(
+          [loop](const TcpConnectionPtr& c) { DestroyConnection(loop, c); });
+    });
+    if (unique) {
+      conn->ForceClose();
+    }
+  } else {
+    connector_->Stop();
+    // FIXME: HACK
+    ConnectorPtr connector = connector_;
+    loop_->RunAfter(1, [connector] { DestroyConnector(connector); });
+  }
+}
+
+void TcpClient::SetConnectAttemptDelay(double seconds) {
+  connector_->SetAttemptDelay(seconds);
+}
+
+void TcpClient::SetFastOpen(bool on) { connector_->SetFastOpen(on); }
+
+void TcpClient::Connect() {
+  // FIXME: check state
+  LOG_DEBUG << "TcpClient::Connect[" << name << "] - connecting to "
+            << connector_->ServerAddress().ToIpPort();
+  connect_ = true;
+  connector_->Start();
+}
+
+void TcpClient::Disconnect() {
+  connect_ = false;
+
+  {
+    std::lock_guard lock{mutex_};
+    if (connection_) {
+      connection_->Shutdown();
+    }
+  }
+}
+
+void TcpClient::Stop() {
+  connect_ = false;
+  connector_->Stop();
+}
+
+void TcpClient::NewConnection(int sockfd) {
+  loop_->AssertInLoopThread();
+  InetAddress peerAddr(sockets::GetPeerAddr(sockfd));
+  InetAddress localAddr(sockets::GetLocalAddr(sockfd));
+  // FIXME poll with zero timeout to double confirm the new connection
+  TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(
+      PoolAllocator<TcpConnection>(), loop_, nextConnId_++, connNamePrefix_,
+      sockfd, localAddr, peerAddr);
+
+  conn->SetConnectionCallback(connectionCallback_);
+  conn->SetMessageCallback(messageCallback_);
+  conn->SetWriteCompleteCallback(writeCompleteCallback_);
+  // FIXME: unsafe
+  conn->SetCloseCallback(
+      [this](const TcpConnectionPtr& c) { RemoveConnection(c); });
+  {
+    std::lock_guard lock{mutex_};
+    connection_ = conn;
+  }
+  conn->ConnectEstablished();
+}
+
+void TcpClient::RemoveConnection(const TcpConnectionPtr& conn) {
+  loop_->AssertInLoopThread();
+  assert(loop_ == conn->GetLoop());
+
+  {
+    std::lock_guard lock{mutex_};
+    assert(connection_ == conn);
+    connection_.reset();
+  }
+
+  loop_->QueueInLoop([conn] { conn->ConnectDestroyed(); });
+  if (retry_ && connect_) {
+    LOG_INFO << "TcpClient::connect[" << name << "] - Reconnecting to "
+             << connector_->ServerAddress().ToIpPort();
+    connector_->Restart();
+  }
+}
+
+}  // namespace rnet::network
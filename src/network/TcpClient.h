@@ -0,0 +1,96 @@
+#pragma once
+#include <sys/socket.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/Common.h"
+#include "network/Callback.h"
+#include "network/NetAddress.h"
+namespace rnet::network {
+
+class Connector;
+class EventLoop;
+class UnixAddress;
+using ConnectorPtr = std::shared_ptr<Connector>;
+
+// 主动连接的一端, 同一时刻最多持有一个连接
+// 连接断开后可以按 Connector 的退避策略自动重连
+class TcpClient : Noncopyable {
+ public:
+  TcpClient(EventLoop* loop, const InetAddress& serverAddr,
+            const std::string& nameArg);
+  // 多个候选地址时并行竞速连接, 见 Connector
+  TcpClient(EventLoop* loop, const std::vector<InetAddress>& serverAddrs,
+            const std::string& nameArg);
+  // 连接 unix socket, type 为 SOCK_STREAM 或 SOCK_SEQPACKET
+  TcpClient(EventLoop* loop, const UnixAddress& serverAddr,
+            const std::string& nameArg, int type = SOCK_STREAM);
+  ~TcpClient();  // force out-line dtor, for std::shared_ptr members.
+
+  void Connect();
+  void Disconnect();
+  void Stop();
+
+  TcpConnectionPtr Connection() const {
+    std::lock_guard lock{mutex_};
+    return connection_;
+  }
+
+  EventLoop* GetLoop() const { return loop_; }
+  bool Retry() const { return retry_; }
+  // 连接断开后自动重连
+  void EnableRetry() { retry_ = true; }
+  /// 多个候选地址时, 前一个尝试还没有结果多久后开始下一个
+  /// Not thread safe, set before Connect.
+  void SetConnectAttemptDelay(double seconds);
+  /// 使用 TCP_FASTOPEN_CONNECT. Not thread safe, set before Connect.
+  void SetFastOpen(bool on);
+
+  const std::string& Name() const { return name; }
+
+  /// Set connection callback.
+  /// Not thread safe.
+  void SetConnectionCallback(ConnectionCallback cb) {
+    connectionCallback_ = std::move(cb);
+  }
+
+  /// Set message callback.
+  /// Not thread safe.
+  void SetMessageCallback(MessageCallback cb) {
+    messageCallback_ = std::move(cb);
+  }
+
+  /// Set write complete callback.
+  /// Not thread safe.
+  void SetWriteCompleteCallback(WriteCompleteCallback cb) {
+    writeCompleteCallback_ = std::move(cb);
+  }
+
+ private:
+  TcpClient(EventLoop* loop, ConnectorPtr connector, const std::string& target,
+            const std::string& nameArg);
+  /// Not thread safe, but in loop
+  void NewConnection(int sockfd);
+  /// Not thread safe, but in loop
+  void RemoveConnection(const TcpConnectionPtr& conn);
+
+  EventLoop* loop_;
+  ConnectorPtr connector_;  // avoid revealing Connector
+  const std::string name;
+  // 连接名 "name:ipPort#", 连接名在需要时才拼上 id
+  const std::shared_ptr<const std::string> connNamePrefix_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+  bool retry_;    // atomic
+  bool connect_;  // atomic
+  // always in loop thread
+  uint64_t nextConnId_;
+  mutable std::mutex mutex_;
+  TcpConnectionPtr connection_;  // guarded by mutex_
+};
+
+}  // namespace rnet::network
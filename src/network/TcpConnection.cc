@@ -1,5 +1,10 @@
 #include "network/TcpConnection.h"
 
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#include <cinttypes>
+#include <cstdio>
 #include <string>
 #include <string_view>
 
@@ -13,99 +18,228 @@
 
 using namespace rnet;
 using namespace rnet::Unix;
-using namespace rnet::File;
+using namespace rnet::file;
 
-namespace rnet::Network {
+namespace rnet::network {
 
 // 参数中的loop为io线程中的eventloop ,不一定是main loop(通过round robin
 // 算法确定) .在构造函数中设置事件的回调,在回调过程中tcp
 // connection一直存在只用绑定普通指针即可
 // tcp connection在这些回调里真正调用用户注册的回调
 TcpConnection::TcpConnection(EventLoop* loop, const std::string& nameArg,
-                             int sockfd, const InetAddress& localAddr,
-                             const InetAddress& peerAddr)
+                             int sockfd, const InetAddress& localAddrArg,
+                             const InetAddress& peerAddrArg)
+    : TcpConnection(loop, 0, std::make_shared<const std::string>(nameArg),
+                    sockfd, localAddrArg, peerAddrArg) {}
+
+TcpConnection::TcpConnection(EventLoop* loop, uint64_t idArg,
+                             std::shared_ptr<const std::string> namePrefixArg,
+                             int sockfd, const InetAddress& localAddrArg,
+                             const InetAddress& peerAddrArg)
     : loop_(CHECK_NOTNULL(loop)),
-      name_(nameArg),
+      id(idArg),
+      namePrefix(std::move(namePrefixArg)),
       state_(kConnecting),
       reading_(true),
-      socket_(new Socket(sockfd)),
-      channel_(new Channel(loop, sockfd)),
-      localAddr_(localAddr),
-      peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024) {
-  channel_->setReadCallback(
-      std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
-  channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
-  channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
-  channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
-  LOG_DEBUG << "TcpConnection::ctor[" << name_ << "] at " << this
+      socket_(sockfd),
+      channel_(loop, sockfd),
+      localAddr(localAddrArg),
+      peerAddr(peerAddrArg),
+      highWaterMark_(64 * 1024 * 1024),
+      backlogHighWater_(0),
+      backlogLowWater_(0),
+      maxInputBuffer_(0),
+      throttleSelf_(true),
+      backlogged_(false),
+      throttled_(0),
+      inputFull_(false),
+      deferredFlush_(false),
+      flushScheduled_(false),
+      sendQueue_(nullptr),
+      sendScheduled_(false),
+      fdPassing_(false),
+      loopSlot_(ConnectionSet::kNoSlot) {
+  stats_.creationTime = Unix::Timestamp::Now();
+  // 只捕获 this 的 lambda 能放进 std::function 的内部缓冲, 不再额外分配内存
+  channel_.SetReadCallback(
+      [this](Unix::Timestamp receiveTime) { HandleRead(receiveTime); });
+  channel_.SetWriteCallback([this] { HandleWrite(); });
+  channel_.SetCloseCallback([this] { HandleClose(); });
+  channel_.SetErrorCallback([this] { HandleError(); });
+  LOG_DEBUG << "TcpConnection::ctor[" << Name() << "] at " << this
             << " fd=" << sockfd;
 
   // 可以加一个config 而不是默认开启
   // keep alive 是tcp 发送一个没有数据的包等待对方返回一个ack来查看对端是否活跃
   // 能防止防火墙关闭长时间不活跃的连接
-  socket_->setKeepAlive(true);
+  socket_.SetKeepAlive(true);
+  // 构造时就计入, acceptor 连续分配连接时负载立即可见
+  loop_->AdjustConnections(1);
 }
 
 TcpConnection::~TcpConnection() {
-  LOG_DEBUG << "TcpConnection::dtor[" << name_ << "] at " << this
-            << " fd=" << channel_->Fd() << " state=" << stateToString();
+  LOG_DEBUG << "TcpConnection::dtor[" << Name() << "] at " << this
+            << " fd=" << channel_.Fd() << " state=" << StateToString();
   assert(state_ == kDisconnected);
+  for (SendNode* node = sendQueue_.load(); node != nullptr;) {
+    SendNode* next = node->next;
+    delete node;
+    node = next;
+  }
+  for (int fd : receivedFds_) {
+    sockets::Close(fd);
+  }
   // 确保connection是经过connectionDestroyed函数关闭的,否则会存在错误的智能指针
+  loop_->AdjustConnections(-1);
+}
+
+std::string TcpConnection::Name() const {
+  if (id == 0) {
+    return *namePrefix;
+  }
+  char buf[32];
+  snprintf(buf, sizeof buf, "%" PRIu64, id);
+  return *namePrefix + buf;
 }
 
 bool TcpConnection::GetTcpInfo(struct tcp_info* tcpi) const {
-  return socket_->getTcpInfo(tcpi);
+  return socket_.GetTcpInfo(tcpi);
 }
 
 std::string TcpConnection::GetTcpInfoString() const {
   char buf[1024];
   buf[0] = '\0';
-  socket_->getTcpInfoString(buf, sizeof buf);
+  socket_.GetTcpInfoString(buf, sizeof buf);
   return buf;
 }
 
+void TcpConnection::SampleTcpInfo() {
+  loop_->AssertInLoopThread();
+  struct tcp_info tcpi;
+  if (GetTcpInfo(&tcpi)) {
+    stats_.tcpInfoTime = Unix::Timestamp::Now();
+    stats_.rttUs = tcpi.tcpi_rtt;
+    stats_.rttVarUs = tcpi.tcpi_rttvar;
+    stats_.cwnd = tcpi.tcpi_snd_cwnd;
+    stats_.totalRetrans = tcpi.tcpi_total_retrans;
+  }
+}
+
 //发送数据,数据的生存周期由自己保证.
 //一般是栈数据,但是send时会将数据拷贝到io loop
 void TcpConnection::Send(const void* data, int len) {
-  send(std::string_view(static_cast<const char*>(data), len));
+  Send(std::string_view(static_cast<const char*>(data), len));
 }
 
 void TcpConnection::Send(std::string_view message) {
   if (state_ == kConnected) {
-    if (loop_->isInLoopThread()) {
-      sendInLoop(message);
+    if (loop_->IsInLoopThread()) {
+      SendInLoop(message);
     } else {
-      auto functionPointer = &TcpConnection::sendInLoop;
-      //产生复制
-      loop_->runInLoop(std::bind(functionPointer,
-                                 this,  // FIXME
-                                 std::string{message}));
       // 这里发生了数据复制
-      // std::forward<string>(message)));
+      PushSend(std::string{message});
+    }
+  }
+}
+
+void TcpConnection::Send(std::string&& message) {
+  if (state_ == kConnected) {
+    if (loop_->IsInLoopThread()) {
+      SendInLoop(message);
+    } else {
+      PushSend(std::move(message));
     }
   }
 }
 
-void TcpConnection::Send(Buffer* buf) {
+void TcpConnection::Send(file::Buffer* buf) {
   if (state_ == kConnected) {
-    if (loop_->isInLoopThread()) {
-      doSendInLoop(buf->peek(), buf->readableBytes());
-      buf->retrieveAll();
+    if (loop_->IsInLoopThread()) {
+      DoSendInLoop(buf->Peek(), buf->ReadableBytes());
+      buf->RetrieveAll();
     } else {
-      auto functionPointer = &TcpConnection::sendInLoop;
-      loop_->runInLoop(std::bind(functionPointer,
-                                 this,  // FIXME
-                                 buf->retrieveAllAsString()));
-      // 生成的临时变量经过移动构造成为生成的仿函数的成员变量
       // 底层数据复制一次
-      // std::forward<string>(message)));
+      PushSend(buf->RetrieveAllAsString());
+    }
+  }
+}
+
+// 先入栈再检查标志: DrainSendQueue 先清标志再取栈,
+// 两边交错时要么本次数据被正在进行的 drain 取走, 要么本次重新投递
+void TcpConnection::PushSend(std::string&& message) {
+  auto* node = new SendNode{std::move(message), nullptr};
+  node->next = sendQueue_.load(std::memory_order_relaxed);
+  while (!sendQueue_.compare_exchange_weak(node->next, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+  }
+  if (!sendScheduled_.exchange(true)) {
+    loop_->QueueInLoop([self = shared_from_this()] { self->DrainSendQueue(); });
+  }
+}
+
+// 取走队列中的全部数据, 按发送顺序用 writev 一次写出, 写不完的追加到 outputBuffer
+void TcpConnection::DrainSendQueue() {
+  loop_->AssertInLoopThread();
+  sendScheduled_.store(false);
+  SendNode* node = sendQueue_.exchange(nullptr, std::memory_order_acquire);
+  // 栈是后进先出, 反转成发送顺序
+  SendNode* head = nullptr;
+  while (node != nullptr) {
+    SendNode* next = node->next;
+    node->next = head;
+    head = node;
+    node = next;
+  }
+
+  constexpr int kMaxIov = 64;
+  bool faultError = state_ == kDisconnected;
+  while (head != nullptr) {
+    struct iovec iov[kMaxIov];
+    int count = 0;
+    size_t total = 0;
+    SendNode* rest = head;
+    for (; rest != nullptr && count < kMaxIov; rest = rest->next) {
+      iov[count].iov_base = rest->data.data();
+      iov[count].iov_len = rest->data.size();
+      total += rest->data.size();
+      ++count;
+    }
+    stats_.messagesSent += static_cast<uint64_t>(count);
+
+    size_t written = 0;
+    if (!faultError && !deferredFlush_ && !channel_.IsWriting() &&
+        outputBuffer_.ReadableBytes() == 0) {
+      ssize_t n = sockets::Writev(channel_.Fd(), iov, count);
+      ++stats_.writeCalls;
+      if (n >= 0) {
+        written = static_cast<size_t>(n);
+        stats_.bytesSent += written;
+        if (written == total && rest == nullptr && writeCompleteCallback_) {
+          loop_->QueueInLoop(
+              std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+      } else if (errno != EWOULDBLOCK) {
+        LOG_EVERY_T(syserr, 1) << "TcpConnection::DrainSendQueue";
+        faultError = errno == EPIPE || errno == ECONNRESET;
+      }
+    }
+
+    for (int i = 0; i < count; ++i) {
+      SendNode* next = head->next;
+      size_t len = head->data.size();
+      if (!faultError && written < len) {
+        AppendOutput(head->data.data() + written, len - written);
+      }
+      written = written > len ? written - len : 0;
+      delete head;
+      head = next;
     }
   }
 }
 
 void TcpConnection::SendInLoop(std::string_view message) {
-  doSendInLoop(message.data(), message.size());
+  DoSendInLoop(message.data(), message.size());
 }
 
 // 发送数据的核心逻辑
@@ -120,28 +254,34 @@ void TcpConnection::DoSendInLoop(const void* data, size_t len) {
     LOG_WARN << "disconnected, give up writing";
     return;
   }
+  ++stats_.messagesSent;
   // 普通发送: 直接调用write写入内核缓冲区
   // 超量发送:
   // 一次性将本套接字的内核缓冲区写满并还有剩余数据未发送,此时将数据暂存至output
   // buffer
   // 上次已经超量发送:
   // 上次超量发送,此时直接跳过直接发送将数据存到发送缓冲区,否则数据可能会乱序
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
-    writeBytes = Sockets::write(channel_->Fd(), data, len);
+  // 延迟写模式下只追加, 留到本轮结束时写
+  if (!deferredFlush_ && !channel_.IsWriting() &&
+      outputBuffer_.ReadableBytes() == 0) {
+    writeBytes = sockets::Write(channel_.Fd(), data, len);
+    ++stats_.writeCalls;
     if (writeBytes >= 0) {
-      remaining = len - writeBytes;
+      remaining = len - static_cast<size_t>(writeBytes);
+      stats_.bytesSent += static_cast<uint64_t>(writeBytes);
       //如果发送完了
       if (remaining == 0 && writeCompleteCallback_) {
-        loop_->queueInLoop(
+        loop_->QueueInLoop(
             std::bind(writeCompleteCallback_, shared_from_this()));
       }
-    } else  // write_bytes < 0
+    } else  // writeBytes < 0
     {
       writeBytes = 0;
 
       // 非阻塞套接字写满了返回EWOULDBLOCK,此情况忽略,其余情况为需要log的错误
       if (errno != EWOULDBLOCK) {
-        LOG_SYSERR << "TcpConnection::sendInLoop";
+        // 对端关闭时每次写都会失败,限频避免日志线程被打满
+        LOG_EVERY_T(syserr, 1) << "TcpConnection::sendInLoop";
         if (errno == EPIPE || errno == ECONNRESET)  // FIXME: any others?
         {
           faultError = true;
@@ -153,22 +293,40 @@ void TcpConnection::DoSendInLoop(const void* data, size_t len) {
   // 发生了错误例如对方已经关闭了连接等情况,跳过发送,下一次轮询发生read
   // bytes为0的情况,连接被关闭
   if (!faultError && remaining > 0) {
-    size_t oldLen = outputBuffer_.readableBytes();
+    AppendOutput(static_cast<const char*>(data) + writeBytes, remaining);
+  }
+}
 
-    //发送缓冲区中堆积了太多的数据,调用高水位回调函数
-    if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ &&
-        highWaterMarkCallback_) {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(),
-                                   oldLen + remaining));
+// 写不进内核的数据暂存到 outputBuffer, 处理高水位, 背压, 并安排后续的写
+void TcpConnection::AppendOutput(const char* data, size_t len) {
+  size_t oldLen = outputBuffer_.ReadableBytes();
+
+  //发送缓冲区中堆积了太多的数据,调用高水位回调函数
+  if (oldLen + len >= highWaterMark_ && oldLen < highWaterMark_) {
+    stats_.highWaterSince = Unix::Timestamp::Now();
+    if (highWaterMarkCallback_) {
+      loop_->QueueInLoop(std::bind(highWaterMarkCallback_,
+                                   shared_from_this(), oldLen + len));
     }
-    outputBuffer_.append(static_cast<const char*>(data) + write_bytes,
-                         remaining);
-    // 由于epoll 是水平触发模式,一直关注写事件会busy loop
-    // 因此在发送缓冲区中有数据时才关注写事件,一旦写完立即取消关注
-    // 数据会在下一次的轮询中的handleWrite中发送
-    if (!channel_->isWriting()) {
-      channel_->enableWriting();
+  }
+  outputBuffer_.Append(data, len);
+  // 由于epoll 是水平触发模式,一直关注写事件会busy loop
+  // 因此在发送缓冲区中有数据时才关注写事件,一旦写完立即取消关注
+  // 数据会在下一次的轮询中的handleWrite中发送
+  if (deferredFlush_) {
+    if (!flushScheduled_ && !channel_.IsWriting()) {
+      flushScheduled_ = true;
+      loop_->RunAtIterationEnd(
+          [self = shared_from_this()] { self->FlushDeferred(); });
     }
+  } else if (!channel_.IsWriting()) {
+    ++stats_.writeStalls;
+    channel_.EnableWriting();
+  }
+  if (backlogHighWater_ > 0 && !backlogged_ &&
+      outputBuffer_.ReadableBytes() >= backlogHighWater_) {
+    backlogged_ = true;
+    ThrottleSource(1);
   }
 }
 
@@ -176,26 +334,27 @@ void TcpConnection::DoSendInLoop(const void* data, size_t len) {
 void TcpConnection::Shutdown() {
   // FIXME: use compare and swap
   if (state_ == kConnected) {
-    setState(kDisconnecting);
+    SetState(kDisconnecting);
     // FIXME: shared_from_this()?
-    loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
+    loop_->RunInLoop(std::bind(&TcpConnection::ShutdownInLoop, this));
   }
 }
 
 void TcpConnection::ShutdownInLoop() {
   loop_->AssertInLoopThread();
-  if (!channel_->isWriting()) {
+  // 还有延迟写的数据时由 FlushDeferred 补上 shutdown
+  if (!channel_.IsWriting() && !flushScheduled_) {
     // we are not writing
-    socket_->shutdownWrite();
+    socket_.ShutdownWrite();
   }
 }
 
 void TcpConnection::ForceClose() {
   // FIXME: use compare and swap
   if (state_ == kConnected || state_ == kDisconnecting) {
-    setState(kDisconnecting);
-    loop_->queueInLoop(
-        std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    SetState(kDisconnecting);
+    loop_->QueueInLoop(
+        std::bind(&TcpConnection::ForceCloseInLoop, shared_from_this()));
   }
 }
 
@@ -203,13 +362,13 @@ void TcpConnection::ForceCloseInLoop() {
   loop_->AssertInLoopThread();
   if (state_ == kConnected || state_ == kDisconnecting) {
     // as if we received 0 byte in handleRead();
-    handleClose();
+    HandleClose();
   }
 }
 
 // void TcpConnection::forceCloseWithDelay(double seconds) {
 //   if (state_ == kConnected || state_ == kDisconnecting) {
-//     setState(kDisconnecting);
+//     SetState(kDisconnecting);
 //     loop_->runAfter(
 //         seconds, makeWeakCallback(
 //                      shared_from_this(),
@@ -235,97 +394,256 @@ const char* TcpConnection::StateToString() const {
 }
 
 // 关闭tcp delay算法,指将几个小包合成一个大包发送.但是会增加延迟
-void TcpConnection::SetTcpNoDelay(bool on) { socket_->setTcpNoDelay(on); }
+void TcpConnection::SetTcpNoDelay(bool on) { socket_.SetTcpNoDelay(on); }
+
+void TcpConnection::SetBusyPoll(int usec) { socket_.SetBusyPoll(usec); }
 
 //关注read事件,下一次轮询即可读到数据
 void TcpConnection::StartRead() {
-  loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
+  loop_->RunInLoop(std::bind(&TcpConnection::StartReadInLoop, this));
 }
 
 void TcpConnection::StartReadInLoop() {
   loop_->AssertInLoopThread();
-  if (!reading_ || !channel_->isReading()) {
-    channel_->enableReading();
-    reading_ = true;
-  }
+  reading_ = true;
+  UpdateReading();
 }
 
 void TcpConnection::StopRead() {
-  loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, this));
+  loop_->RunInLoop(std::bind(&TcpConnection::StopReadInLoop, this));
 }
 
 void TcpConnection::StopReadInLoop() {
   loop_->AssertInLoopThread();
-  if (reading_ || channel_->isReading()) {
-    channel_->disableReading();
-    reading_ = false;
+  reading_ = false;
+  UpdateReading();
+}
+
+// 连接关闭后 channel 已经不再关注任何事件, 不能重新打开
+void TcpConnection::UpdateReading() {
+  if (state_ != kConnected && state_ != kDisconnecting) {
+    return;
+  }
+  bool wantRead = reading_ && !ReadPaused();
+  if (wantRead && !channel_.IsReading()) {
+    channel_.EnableReading();
+  } else if (!wantRead && channel_.IsReading()) {
+    channel_.DisableReading();
+  }
+}
+
+void TcpConnection::SetBackpressure(size_t highWater, size_t lowWater) {
+  assert(lowWater <= highWater);
+  backlogHighWater_ = highWater;
+  backlogLowWater_ = lowWater;
+}
+
+void TcpConnection::SetBackpressureSource(const TcpConnectionPtr& source) {
+  backpressureSource_ = source;
+  throttleSelf_ = false;
+}
+
+void TcpConnection::InputConsumed() {
+  loop_->AssertInLoopThread();
+  if (inputFull_ && inputBuffer_.ReadableBytes() < maxInputBuffer_) {
+    inputFull_ = false;
+    UpdateReading();
+  }
+}
+
+void TcpConnection::Throttle(int delta) {
+  loop_->AssertInLoopThread();
+  if (delta > 0 && throttled_ == 0) {
+    ++stats_.readPauses;
+  }
+  throttled_ += delta;
+  assert(throttled_ >= 0);
+  UpdateReading();
+}
+
+// 上游在别的 loop 时投递过去, 同一个 loop 时 RunInLoop 直接执行
+void TcpConnection::ThrottleSource(int delta) {
+  if (throttleSelf_) {
+    Throttle(delta);
+    return;
+  }
+  TcpConnectionPtr source = backpressureSource_.lock();
+  if (source) {
+    source->loop_->RunInLoop([source, delta] { source->Throttle(delta); });
+  }
+}
+
+void TcpConnection::ReleaseBacklog() {
+  if (backlogged_) {
+    backlogged_ = false;
+    ThrottleSource(-1);
   }
 }
 
-// 在连接建立的回调中调用,绑定智能指针用于保活,更新状态机状态
+// 在连接建立的回调中调用,持有自己用于保活,更新状态机状态
+// self_ 是所属 loop 持有的引用, 保证连接在 channel 注册期间一直存活, channel 不再需要 tie,
+// 每次事件分发省去 weak_ptr::lock 和 shared_from_this 的原子操作
 void TcpConnection::ConnectEstablished() {
   loop_->AssertInLoopThread();
   assert(state_ == kConnecting);
-  setState(kConnected);
-  channel_->tie(shared_from_this());
-  channel_->enableReading();
+  SetState(kConnected);
+  self_ = shared_from_this();
+  loop_->Connections()->Add(this, &loopSlot_);
+  UpdateReading();
 
-  connectionCallback_(shared_from_this());
+  connectionCallback_(self_);
 }
 
 //连接关闭的最后一步,此时只有最后一个智能指针隐式绑定在函数对象内,
 //本函数执行完堆内存析构,套接字关闭,文件描述符释放
 void TcpConnection::ConnectDestroyed() {
   loop_->AssertInLoopThread();
+  // 放到局部变量里最后释放, 调用方没有持有引用时也不会在函数中途析构
+  TcpConnectionPtr self = std::move(self_);
   if (state_ == kConnected) {
-    setState(kDisconnected);
+    SetState(kDisconnected);
     //告诉内核不再关注此描述符事件
-    channel_->disableAll();
+    channel_.DisableAll();
+    ReleaseBacklog();
 
     connectionCallback_(shared_from_this());
   }
 
   // epoll 里保存了已经注册的channel,因此此时需要删除不用的channel
-  channel_->remove();
+  channel_.Remove();
+  if (loopSlot_ != ConnectionSet::kNoSlot) {
+    loop_->Connections()->Remove(&loopSlot_);
+  }
+}
+
+// loop 退出时销毁任务还在队列里, 连接没有走到 ConnectDestroyed.
+// 这时不再调用用户回调 (它们引用的对象可能已经析构), 只注销 channel 并放手
+void TcpConnection::ReleaseByLoop() {
+  loop_->AssertInLoopThread();
+  TcpConnectionPtr self = std::move(self_);
+  SetState(kDisconnected);
+  channel_.DisableAll();
+  channel_.Remove();
+  loop_->Connections()->Remove(&loopSlot_);
 }
 
 void TcpConnection::HandleRead(Timestamp receiveTime) {
   loop_->AssertInLoopThread();
   int savedErrno = 0;
   // 读数据会尽量读取数据,最多可读到65536+buffer.size()长度数据
-  ssize_t n = inputBuffer_.readFd(channel_->Fd(), &savedErrno);
+  ssize_t n = fdPassing_ ? ReadWithFds(&savedErrno)
+                         : inputBuffer_.ReadFd(channel_.Fd(), &savedErrno);
+  ++stats_.readCalls;
   if (n > 0) {
-    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    stats_.bytesReceived += static_cast<uint64_t>(n);
+    ++stats_.messagesReceived;
+    stats_.lastReceiveTime = receiveTime;
+    messageCallback_(self_, &inputBuffer_, receiveTime);
+    // 回调没有取走的数据积压太多时暂停读, 由 InputConsumed 恢复
+    if (maxInputBuffer_ > 0 && !inputFull_ &&
+        inputBuffer_.ReadableBytes() >= maxInputBuffer_) {
+      inputFull_ = true;
+      ++stats_.readPauses;
+      UpdateReading();
+    }
     // 当对方请求关闭连接时,epoll返回epollin | EPOLLRDHUP
     // 此时服务端直接关闭连接即可
   } else if (n == 0) {
-    handleClose();
+    HandleClose();
   } else {
     errno = savedErrno;
     LOG_SYSERR << "TcpConnection::handleRead";
-    handleError();
+    HandleError();
   }
 }
 
+// 和 Buffer::ReadFd 一样先读进可写空间, 不够时再用栈上的缓冲
+ssize_t TcpConnection::ReadWithFds(int* savedErrno) {
+  char extrabuf[65536];
+  struct iovec vec[2];
+  const size_t writable = inputBuffer_.WritableBytes();
+  vec[0].iov_base = inputBuffer_.BeginWrite();
+  vec[0].iov_len = writable;
+  vec[1].iov_base = extrabuf;
+  vec[1].iov_len = sizeof extrabuf;
+  const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+  ssize_t n = sockets::RecvWithFds(channel_.Fd(), vec, iovcnt, &receivedFds_);
+  if (n < 0) {
+    *savedErrno = errno;
+  } else if (static_cast<size_t>(n) <= writable) {
+    inputBuffer_.HasWritten(static_cast<size_t>(n));
+  } else {
+    inputBuffer_.HasWritten(writable);
+    inputBuffer_.Append(extrabuf, static_cast<size_t>(n) - writable);
+  }
+  return n;
+}
+
+bool TcpConnection::SendWithFds(std::string_view data, const int* fds,
+                                size_t count) {
+  loop_->AssertInLoopThread();
+  assert(!data.empty());
+  if (state_ != kConnected || channel_.IsWriting() ||
+      outputBuffer_.ReadableBytes() > 0) {
+    return false;
+  }
+  ssize_t n =
+      sockets::SendWithFds(channel_.Fd(), data.data(), data.size(), fds, count);
+  ++stats_.writeCalls;
+  if (n < 0) {
+    if (errno != EWOULDBLOCK) {
+      LOG_SYSERR << "TcpConnection::SendWithFds";
+    }
+    return false;
+  }
+  ++stats_.messagesSent;
+  stats_.bytesSent += static_cast<uint64_t>(n);
+  auto written = static_cast<size_t>(n);
+  if (written < data.size()) {
+    AppendOutput(data.data() + written, data.size() - written);
+  } else if (writeCompleteCallback_) {
+    loop_->QueueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+  }
+  return true;
+}
+
+// 复制出来的 fd 让 socket 在 ConnectDestroyed 关闭原 fd 之后仍然打开,
+// 不会发出 FIN, 内核缓冲区里还没有读的数据也跟着交出去
+int TcpConnection::ReleaseIfIdle() {
+  loop_->AssertInLoopThread();
+  if (state_ != kConnected || inputBuffer_.ReadableBytes() > 0 ||
+      outputBuffer_.ReadableBytes() > 0 || sendQueue_.load() != nullptr) {
+    return -1;
+  }
+  int fd = ::fcntl(socket_.Fd(), F_DUPFD_CLOEXEC, 0);
+  if (fd < 0) {
+    LOG_SYSERR << "TcpConnection::ReleaseIfIdle";
+    return -1;
+  }
+  ForceCloseInLoop();
+  return fd;
+}
+
 void TcpConnection::HandleWrite() {
   loop_->AssertInLoopThread();
-  if (channel_->isWriting()) {
-    ssize_t n = Sockets::write(channel_->Fd(), outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
+  if (channel_.IsWriting()) {
+    ssize_t n = sockets::Write(channel_.Fd(), outputBuffer_.Peek(),
+                               outputBuffer_.ReadableBytes());
+    ++stats_.writeCalls;
     if (n > 0) {
-      outputBuffer_.retrieve(n);
+      RetrieveOutput(static_cast<size_t>(n));
       //如果发送缓存已经为空,停止关注读事件,否则会busy loop
-      if (outputBuffer_.readableBytes() == 0) {
-        channel_->disableWriting();
+      if (outputBuffer_.ReadableBytes() == 0) {
+        channel_.DisableWriting();
         // 直接将回调入栈,而不是直接调用
         if (writeCompleteCallback_) {
-          loop_->queueInLoop(
+          loop_->QueueInLoop(
               std::bind(writeCompleteCallback_, shared_from_this()));
         }
         // 在关注写事件时shutdown会被忽略,因此此时要检测是否已经调用过shutdown了,
         // 将没有成功调用的shutdown补回来
         if (state_ == kDisconnecting) {
-          shutdownInLoop();
+          ShutdownInLoop();
         }
       }
     } else {
@@ -336,18 +654,66 @@ void TcpConnection::HandleWrite() {
       // }
     }
   } else {
-    LOG_TRACE << "Connection fd = " << channel_->Fd()
+    LOG_TRACE << "Connection fd = " << channel_.Fd()
               << " is down, no more writing";
   }
 }
 
+// outputBuffer 中的数据写出了 n 字节, 更新高水位统计和背压状态
+void TcpConnection::RetrieveOutput(size_t n) {
+  outputBuffer_.Retrieve(n);
+  stats_.bytesSent += n;
+  if (stats_.highWaterSince.Valid() &&
+      outputBuffer_.ReadableBytes() < highWaterMark_) {
+    stats_.highWaterMarkUs = stats_.HighWaterMarkUs(Unix::Timestamp::Now());
+    stats_.highWaterSince = Unix::Timestamp::Invalid();
+  }
+  if (backlogged_ && outputBuffer_.ReadableBytes() <= backlogLowWater_) {
+    backlogged_ = false;
+    ThrottleSource(-1);
+  }
+}
+
+// 本轮追加的数据只写一次, 写不完的部分和普通发送一样交给 HandleWrite
+void TcpConnection::FlushDeferred() {
+  flushScheduled_ = false;
+  if (state_ == kDisconnected || channel_.IsWriting() ||
+      outputBuffer_.ReadableBytes() == 0) {
+    return;
+  }
+  ssize_t n = sockets::Write(channel_.Fd(), outputBuffer_.Peek(),
+                             outputBuffer_.ReadableBytes());
+  ++stats_.writeCalls;
+  if (n > 0) {
+    RetrieveOutput(static_cast<size_t>(n));
+  } else if (errno != EWOULDBLOCK) {
+    LOG_EVERY_T(syserr, 1) << "TcpConnection::FlushDeferred";
+    if (errno == EPIPE || errno == ECONNRESET) {
+      return;
+    }
+  }
+
+  if (outputBuffer_.ReadableBytes() > 0) {
+    ++stats_.writeStalls;
+    channel_.EnableWriting();
+    return;
+  }
+  if (writeCompleteCallback_) {
+    loop_->QueueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+  }
+  if (state_ == kDisconnecting) {
+    ShutdownInLoop();
+  }
+}
+
 void TcpConnection::HandleClose() {
   loop_->AssertInLoopThread();
-  LOG_TRACE << "fd = " << channel_->Fd() << " state = " << stateToString();
+  LOG_TRACE << "fd = " << channel_.Fd() << " state = " << StateToString();
   assert(state_ == kConnected || state_ == kDisconnecting);
   // we don't close fd, leave it to dtor, so we can find leaks easily.
-  setState(kDisconnected);
-  channel_->disableAll();
+  SetState(kDisconnected);
+  channel_.DisableAll();
+  ReleaseBacklog();
 
   TcpConnectionPtr guardThis(shared_from_this());
   connectionCallback_(guardThis);
@@ -357,24 +723,24 @@ void TcpConnection::HandleClose() {
 }
 
 void TcpConnection::HandleError() {
-  int err = Sockets::getSocketError(channel_->Fd());
-  LOG_ERROR << "TcpConnection::handleError [" << name_
-            << "] - SO_ERROR = " << err << " " << Thread::getErrnoMessage(err);
+  int err = sockets::GetSocketError(channel_.Fd());
+  LOG_ERROR << "TcpConnection::handleError [" << Name()
+            << "] - SO_ERROR = " << err << " " << thread::GetErrnoMessage(err);
 }
 
-}  // namespace rnet::Network
+}  // namespace rnet::network
 
-using namespace rnet::Network;
+using namespace rnet::network;
 
-void rnet::Network::DefaultConnectionCallback(const TcpConnectionPtr& conn) {
-  LOG_TRACE << conn->localAddress().ToIpPort() << " -> "
-            << conn->peerAddress().ToIpPort() << " is "
-            << (conn->connected() ? "UP" : "DOWN");
+void rnet::network::DefaultConnectionCallback(const TcpConnectionPtr& conn) {
+  LOG_TRACE << conn->LocalAddress().ToIpPort() << " -> "
+            << conn->PeerAddress().ToIpPort() << " is "
+            << (conn->Connected() ? "UP" : "DOWN");
   // do not call conn->forceClose(), because some users want to register message
   // callback only.
 }
 
-void rnet::Network::DefaultMessageCallback(const TcpConnectionPtr&,
-                                           File::Buffer* buf, Unix::Timestamp) {
-  buf->retrieveAll();
+void rnet::network::DefaultMessageCallback(const TcpConnectionPtr&,
+                                           file::Buffer* buf, Unix::Timestamp) {
+  buf->RetrieveAll();
 }
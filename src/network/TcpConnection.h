@@ -1,37 +1,51 @@
 #pragma once
 #include <any>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <netinet/tcp.h>
 
 #include "base/Common.h"
 #include "file/ConnBuffer.h"
 #include "network/Callback.h"
+#include "network/Channel.h"
+#include "network/ConnectionStats.h"
 #include "network/NetAddress.h"
+#include "network/Socket.h"
 namespace rnet::network {
 
-class Channel;
 class EventLoop;
-class Socket;
 
 // TcpConnection
 // 是一个tcp链接的封装,由智能指针管理.类的生命周期与tcp链接的生命周期相同.
 // TcpConnection
 // 拥有输入输出缓冲区,socket,channel的值语义.在链接析构时指针指针会调用
 // socket的析构函数释放文件描述符.只要在链接的生命周期类对buffer进行的读写都是有效的.
-class TcpConnection : Noncopyable,
-                      public std::enable_shared_from_this<TcpConnection> {
+// socket 和 channel 直接内嵌在连接对象里, 整个对象按缓存行对齐,
+// 和控制块共用一块内存, TcpServer 在 io loop 中用 PoolAllocator 从该线程的缓存中分配
+class alignas(kCacheLineSize) TcpConnection
+    : Noncopyable,
+      public std::enable_shared_from_this<TcpConnection> {
  public:
   // (从服务端来看)构造函数在acceptor调用callback后在tcp server 的new
   // connection函数中调用,并
   //在tcp server 中存储tcp connection的智能指针
   TcpConnection(EventLoop* loop, const std::string& name, int sockfd,
                 const InetAddress& localAddr, const InetAddress& peerAddr);
+  // 服务端使用: 名字由共享的前缀和 id 组成, 只在调用 Name() 时才格式化,
+  // 建立连接不再为名字分配字符串
+  TcpConnection(EventLoop* loop, uint64_t id,
+                std::shared_ptr<const std::string> namePrefix, int sockfd,
+                const InetAddress& localAddr, const InetAddress& peerAddr);
   ~TcpConnection();
 
   EventLoop* GetLoop() const { return loop_; }
-  const std::string& Name() const { return name; }
+  // 连接在所属 TcpServer 内唯一的 id, 不是由 TcpServer 创建的连接为 0
+  uint64_t Id() const { return id; }
+  std::string Name() const;
   const InetAddress& LocalAddress() const { return localAddr; }
   const InetAddress& PeerAddress() const { return peerAddr; }
   // 获取状态机状态
@@ -40,10 +54,17 @@ class TcpConnection : Noncopyable,
   // return true if success.
   bool GetTcpInfo(struct tcp_info*) const;
   std::string GetTcpInfoString() const;
+  // 流量和系统调用计数, 只能在 loop 线程读
+  const ConnectionStats& Stats() const { return stats_; }
+  // 把当前的 rtt, cwnd, 重传次数记到 Stats() 里, 在 loop 线程调用
+  void SampleTcpInfo();
 
   // void send(string&& message); // C++11
   void Send(const void* message, int len);
   void Send(std::string_view message);
+  void Send(const char* message) { Send(std::string_view(message)); }
+  // 其他线程调用时直接移动进发送队列, 不复制
+  void Send(std::string&& message);
   // void send(Buffer&& message); // C++11
   void Send(file::Buffer* message);  // this one will swap data
   void Shutdown();                   // NOT thread safe, no simultaneous calling
@@ -52,6 +73,11 @@ class TcpConnection : Noncopyable,
   void ForceClose();
   void ForceCloseWithDelay(double seconds);
   void SetTcpNoDelay(bool on);
+  // 延迟写: Send 只追加到 outputBuffer, 在本轮 loop 的最后统一写一次,
+  // 一条消息分多次 Send 时只产生一次系统调用和更少的小包. loop 线程或建立连接前调用
+  void SetDeferredFlush(bool on) { deferredFlush_ = on; }
+  // SO_BUSY_POLL, 配合 EventLoop::SetBusyPoll 使用
+  void SetBusyPoll(int usec);
   // reading or not
   void StartRead();
   void StopRead();
@@ -59,6 +85,33 @@ class TcpConnection : Noncopyable,
     return reading_;
   };  // NOT thread safe, may race with start/stopReadInLoop
 
+  // 背压: outputBuffer 超过 highWater 时暂停读取数据来源, 降到 lowWater 以下时恢复.
+  // 数据来源默认是自己, 代理转发时用 SetBackpressureSource 指定上游连接.
+  // highWater 为 0 表示关闭(默认). 在 ConnectEstablished 之前或 loop 线程中调用
+  void SetBackpressure(size_t highWater, size_t lowWater);
+  // 只保存 weak_ptr, 上游连接可以属于另一个 loop
+  void SetBackpressureSource(const TcpConnectionPtr& source);
+  // inputBuffer 积压到 maxBytes 时暂停读, 0 表示不限制(默认)
+  void SetMaxInputBuffer(size_t maxBytes) { maxInputBuffer_ = maxBytes; }
+  // 在 MessageCallback 之外取走 InputBuffer 的数据后调用, 积压解除时恢复读. loop 线程
+  void InputConsumed();
+  // 是否因为背压暂停了读, 和 StopRead 相互独立. loop 线程
+  bool ReadPaused() const { return throttled_ > 0 || inputFull_; }
+
+  // unix socket 上传递文件描述符 (SCM_RIGHTS). 开启后改用 recvmsg 读取,
+  // 随数据到达的 fd 在 MessageCallback 中用 TakeReceivedFds 取走,
+  // 没有取走的在连接析构时关闭. 在 ConnectEstablished 之前或 loop 线程中调用
+  void SetFdPassing(bool on) { fdPassing_ = on; }
+  std::vector<int> TakeReceivedFds() { return std::move(receivedFds_); }
+  // 把 fds 随 data 的第一个字节发出, 内核为对端复制一份, fds 仍归调用者所有.
+  // 只能在 loop 线程调用, data 不能为空. 输出缓冲区中还有数据或者
+  // 内核缓冲区已满时什么也不发送, 返回 false; data 没写完的部分进入输出缓冲区
+  bool SendWithFds(std::string_view data, const int* fds, size_t count);
+  // 连接空闲 (收发缓冲区和跨线程发送队列都为空) 时复制一份 fd 返回,
+  // 并在本进程关闭连接, 对端感觉不到; 否则返回 -1. 热重启时把连接交给新进程,
+  // 连接上的应用状态 (context) 不会跟着走. 只能在 loop 线程调用
+  int ReleaseIfIdle();
+
   // 出现了复制构造,考虑移动语义?
   void SetContext(const std::any& context) { context_ = context; }
 
@@ -94,6 +147,8 @@ class TcpConnection : Noncopyable,
   void ConnectEstablished();  // should be called only once
   // called when TcpServer has removed me from its map
   void ConnectDestroyed();  // should be called only once
+  // 所属 loop 析构时对还在 ConnectionSet 中的连接调用, 不触发回调
+  void ReleaseByLoop();
 
  private:
   // 内部状态机:
@@ -108,27 +163,45 @@ class TcpConnection : Noncopyable,
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
 
   void HandleRead(Unix::Timestamp receiveTime);
+  ssize_t ReadWithFds(int* savedErrno);
   void HandleWrite();
   void HandleClose();
   void HandleError();
   // void sendInLoop(string&& message);
   void SendInLoop(std::string_view message);
+  // 其他线程的发送: 压入无锁队列, 一批发送只投递一次任务
+  void PushSend(std::string&& message);
+  void DrainSendQueue();
+  void AppendOutput(const char* data, size_t len);
   void DoSendInLoop(const void* message, size_t len);
   void ShutdownInLoop();
+  void FlushDeferred();
+  void RetrieveOutput(size_t n);
   // void shutdownAndForceCloseInLoop(double seconds);
   void ForceCloseInLoop();
   void SetState(StateE s) { state_ = s; }
   const char* StateToString() const;
   void StartReadInLoop();
   void StopReadInLoop();
+  // 按 reading_ 和背压状态开关 channel 的读事件
+  void UpdateReading();
+  // 被下游连接暂停(+1)或恢复(-1)
+  void Throttle(int delta);
+  void ThrottleSource(int delta);
+  // 连接关闭时放开被自己暂停的上游
+  void ReleaseBacklog();
 
   EventLoop* loop_;
-  const std::string name;
+  const uint64_t id;
+  const std::shared_ptr<const std::string> namePrefix;
   StateE state_;  // FIXME: use atomic variable
   bool reading_;
-  // we don't expose those classes to client.
-  std::unique_ptr<Socket> socket_;
-  std::unique_ptr<Channel> channel_;
+  // channel 在 socket 之前析构, socket 析构时关闭文件描述符
+  Socket socket_;
+  Channel channel_;
+  // 所属 loop 持有的引用, 从 ConnectEstablished 到 ConnectDestroyed
+  // (或者 loop 析构) 之间有效. 回调都借用它, 分发事件时不再有引用计数的原子操作
+  TcpConnectionPtr self_;
   const InetAddress localAddr;
   const InetAddress peerAddr;
   ConnectionCallback connectionCallback_;
@@ -140,10 +213,35 @@ class TcpConnection : Noncopyable,
   file::Buffer inputBuffer_;
   file::Buffer outputBuffer_;  // FIXME: use list<Buffer> as output buffer.
   std::any context_;
-  // FIXME: creationTime_, lastReceiveTime_
-  //        bytesReceived_, bytesSent_
+  // 背压
+  size_t backlogHighWater_;
+  size_t backlogLowWater_;
+  size_t maxInputBuffer_;
+  std::weak_ptr<TcpConnection> backpressureSource_;
+  bool throttleSelf_;
+  // outputBuffer 处于 highWater 之上, 上游已被暂停
+  bool backlogged_;
+  // 正在暂停本连接的下游个数
+  int throttled_;
+  bool inputFull_;
+  bool deferredFlush_;
+  // 已经登记了本轮结束时的 FlushDeferred
+  bool flushScheduled_;
+  // 其他线程 Send 的数据, 多生产者单消费者的无锁栈, loop 线程一次取走全部
+  struct SendNode {
+    std::string data;
+    SendNode* next;
+  };
+  std::atomic<SendNode*> sendQueue_;
+  // 已经投递了 DrainSendQueue, 期间的 Send 不再唤醒 loop
+  std::atomic<bool> sendScheduled_;
+  ConnectionStats stats_;
+  bool fdPassing_;
+  std::vector<int> receivedFds_;
+  // 在所属 loop 的 ConnectionSet 中的位置
+  size_t loopSlot_;
 };
 
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
 
-}  // namespace rnet::Network
+}  // namespace rnet::network
@@ -1,12 +1,18 @@
 #include "network/TcpServer.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <mutex>
 
 #include "log/Logger.h"
 #include "network/Acceptor.h"
 #include "network/EventLoop.h"
 #include "network/LoopThreadPool.h"
+#include "network/PoolAllocator.h"
+#include "network/SocketOps.h"
 #include "network/TcpConnection.h"
+#include "network/UnixAddress.h"
+#include "unix/Thread.h"
 
 using namespace rnet;
 namespace rnet::network {
@@ -16,80 +22,342 @@ namespace rnet::network {
 // acceptor
 // 在获得channel的读事件时,尝试系统调用accept获取文件描述符并调用callback
 // 在callback 里完成连接对象的创建和初始化
+// kReusePortPerLoop 模式下 acceptor 在 start 时为每个 io loop 各建一个
 TcpServer::TcpServer( EventLoop* loop, const InetAddress& listenAddr, const std::string& nameArg, Option option )
-  : loop_( CHECK_NOTNULL( loop ) ), ipPort_( listenAddr.ToIpPort() ), name_( nameArg ), acceptor_( new Acceptor( loop, listenAddr, option == kReusePort ) ),
-    threadPool_( new EventLoopThreadPool( loop, name_ ) ), connectionCallback_( defaultConnectionCallback ), messageCallback_( defaultMessageCallback ), nextConnId_( 1 ) {
-  acceptor_->setNewConnectionCallback( std::bind( &TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2 ) );
+  : TcpServer( loop, listenAddr, listenAddr.ToIpPort(), nameArg, option, option == kReusePortPerLoop ? nullptr : new Acceptor( CHECK_NOTNULL( loop ), listenAddr, option == kReusePort ) ) {}
+
+// unix socket 不支持 SO_REUSEPORT, 只有一个 acceptor; 连接地址的地址族为 AF_UNIX
+TcpServer::TcpServer( EventLoop* loop, const UnixAddress& listenAddr, const std::string& nameArg, int type )
+  : TcpServer( loop, UnixAddress::AsInetAddress(), listenAddr.ToString(), nameArg, kNoReusePort, new Acceptor( CHECK_NOTNULL( loop ), listenAddr, type ) ) {}
+
+TcpServer::TcpServer( EventLoop* loop, int listenFd, const std::string& nameArg )
+  : TcpServer( loop, InetAddress( sockets::GetLocalAddr( listenFd ) ), InetAddress( sockets::GetLocalAddr( listenFd ) ).ToIpPort(), nameArg, kNoReusePort, new Acceptor( CHECK_NOTNULL( loop ), listenFd ) ) {}
+
+TcpServer::TcpServer( EventLoop* loop, const InetAddress& listenAddr, const std::string& ipPortArg, const std::string& nameArg, Option option, Acceptor* acceptor )
+  : loop_( CHECK_NOTNULL( loop ) ), ipPort( ipPortArg ), name( nameArg ), listenAddr_( listenAddr ), option_( option ), cpuSteering_( false ), acceptBatch_( Acceptor::kDefaultAcceptBatch ), socketBusyPollUs_( 0 ), tcpInfoInterval_( 0 ), backlogHighWater_( 0 ), backlogLowWater_( 0 ), maxInputBuffer_( 0 ), deferredFlush_( false ),
+    acceptor_( acceptor ), threadPool_( new EventLoopThreadPool( loop, name ) ),
+    connectionCallback_( DefaultConnectionCallback ), messageCallback_( DefaultMessageCallback ), connNamePrefix_( std::make_shared< const std::string >( name + "-" + ipPort + "#" ) ), nextConnId_( 1 ) {
+  if ( acceptor_ ) {
+    acceptor_->SetNewConnectionsCallback( std::bind( &TcpServer::NewConnections, this, std::placeholders::_1 ) );
+  }
 }
 
 // server 关闭时关闭所有存在的连接.
 TcpServer::~TcpServer() {
   loop_->AssertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name << "] destructing";
+  for ( const auto& [ ioLoop, timerId ] : tcpInfoTimers_ ) {
+    ioLoop->Cancel( timerId );
+  }
+  loop_->Cancel( drainTimer_ );
 
-  for ( auto& item : connections_ ) {
-    TcpConnectionPtr conn( item.second );
+  connections_.ForEach( []( uint64_t, TcpConnectionPtr& item ) {
+    TcpConnectionPtr conn( item );
     // 直接释放智能指针,而不用移动语义然后在容器中擦除,效率更高
     // 此时全局只有一个智能指针隐式绑定在bind生成的对象内,一旦仿函数执行完毕,对象销毁,智能指针计数变为0,tcp
     // connection销毁
-    item.second.reset();
-    conn->getLoop()->runInLoop( std::bind( &TcpConnection::connectDestroyed, conn ) );
+    item.reset();
+    conn->GetLoop()->RunInLoop( std::bind( &TcpConnection::ConnectDestroyed, conn ) );
+  } );
+
+  // 每个 loop 的 acceptor 和连接只能在自己的线程里销毁, 等它们完成
+  for ( auto& slot : loopAcceptors_ ) {
+    thread::CountDownLatch latch( 1 );
+    slot->loop->RunInLoop( [ &slot, &latch ] {
+      slot->acceptor.reset();
+      slot->connections.ForEach( []( uint64_t, TcpConnectionPtr& conn ) { conn->ConnectDestroyed(); } );
+      slot->connections.Clear();
+      latch.CountDown();
+    } );
+    latch.Wait();
   }
 }
+
 void TcpServer::SetThreadNum( int numThreads ) {
   assert( 0 <= numThreads );
-  threadPool_->setThreadNum( numThreads );
+  threadPool_->SetThreadNum( numThreads );
 }
 
 void TcpServer::Start() {
   int32_t dummy = 0;
   if ( started_.compare_exchange_strong( dummy, 1 ) ) {
-    threadPool_->start( threadInitCallback_ );
+    threadPool_->Start( threadInitCallback_ );
+
+    if ( option_ == kReusePortPerLoop ) {
+      StartLoopAcceptors();
+    }
+    else {
+      assert( !acceptor_->Listening() );
+      acceptor_->SetAcceptBatch( acceptBatch_ );
+      loop_->RunInLoop( std::bind( &Acceptor::Listen, acceptor_.get() ) );
+    }
 
-    assert( !acceptor_->listening() );
-    loop_->runInLoop( std::bind( &Acceptor::listen, acceptor_.get() ) );
+    if ( tcpInfoInterval_ > 0 ) {
+      for ( EventLoop* ioLoop : threadPool_->GetAllLoops() ) {
+        TimerId timerId = ioLoop->RunEvery( tcpInfoInterval_, [ ioLoop ] { ioLoop->Connections()->SampleTcpInfo(); } );
+        tcpInfoTimers_.emplace_back( ioLoop, timerId );
+      }
+    }
   }
 }
 
+int TcpServer::ListenFd() const {
+  loop_->AssertInLoopThread();
+  return acceptor_ ? acceptor_->Fd() : -1;
+}
+
+// 推迟到事件处理之后销毁, 调用者可能正处在 acceptor 的回调里
+void TcpServer::StopAccepting() {
+  loop_->QueueInLoop( [ this ] {
+    if ( acceptor_ ) {
+      acceptor_.reset();
+      LOG_INFO << "TcpServer [" << name << "] stopped accepting on " << ipPort;
+    }
+    for ( auto& slot : loopAcceptors_ ) {
+      LoopAcceptor* s = slot.get();
+      s->loop->QueueInLoop( [ s ] { s->acceptor.reset(); } );
+    }
+  } );
+}
+
+void TcpServer::Drain( double timeout, std::function< void() > drained ) {
+  StopAccepting();
+  loop_->RunInLoop( [ this, timeout, drained = std::move( drained ) ]() mutable {
+    drainedCallback_ = std::move( drained );
+    draining_        = true;
+    drainTimer_      = loop_->RunAfter( timeout, [ this ] { ForceCloseAll(); } );
+    CheckDrained();
+  } );
+}
+
+void TcpServer::CheckDrained() {
+  loop_->AssertInLoopThread();
+  if ( draining_ && numConnections_ == 0 ) {
+    draining_ = false;
+    loop_->Cancel( drainTimer_ );
+    LOG_INFO << "TcpServer [" << name << "] drained";
+    if ( drainedCallback_ ) {
+      drainedCallback_();
+    }
+  }
+}
+
+void TcpServer::ForceCloseAll() {
+  loop_->AssertInLoopThread();
+  LOG_WARN << "TcpServer [" << name << "] drain timeout, force closing " << numConnections_ << " connections";
+  connections_.ForEach( []( uint64_t, TcpConnectionPtr& conn ) { conn->ForceClose(); } );
+  for ( auto& slot : loopAcceptors_ ) {
+    LoopAcceptor* s = slot.get();
+    s->loop->RunInLoop( [ s ] { s->connections.ForEach( []( uint64_t, TcpConnectionPtr& conn ) { conn->ForceClose(); } ); } );
+  }
+}
+
+// 和 accept 到的连接走同样的流程
+void TcpServer::AdoptConnection( int sockfd ) {
+  loop_->AssertInLoopThread();
+  InetAddress peerAddr( sockets::GetPeerAddr( sockfd ) );
+  if ( option_ == kReusePortPerLoop ) {
+    assert( !loopAcceptors_.empty() );
+    LoopAcceptor* slot = loopAcceptors_[ nextConnId_.load( std::memory_order_relaxed ) % loopAcceptors_.size() ].get();
+    slot->loop->RunInLoop( [ this, slot, sockfd, peerAddr ] { NewConnectionInLoop( slot, sockfd, peerAddr ); } );
+    return;
+  }
+  std::vector< AcceptedConnection > accepted{ { sockfd, peerAddr } };
+  NewConnections( &accepted );
+}
+
+// 先把连接取出来再分发: 交出的连接关闭时会从连接表中删除自己
+void TcpServer::ReleaseIdleConnections( std::function< void( std::vector< int > ) > done ) {
+  loop_->AssertInLoopThread();
+  struct Release {
+    std::mutex                                  mutex;
+    std::vector< int >                          fds;
+    size_t                                      pending;
+    std::function< void( std::vector< int > ) > done;
+    EventLoop*                                  loop;
+  };
+  auto release  = std::make_shared< Release >();
+  release->done = std::move( done );
+  release->loop = loop_;
+  auto finish   = [ release ]( const std::vector< int >& fds ) {
+    std::lock_guard lock{ release->mutex };
+    release->fds.insert( release->fds.end(), fds.begin(), fds.end() );
+    if ( --release->pending == 0 ) {
+      release->loop->QueueInLoop( [ release ] { release->done( std::move( release->fds ) ); } );
+    }
+  };
+
+  std::vector< TcpConnectionPtr > conns;
+  connections_.ForEach( [ &conns ]( uint64_t, TcpConnectionPtr& conn ) { conns.push_back( conn ); } );
+  release->pending = conns.size() + loopAcceptors_.size() + 1;
+  for ( const auto& conn : conns ) {
+    conn->GetLoop()->RunInLoop( [ conn, finish ] {
+      int fd = conn->ReleaseIfIdle();
+      finish( fd >= 0 ? std::vector< int >{ fd } : std::vector< int >() );
+    } );
+  }
+  for ( auto& slot : loopAcceptors_ ) {
+    LoopAcceptor* s = slot.get();
+    s->loop->RunInLoop( [ s, finish ] {
+      std::vector< TcpConnectionPtr > loopConns;
+      s->connections.ForEach( [ &loopConns ]( uint64_t, TcpConnectionPtr& conn ) { loopConns.push_back( conn ); } );
+      std::vector< int > fds;
+      for ( const auto& conn : loopConns ) {
+        int fd = conn->ReleaseIfIdle();
+        if ( fd >= 0 ) {
+          fds.push_back( fd );
+        }
+      }
+      finish( fds );
+    } );
+  }
+  // 没有任何连接时也保证 done 被调用
+  finish( std::vector< int >() );
+}
+
+// 依次在各自的 loop 中 listen, 并等待完成
+// 内核按 listen 的顺序给 reuseport 组内的 socket 编号, cbpf 程序返回的就是这个编号
+void TcpServer::StartLoopAcceptors() {
+  std::vector< EventLoop* > loops = threadPool_->GetAllLoops();
+  for ( size_t i = 0; i < loops.size(); ++i ) {
+    auto slot        = std::make_unique< LoopAcceptor >();
+    slot->index      = i;
+    slot->loop       = loops[ i ];
+    slot->acceptor   = std::make_unique< Acceptor >( loops[ i ], listenAddr_, true );
+    slot->acceptor->SetAcceptBatch( acceptBatch_ );
+    slot->acceptor->SetNewConnectionCallback( std::bind( &TcpServer::NewConnectionInLoop, this, slot.get(), std::placeholders::_1, std::placeholders::_2 ) );
+
+    thread::CountDownLatch latch( 1 );
+    Acceptor*              acceptor = slot->acceptor.get();
+    loops[ i ]->RunInLoop( [ acceptor, &latch ] {
+      acceptor->Listen();
+      latch.CountDown();
+    } );
+    latch.Wait();
+    loopAcceptors_.push_back( std::move( slot ) );
+  }
+
+  if ( cpuSteering_ && !loopAcceptors_.empty() ) {
+    loopAcceptors_.front()->acceptor->AttachReusePortCpuFilter( static_cast< uint32_t >( loopAcceptors_.size() ) );
+  }
+  LOG_INFO << "TcpServer [" << name << "] listening on " << ipPort << " with " << loopAcceptors_.size() << " SO_REUSEPORT acceptors" << ( cpuSteering_ ? ", steered by cpu" : "" );
+}
+
 // 新连接创建核心方法
 // 首先挑选一个io loop
-// 构建连接,并在io loop中完成最终初始化(注册epoll事件等)
-void TcpServer::NewConnection( int sockfd, const InetAddress& peerAddr ) {
+// 在io loop中构建连接并完成最终初始化(注册epoll事件等)
+// acceptor 一次交来一批连接, 按 io loop 分组, 每个 loop 只投递一次任务, 只唤醒一次
+void TcpServer::NewConnections( std::vector< AcceptedConnection >* accepted ) {
   loop_->AssertInLoopThread();
-  EventLoop* ioLoop = threadPool_->getNextLoop();
-  char       buf[ 64 ];
-  snprintf( buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_ );
-  ++nextConnId_;
-  std::string connName = name_ + buf;
-
-  LOG_INFO << "TcpServer::newConnection [" << name_ << "] - new connection [" << connName << "] from " << peerAddr.ToIpPort();
-  InetAddress LocalAddr( Sockets::getLocalAddr( sockfd ) );
+  std::vector< std::pair< EventLoop*, std::vector< AcceptedConnection > > > batches;
+  for ( const auto& item : *accepted ) {
+    EventLoop* ioLoop = threadPool_->GetNextLoop();
+    // 连接在 io loop 中才构造, 先占上名额, 同一批里后面的连接按负载选 loop 时能看到
+    ioLoop->AdjustConnections( 1 );
+    numConnections_.fetch_add( 1, std::memory_order_relaxed );
+
+    auto it = std::find_if( batches.begin(), batches.end(), [ ioLoop ]( const auto& batch ) { return batch.first == ioLoop; } );
+    if ( it == batches.end() ) {
+      batches.emplace_back( ioLoop, std::vector< AcceptedConnection >() );
+      it = batches.end() - 1;
+    }
+    it->second.push_back( item );
+  }
+
+  for ( auto& batch : batches ) {
+    EventLoop* ioLoop = batch.first;
+    ioLoop->RunInLoop( [ this, ioLoop, items = std::move( batch.second ) ] { EstablishConnections( ioLoop, items ); } );
+  }
+}
+
+// 连接在它的 io loop 中分配, 通常也在这里释放, PoolAllocator 缓存的内存块能被复用.
+// 连接表只在 base loop 访问, 建好后投递回去登记. 连接关闭时的 RemoveConnection
+// 也是从这个 loop 投递到 base loop, 排在登记之后
+void TcpServer::EstablishConnections( EventLoop* ioLoop, const std::vector< AcceptedConnection >& items ) {
+  ioLoop->AssertInLoopThread();
+  std::vector< TcpConnectionPtr > conns;
+  conns.reserve( items.size() );
+  for ( const auto& item : items ) {
+    TcpConnectionPtr conn = CreateConnection( ioLoop, item.sockfd, item.peerAddr );
+    conn->SetCloseCallback( [ this ]( const TcpConnectionPtr& c ) { RemoveConnection( c ); } );  // FIXME: unsafe
+    conns.push_back( std::move( conn ) );
+  }
+  // 构造函数已经计入, 换掉 NewConnections 占的名额
+  ioLoop->AdjustConnections( -static_cast< int >( items.size() ) );
+
+  for ( const auto& conn : conns ) {
+    conn->ConnectEstablished();
+  }
+  // ConnectEstablished 不会同步关闭连接, 之后再登记也在 RemoveConnection 之前
+  loop_->RunInLoop( [ this, conns = std::move( conns ) ]() mutable {
+    for ( const auto& conn : conns ) {
+      connections_.Insert( conn->Id(), conn );
+    }
+    // 不留到任务对象析构, 连接关闭时最后一个引用才会在 io loop 中释放
+    conns.clear();
+  } );
+}
+
+// 连接就在 accept 它的 loop 上, 不需要再跨线程
+void TcpServer::NewConnectionInLoop( LoopAcceptor* slot, int sockfd, const InetAddress& peerAddr ) {
+  slot->loop->AssertInLoopThread();
+  numConnections_.fetch_add( 1, std::memory_order_relaxed );
+  TcpConnectionPtr conn = CreateConnection( slot->loop, sockfd, peerAddr );
+  slot->connections.Insert( conn->Id(), conn );
+  conn->SetCloseCallback( [ this, slot ]( const TcpConnectionPtr& c ) { RemoveLoopConnection( slot, c ); } );
+  conn->ConnectEstablished();
+}
+
+// 每个连接的日志放在 debug 级别, 高频建连时默认不格式化连接名和地址
+TcpConnectionPtr TcpServer::CreateConnection( EventLoop* ioLoop, int sockfd, const InetAddress& peerAddr ) {
+  uint64_t    connId = nextConnId_.fetch_add( 1, std::memory_order_relaxed );
+  InetAddress localAddr( sockets::GetLocalAddr( sockfd ) );
   // FIXME poll with zero timeout to double confirm the new connection
-  // FIXME use make_shared if necessary
-  TcpConnectionPtr conn( new TcpConnection( ioLoop, connName, sockfd, localAddr, peerAddr ) );
-  connections_[ connName ] = conn;
-  conn->setConnectionCallback( connectionCallback_ );
-  conn->setMessageCallback( messageCallback_ );
-  conn->setWriteCompleteCallback( writeCompleteCallback_ );
-  conn->setCloseCallback( std::bind( &TcpServer::removeConnection, this,
-                                     std::placeholders::_1 ) );  // FIXME: unsafe
-  ioLoop->runInLoop( std::bind( &TcpConnection::connectEstablished, conn ) );
+  // 连接对象和控制块一次分配, 优先复用 io loop 线程缓存的内存块
+  ioLoop->AssertInLoopThread();
+  TcpConnectionPtr conn = std::allocate_shared< TcpConnection >( PoolAllocator< TcpConnection >(), ioLoop, connId, connNamePrefix_, sockfd, localAddr, peerAddr );
+  LOG_DEBUG << "TcpServer::NewConnection [" << name << "] - new connection [" << conn->Name() << "] from " << peerAddr.ToIpPort();
+  conn->SetConnectionCallback( connectionCallback_ );
+  conn->SetMessageCallback( messageCallback_ );
+  conn->SetWriteCompleteCallback( writeCompleteCallback_ );
+  if ( socketBusyPollUs_ > 0 ) {
+    conn->SetBusyPoll( socketBusyPollUs_ );
+  }
+  conn->SetBackpressure( backlogHighWater_, backlogLowWater_ );
+  conn->SetMaxInputBuffer( maxInputBuffer_ );
+  conn->SetDeferredFlush( deferredFlush_ );
+  return conn;
 }
 
 // 这是tcp connection调用的函数,用于主动tcp connection的主动关闭连接
 void TcpServer::RemoveConnection( const TcpConnectionPtr& conn ) {
   // FIXME: unsafe
-  loop_->runInLoop( std::bind( &TcpServer::removeConnectionInLoop, this, conn ) );
+  loop_->RunInLoop( [ this, c = conn ]() mutable { RemoveConnectionInLoop( std::move( c ) ); } );
 }
 
 // 在io线程调用connectDestroyed,完成析构最后一步
-void TcpServer::RemoveConnectionInLoop( const TcpConnectionPtr& conn ) {
+// 引用一路移动过去, 连接在 io 线程释放, 内存块回到该线程的 PoolAllocator 缓存
+void TcpServer::RemoveConnectionInLoop( TcpConnectionPtr conn ) {
   loop_->AssertInLoopThread();
-  LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_ << "] - connection " << conn->name();
-  size_t n = connections_.erase( conn->name() );
+  LOG_DEBUG << "TcpServer::RemoveConnectionInLoop [" << name << "] - connection " << conn->Name();
+  size_t n = connections_.Erase( conn->Id() );
   assert( n == 1 );
-  EventLoop* ioLoop = conn->getLoop();
-  ioLoop->queueInLoop( std::bind( &TcpConnection::connectDestroyed, conn ) );
+  EventLoop* ioLoop = conn->GetLoop();
+  ioLoop->QueueInLoop( [ conn = std::move( conn ) ] { conn->ConnectDestroyed(); } );
+  --numConnections_;
+  CheckDrained();
+}
+
+// close 回调本来就在连接所在的 loop 中执行
+void TcpServer::RemoveLoopConnection( LoopAcceptor* slot, const TcpConnectionPtr& conn ) {
+  slot->loop->AssertInLoopThread();
+  LOG_DEBUG << "TcpServer::RemoveLoopConnection [" << name << "] - connection " << conn->Name();
+  size_t n = slot->connections.Erase( conn->Id() );
+  assert( n == 1 );
+  slot->loop->QueueInLoop( [ conn ] { conn->ConnectDestroyed(); } );
+  if ( --numConnections_ == 0 && draining_ ) {
+    loop_->RunInLoop( [ this ] { CheckDrained(); } );
+  }
 }
 
-}  // namespace rnet::network
\ No newline at end of file
+}  // namespace rnet::network
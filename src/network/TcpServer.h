@@ -1,16 +1,24 @@
 #pragma once
+#include <sys/socket.h>
+
 #include <atomic>
+#include <cstdint>
 #include <functional>
-#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "base/Common.h"
 #include "network/Callback.h"
+#include "network/IdTable.h"
 #include "network/NetAddress.h"
+#include "network/TimerId.h"
 namespace rnet::network {
 class Acceptor;
 class EventLoop;
+struct AcceptedConnection;
 class EventLoopThreadPool;
+class UnixAddress;
 
 class TcpServer : Noncopyable {
  public:
@@ -18,11 +26,21 @@ class TcpServer : Noncopyable {
   enum Option {
     kNoReusePort,
     kReusePort,
+    // 每个 io loop 持有自己的 SO_REUSEPORT 监听 socket, 在本线程 accept
+    // 并直接在本线程建立连接, 新连接不再经过 base loop
+    kReusePortPerLoop,
   };
 
   // TcpServer(EventLoop* loop, const InetAddress& listenAddr);
   TcpServer(EventLoop* loop, const InetAddress& listenAddr,
             const std::string& nameArg, Option option = kNoReusePort);
+  /// 监听 unix socket, type 为 SOCK_STREAM 或 SOCK_SEQPACKET.
+  /// seqpacket 的消息边界不会保留到 InputBuffer 里, 协议仍需自己分帧
+  TcpServer(EventLoop* loop, const UnixAddress& listenAddr,
+            const std::string& nameArg, int type = SOCK_STREAM);
+  /// 接管一个已经在监听的 socket (inet 或 unix), 例如热重启时从旧进程继承的,
+  /// 见 HotRestartClient. 只有一个 acceptor, 在 loop 中 accept
+  TcpServer(EventLoop* loop, int listenFd, const std::string& nameArg);
   ~TcpServer();  // force out-line dtor, for std::unique_ptr members.
 
   const std::string& IpPort() const { return ipPort; }
@@ -43,6 +61,28 @@ class TcpServer : Noncopyable {
   void SetThreadInitCallback(const ThreadInitCallback& cb) {
     threadInitCallback_ = cb;
   }
+  /// kReusePortPerLoop only. Must be called before @c start
+  /// 用 cbpf 程序按处理 SYN 的 cpu 选择监听 socket: 第 cpu % N 个 loop
+  /// 配合 ThreadPool()->SetCpuAffinity 让第 i 个 loop 运行在 cpu i 上,
+  /// 连接就在收到它的 cpu 上被 accept 和处理
+  void SetReusePortCpuSteering(bool on) { cpuSteering_ = on; }
+  /// 每次可读事件最多 accept 的连接数, 小于 1 时按 1 处理.
+  /// Must be called before @c start
+  void SetAcceptBatch(int batch) { acceptBatch_ = batch; }
+  /// 新连接设置 SO_BUSY_POLL, 0 表示不设置.
+  /// io loop 的忙轮询用 ThreadPool()->SetBusyPoll 开启
+  void SetSocketBusyPoll(int usec) { socketBusyPollUs_ = usec; }
+  /// 每隔 seconds 秒在各 io loop 中对其上所有连接采样 TCP_INFO, 0 表示不采样.
+  /// Must be called before @c start
+  void SetTcpInfoSampleInterval(double seconds) { tcpInfoInterval_ = seconds; }
+  /// 新连接的背压设置, 见 TcpConnection::SetBackpressure 和 SetMaxInputBuffer
+  void SetBackpressure(size_t highWater, size_t lowWater) {
+    backlogHighWater_ = highWater;
+    backlogLowWater_ = lowWater;
+  }
+  void SetMaxInputBuffer(size_t maxBytes) { maxInputBuffer_ = maxBytes; }
+  /// 新连接使用延迟写, 见 TcpConnection::SetDeferredFlush
+  void SetDeferredFlush(bool on) { deferredFlush_ = on; }
   /// valid after calling start()
   std::shared_ptr<EventLoopThreadPool> ThreadPool() { return threadPool_; }
 
@@ -52,6 +92,24 @@ class TcpServer : Noncopyable {
   /// Thread safe.
   void Start();
 
+  /// 单个 acceptor 的监听 fd, kReusePortPerLoop 或者已经停止 accept 时返回 -1.
+  /// 在 loop 线程调用
+  int ListenFd() const;
+  /// 关闭本进程的监听 socket, 不再接受新连接, 已有的连接不受影响.
+  /// 监听 socket 已经交给新进程时, accept 队列由那边继续处理. Thread safe.
+  void StopAccepting();
+  /// 停止 accept, 等待已有的连接自己关闭, timeout 秒后强制关闭剩下的,
+  /// 所有连接都关闭后在 loop 中调用 drained. Thread safe.
+  void Drain(double timeout, std::function<void()> drained);
+  /// Thread safe.
+  size_t NumConnections() const { return numConnections_.load(); }
+  /// 把一个已经建立的连接 (例如从旧进程交过来的) 当作新 accept 的连接加入.
+  /// 在 loop 线程调用, 必须已经 Start
+  void AdoptConnection(int sockfd);
+  /// 在各自的 io loop 中对每个连接调用 TcpConnection::ReleaseIfIdle,
+  /// 全部完成后在 loop 中以交出的 fd 调用 done. 在 loop 线程调用
+  void ReleaseIdleConnections(std::function<void(std::vector<int>)> done);
+
   /// Set connection callback.
   /// Not thread safe.
   //
@@ -70,18 +128,58 @@ class TcpServer : Noncopyable {
   }
 
  private:
+  TcpServer(EventLoop* loop, const InetAddress& listenAddr,
+            const std::string& ipPortArg, const std::string& nameArg,
+            Option option, Acceptor* acceptor);
   /// Not thread safe, but in loop
-  void NewConnection(int sockfd, const InetAddress& peerAddr);
+  void NewConnections(std::vector<AcceptedConnection>* accepted);
+  /// in ioLoop
+  void EstablishConnections(EventLoop* ioLoop,
+                            const std::vector<AcceptedConnection>& items);
   /// Thread safe.
   void RemoveConnection(const TcpConnectionPtr& conn);
   /// Not thread safe, but in loop
-  void RemoveConnectionInLoop(const TcpConnectionPtr& conn);
+  void RemoveConnectionInLoop(TcpConnectionPtr conn);
+  /// in ioLoop
+  TcpConnectionPtr CreateConnection(EventLoop* ioLoop, int sockfd,
+                                    const InetAddress& peerAddr);
+
+  // 以连接 id 为键, accept 和 close 时不分配也不比较字符串
+  using ConnectionMap = IdTable<TcpConnectionPtr>;
+
+  // kReusePortPerLoop 下每个 io loop 的监听 socket 和它接受的连接
+  // 除构造外只在 loop 所在线程访问
+  struct LoopAcceptor {
+    size_t index;
+    EventLoop* loop;
+    std::unique_ptr<Acceptor> acceptor;
+    ConnectionMap connections;
+  };
 
-  using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
+  void StartLoopAcceptors();
+  /// in slot->loop
+  void NewConnectionInLoop(LoopAcceptor* slot, int sockfd,
+                           const InetAddress& peerAddr);
+  /// in slot->loop
+  void RemoveLoopConnection(LoopAcceptor* slot, const TcpConnectionPtr& conn);
+  /// in loop
+  void CheckDrained();
+  void ForceCloseAll();
 
   EventLoop* loop_;  // the acceptor loop
   const std::string ipPort;
   const std::string name;
+  const InetAddress listenAddr_;
+  const Option option_;
+  bool cpuSteering_;
+  int acceptBatch_;
+  int socketBusyPollUs_;
+  double tcpInfoInterval_;
+  size_t backlogHighWater_;
+  size_t backlogLowWater_;
+  size_t maxInputBuffer_;
+  bool deferredFlush_;
+  std::vector<std::pair<EventLoop*, TimerId>> tcpInfoTimers_;
   std::unique_ptr<Acceptor> acceptor_;  // avoid revealing Acceptor
   std::shared_ptr<EventLoopThreadPool> threadPool_;
   // 连接发生变化时回调函数
@@ -93,8 +191,17 @@ class TcpServer : Noncopyable {
   // io线程初始化完成后的回调
   ThreadInitCallback threadInitCallback_;
   std::atomic_int32_t started_{0};
+  // 所有连接共享的名字前缀 "name-ipPort#", 连接名在需要时才拼上 id
+  const std::shared_ptr<const std::string> connNamePrefix_;
+  // kReusePortPerLoop 下由各 io loop 并发分配
+  std::atomic<uint64_t> nextConnId_;
   // always in loop thread
-  int nextConnId_;
   ConnectionMap connections_;
+  std::vector<std::unique_ptr<LoopAcceptor>> loopAcceptors_;
+  std::atomic<size_t> numConnections_{0};
+  // Drain 期间, 连接数降到 0 时回调 drainedCallback_
+  std::atomic<bool> draining_{false};
+  TimerId drainTimer_;
+  std::function<void()> drainedCallback_;
 };
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
@@ -9,11 +9,11 @@ namespace rnet::network {
 // using namespace rnet;
 class Timer : rnet::Noncopyable {
  public:
-  Timer(network::TimerCallback cb, Unix::Timestamp when, double interval)
+  Timer(network::TimerCallback cb, Unix::Timestamp when, double intervalArg)
       : callback(std::move(cb)),
         expiration_(when),
-        interval(interval),
-        repeat(interval > 0.0),
+        interval(intervalArg),
+        repeat(intervalArg > 0.0),
         sequence(sNumCreated.fetch_add(1)) {}
 
   void Run() const { callback(); }
@@ -36,4 +36,4 @@ class Timer : rnet::Noncopyable {
   static std::atomic_int64_t sNumCreated;
 };
 
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
@@ -19,4 +19,4 @@ class TimerId {
   Timer* timer_;
   int64_t sequence_;
 };
-}  // namespace rnet::Network
\ No newline at end of file
+}  // namespace rnet::network
\ No newline at end of file
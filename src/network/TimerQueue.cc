@@ -101,7 +101,7 @@ void TimerQueue::AddTimerInLoop(Timer* timer) {
 void TimerQueue::CancelInLoop(TimerId timerId) {
   loop_->AssertInLoopThread();
   assert(timers_.size() == activeTimers_.size());
-  ActiveTimer timer(timerId.timer_, timerId.Sequence_);
+  ActiveTimer timer(timerId.timer_, timerId.sequence_);
   auto itr = activeTimers_.find(timer);
   if (itr != activeTimers_.end()) {
     size_t n = timers_.erase(Entry(itr->first->Expiration(), itr->first));
@@ -124,8 +124,12 @@ void TimerQueue::HandleRead() {
   callingExpiredTimers_ = true;
   cancelingTimers_.clear();
   // safe to callback outside critical section
-  for (const Entry& it : expired) {
-    it.second->Run();
+  for (size_t i = 0; i < expired.size(); ++i) {
+    // 前面的回调会推迟后面的定时器, 每个定时器执行前重新取时间
+    Unix::Timestamp start = i == 0 ? now : Unix::Timestamp::Now();
+    loop_->RecordTimerLateness(start.MicroSecondsSinceEpoch() -
+                               expired[i].first.MicroSecondsSinceEpoch());
+    expired[i].second->Run();
   }
   callingExpiredTimers_ = false;
 
@@ -0,0 +1,76 @@
+#include "network/UdpServer.h"
+
+#include <cassert>
+
+#include "log/Logger.h"
+#include "network/EventLoop.h"
+#include "network/LoopThreadPool.h"
+#include "unix/Thread.h"
+
+using namespace rnet;
+namespace rnet::network {
+
+UdpServer::UdpServer(EventLoop* loop, const InetAddress& listenAddr,
+                     const std::string& nameArg)
+    : loop_(CHECK_NOTNULL(loop)),
+      name(nameArg),
+      listenAddr_(listenAddr),
+      threadPool_(new EventLoopThreadPool(loop, name)),
+      batch_(UdpSocket::kDefaultBatch),
+      maxDatagramSize_(UdpSocket::kDefaultMaxDatagramSize),
+      gro_(false),
+      receiveBuffer_(0),
+      started_(false) {}
+
+// socket 只能在自己的 loop 中销毁, 等它们完成
+UdpServer::~UdpServer() {
+  loop_->AssertInLoopThread();
+  for (auto& socket : sockets_) {
+    thread::CountDownLatch latch(1);
+    socket->GetLoop()->RunInLoop([&socket, &latch] {
+      socket.reset();
+      latch.CountDown();
+    });
+    latch.Wait();
+  }
+}
+
+void UdpServer::SetThreadNum(int numThreads) {
+  assert(0 <= numThreads);
+  threadPool_->SetThreadNum(numThreads);
+}
+
+// 依次在各自的 loop 中创建并绑定; 端口为 0 时后面的 socket 绑定第一个分到的端口
+void UdpServer::Start() {
+  loop_->AssertInLoopThread();
+  if (started_.exchange(true)) {
+    return;
+  }
+  threadPool_->Start(threadInitCallback_);
+  for (EventLoop* ioLoop : threadPool_->GetAllLoops()) {
+    thread::CountDownLatch latch(1);
+    std::unique_ptr<UdpSocket> socket;
+    ioLoop->RunInLoop([this, ioLoop, &socket, &latch] {
+      socket = std::make_unique<UdpSocket>(ioLoop, listenAddr_, true);
+      socket->SetBatch(batch_);
+      socket->SetMaxDatagramSize(maxDatagramSize_);
+      if (gro_) {
+        socket->EnableGro();
+      }
+      if (receiveBuffer_ > 0) {
+        socket->SetReceiveBuffer(receiveBuffer_);
+      }
+      socket->SetDatagramsCallback(datagramsCallback_);
+      socket->Start();
+      latch.CountDown();
+    });
+    latch.Wait();
+    listenAddr_ = socket->LocalAddress();
+    sockets_.push_back(std::move(socket));
+  }
+  LOG_INFO << "UdpServer [" << name << "] listening on "
+           << listenAddr_.ToIpPort() << " with " << sockets_.size()
+           << " SO_REUSEPORT sockets";
+}
+
+}  // namespace rnet::network
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/Common.h"
+#include "network/NetAddress.h"
+#include "network/UdpSocket.h"
+namespace rnet::network {
+
+class EventLoop;
+class EventLoopThreadPool;
+
+// 每个 io loop 持有一个绑定同一地址的 SO_REUSEPORT UdpSocket,
+// 内核按四元组哈希把数据报分给各个 loop, 收发都在本线程完成
+class UdpServer : Noncopyable {
+ public:
+  using ThreadInitCallback = std::function<void(EventLoop*)>;
+
+  UdpServer(EventLoop* loop, const InetAddress& listenAddr,
+            const std::string& nameArg);
+  ~UdpServer();
+
+  const std::string& Name() const { return name; }
+  EventLoop* GetLoop() const { return loop_; }
+  /// 实际监听的地址, listenAddr 端口为 0 时在 Start 之后可用
+  const InetAddress& ListenAddress() const { return listenAddr_; }
+
+  /// 0 表示在 base loop 中收发. Must be called before @c start
+  void SetThreadNum(int numThreads);
+  void SetThreadInitCallback(const ThreadInitCallback& cb) {
+    threadInitCallback_ = cb;
+  }
+  /// 在各自的 io loop 中回调. Must be called before @c start
+  void SetDatagramsCallback(const DatagramsCallback& cb) {
+    datagramsCallback_ = cb;
+  }
+  /// 见 UdpSocket. Must be called before @c start
+  void SetBatch(int batch) { batch_ = batch; }
+  void SetMaxDatagramSize(size_t size) { maxDatagramSize_ = size; }
+  void SetGro(bool on) { gro_ = on; }
+  void SetReceiveBuffer(int bytes) { receiveBuffer_ = bytes; }
+
+  /// valid after calling start()
+  std::shared_ptr<EventLoopThreadPool> ThreadPool() { return threadPool_; }
+
+  /// 在 base loop 线程调用, 等所有 io loop 的 socket 绑定完成后返回
+  void Start();
+
+ private:
+  EventLoop* loop_;
+  const std::string name;
+  InetAddress listenAddr_;
+  std::shared_ptr<EventLoopThreadPool> threadPool_;
+  ThreadInitCallback threadInitCallback_;
+  DatagramsCallback datagramsCallback_;
+  int batch_;
+  size_t maxDatagramSize_;
+  bool gro_;
+  int receiveBuffer_;
+  std::atomic<bool> started_;
+  // 下标与 threadPool_->GetAllLoops() 一致, 只能在各自的 loop 中使用和销毁
+  std::vector<std::unique_ptr<UdpSocket>> sockets_;
+};
+
+}  // namespace rnet::network
@@ -0,0 +1,293 @@
+#include "network/UdpSocket.h"
+
+#include <netinet/udp.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "log/Logger.h"
+#include "network/EventLoop.h"
+#include "network/SocketOps.h"
+
+namespace rnet::network {
+const size_t UdpSocket::kGroBufferSize;
+
+namespace {
+
+// 一次可读事件最多调用 recvmmsg 的次数, 每次都收满时继续, 避免饿死其他 channel
+const int kMaxRoundsPerEvent = 4;
+const size_t kControlSize = CMSG_SPACE(sizeof(int));
+// 内核一次 GSO 发送最多的分段数(UDP_MAX_SEGMENTS)和总长度
+const size_t kMaxGsoSegments = 64;
+const size_t kMaxGsoBytes = 65000;
+
+socklen_t AddressLength(const InetAddress& addr) {
+  return static_cast<socklen_t>(addr.Family() == AF_INET
+                                    ? sizeof(struct sockaddr_in)
+                                    : sizeof(struct sockaddr_in6));
+}
+
+bool WouldBlock(int err) {
+  return err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS;
+}
+
+}  // namespace
+
+UdpSocket::UdpSocket(EventLoop* loop, const InetAddress& bindAddr,
+                     bool reuseport)
+    : loop_(loop),
+      socket_(sockets::CreateUdpNonblockingOrDie(bindAddr.Family())),
+      channel_(loop, socket_.Fd()),
+      batch_(kDefaultBatch),
+      maxDatagramSize_(kDefaultMaxDatagramSize),
+      gro_(false),
+      gso_(true),
+      started_(false) {
+  socket_.SetReusePort(reuseport);
+  socket_.BindAddress(bindAddr);
+  localAddr_ = InetAddress(sockets::GetLocalAddr(socket_.Fd()));
+  channel_.SetReadCallback(
+      [this](Unix::Timestamp receiveTime) { HandleRead(receiveTime); });
+}
+
+UdpSocket::~UdpSocket() { Stop(); }
+
+bool UdpSocket::EnableGro() {
+#ifdef UDP_GRO
+  int on = 1;
+  if (::setsockopt(socket_.Fd(), SOL_UDP, UDP_GRO, &on,
+                   static_cast<socklen_t>(sizeof on)) < 0) {
+    LOG_SYSERR << "UDP_GRO failed.";
+    return false;
+  }
+  gro_ = true;
+  return true;
+#else
+  LOG_ERROR << "UDP_GRO is not supported.";
+  return false;
+#endif
+}
+
+bool UdpSocket::SetReceiveBuffer(int bytes) {
+  if (::setsockopt(socket_.Fd(), SOL_SOCKET, SO_RCVBUF, &bytes,
+                   static_cast<socklen_t>(sizeof bytes)) < 0) {
+    LOG_SYSERR << "SO_RCVBUF failed.";
+    return false;
+  }
+  return true;
+}
+
+void UdpSocket::Start() {
+  loop_->AssertInLoopThread();
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  AllocateBuffers();
+  channel_.EnableReading();
+}
+
+void UdpSocket::Stop() {
+  loop_->AssertInLoopThread();
+  if (!started_) {
+    return;
+  }
+  started_ = false;
+  channel_.DisableAll();
+  channel_.Remove();
+}
+
+void UdpSocket::AllocateBuffers() {
+  assert(batch_ > 0);
+  auto batch = static_cast<size_t>(batch_);
+  size_t slot = gro_ ? std::max(maxDatagramSize_, kGroBufferSize)
+                     : maxDatagramSize_;
+  buffer_.assign(batch * slot, 0);
+  control_.assign(batch * kControlSize, 0);
+  msgs_.assign(batch, mmsghdr());
+  iovecs_.resize(batch);
+  peers_.resize(batch);
+  datagrams_.reserve(batch);
+  for (size_t i = 0; i < batch; ++i) {
+    iovecs_[i].iov_base = buffer_.data() + i * slot;
+    iovecs_[i].iov_len = slot;
+  }
+}
+
+void UdpSocket::HandleRead(Unix::Timestamp receiveTime) {
+  loop_->AssertInLoopThread();
+  for (int round = 0; round < kMaxRoundsPerEvent; ++round) {
+    // 内核会改写 namelen 和 controllen, 每次都要重置
+    for (size_t i = 0; i < msgs_.size(); ++i) {
+      struct msghdr& hdr = msgs_[i].msg_hdr;
+      hdr.msg_name = &peers_[i];
+      hdr.msg_namelen = static_cast<socklen_t>(sizeof peers_[i]);
+      hdr.msg_iov = &iovecs_[i];
+      hdr.msg_iovlen = 1;
+      hdr.msg_control = gro_ ? control_.data() + i * kControlSize : nullptr;
+      hdr.msg_controllen = gro_ ? kControlSize : 0;
+      hdr.msg_flags = 0;
+    }
+    int n = ::recvmmsg(socket_.Fd(), msgs_.data(),
+                       static_cast<unsigned int>(msgs_.size()), MSG_DONTWAIT,
+                       nullptr);
+    if (n <= 0) {
+      if (n < 0 && !WouldBlock(errno)) {
+        LOG_SYSERR << "UdpSocket::HandleRead";
+      }
+      break;
+    }
+    ++stats_.recvCalls;
+    datagrams_.clear();
+    for (size_t i = 0; i < static_cast<size_t>(n); ++i) {
+      if (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) {
+        ++stats_.truncated;
+      }
+      Split(i, msgs_[i].msg_len);
+    }
+    stats_.datagramsIn += datagrams_.size();
+    if (datagramsCallback_) {
+      datagramsCallback_(this, datagrams_.data(), datagrams_.size(),
+                         receiveTime);
+    }
+    if (static_cast<size_t>(n) < msgs_.size()) {
+      break;
+    }
+  }
+}
+
+void UdpSocket::Split(size_t i, size_t len) {
+  stats_.bytesIn += len;
+  size_t segment = len;
+#ifdef UDP_GRO
+  struct msghdr* hdr = &msgs_[i].msg_hdr;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int gsoSize = 0;
+      std::memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof gsoSize);
+      if (gsoSize > 0) {
+        segment = static_cast<size_t>(gsoSize);
+      }
+    }
+  }
+#endif
+  const char* data = static_cast<const char*>(iovecs_[i].iov_base);
+  InetAddress peer(peers_[i]);
+  if (len == 0) {
+    datagrams_.push_back({data, 0, peer});
+    return;
+  }
+  for (size_t offset = 0; offset < len; offset += segment) {
+    datagrams_.push_back({data + offset, std::min(segment, len - offset), peer});
+  }
+}
+
+size_t UdpSocket::SendBatch(const OutDatagram* datagrams, size_t count) {
+  loop_->AssertInLoopThread();
+  struct mmsghdr msgs[kDefaultBatch];
+  struct iovec iovecs[kDefaultBatch];
+  size_t delivered = 0;
+  size_t i = 0;
+  while (i < count) {
+    size_t n = std::min(count - i, static_cast<size_t>(kDefaultBatch));
+    for (size_t j = 0; j < n; ++j) {
+      const OutDatagram& datagram = datagrams[i + j];
+      iovecs[j].iov_base = const_cast<char*>(datagram.data.data());
+      iovecs[j].iov_len = datagram.data.size();
+      msgs[j] = mmsghdr();
+      msgs[j].msg_hdr.msg_name =
+          const_cast<struct sockaddr*>(datagram.peer.GetSockAddr());
+      msgs[j].msg_hdr.msg_namelen = AddressLength(datagram.peer);
+      msgs[j].msg_hdr.msg_iov = &iovecs[j];
+      msgs[j].msg_hdr.msg_iovlen = 1;
+    }
+    int ret = ::sendmmsg(socket_.Fd(), msgs, static_cast<unsigned int>(n), 0);
+    ++stats_.sendCalls;
+    if (ret > 0) {
+      for (int j = 0; j < ret; ++j) {
+        stats_.bytesOut += msgs[j].msg_len;
+      }
+      i += static_cast<size_t>(ret);
+      delivered += static_cast<size_t>(ret);
+    } else if (errno == EINTR) {
+      continue;
+    } else if (WouldBlock(errno)) {
+      break;
+    } else {
+      // 例如 EMSGSIZE, 跳过出错的数据报
+      LOG_SYSERR << "UdpSocket::SendBatch to " << datagrams[i].peer.ToIpPort();
+      ++i;
+    }
+  }
+  stats_.datagramsOut += delivered;
+  stats_.sendDropped += count - delivered;
+  return delivered;
+}
+
+bool UdpSocket::SendTo(std::string_view data, const InetAddress& peer) {
+  OutDatagram datagram{data, peer};
+  return SendBatch(&datagram, 1) == 1;
+}
+
+bool UdpSocket::SendSegments(std::string_view data, size_t segmentSize,
+                             const InetAddress& peer) {
+  loop_->AssertInLoopThread();
+  if (segmentSize == 0 || data.size() <= segmentSize) {
+    return SendTo(data, peer);
+  }
+#ifdef UDP_SEGMENT
+  size_t perSend =
+      std::min(kMaxGsoSegments, std::max<size_t>(kMaxGsoBytes / segmentSize, 1));
+  while (gso_ && !data.empty()) {
+    std::string_view chunk = data.substr(0, perSend * segmentSize);
+    struct iovec iov = {const_cast<char*>(chunk.data()), chunk.size()};
+    char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+    struct msghdr msg = {};
+    msg.msg_name = const_cast<struct sockaddr*>(peer.GetSockAddr());
+    msg.msg_namelen = AddressLength(peer);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    auto gsoSize = static_cast<uint16_t>(segmentSize);
+    std::memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof gsoSize);
+
+    size_t segments = (chunk.size() + segmentSize - 1) / segmentSize;
+    ssize_t n = ::sendmsg(socket_.Fd(), &msg, 0);
+    ++stats_.sendCalls;
+    if (n >= 0) {
+      stats_.datagramsOut += segments;
+      stats_.bytesOut += chunk.size();
+      data.remove_prefix(chunk.size());
+    } else if (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT) {
+      // 内核不支持 UDP_SEGMENT 或者网卡不支持校验和卸载, 以后不再尝试
+      LOG_WARN << "UdpSocket::SendSegments - UDP_SEGMENT unavailable, "
+                  "fall back to sendmmsg";
+      gso_ = false;
+    } else {
+      if (!WouldBlock(errno)) {
+        LOG_SYSERR << "UdpSocket::SendSegments to " << peer.ToIpPort();
+      }
+      stats_.sendDropped += (data.size() + segmentSize - 1) / segmentSize;
+      return false;
+    }
+  }
+  if (data.empty()) {
+    return true;
+  }
+#endif
+  std::vector<OutDatagram> datagrams;
+  datagrams.reserve((data.size() + segmentSize - 1) / segmentSize);
+  for (size_t offset = 0; offset < data.size(); offset += segmentSize) {
+    datagrams.push_back({data.substr(offset, segmentSize), peer});
+  }
+  return SendBatch(datagrams.data(), datagrams.size()) == datagrams.size();
+}
+
+}  // namespace rnet::network
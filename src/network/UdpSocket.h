@@ -0,0 +1,119 @@
+#pragma once
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "base/Common.h"
+#include "network/Channel.h"
+#include "network/NetAddress.h"
+#include "network/Socket.h"
+#include "unix/Time.h"
+namespace rnet::network {
+
+class EventLoop;
+class UdpSocket;
+
+// 收到的一个数据报, data 指向 UdpSocket 内部的接收缓冲区, 只在回调期间有效
+struct Datagram {
+  const char* data;
+  size_t size;
+  InetAddress peer;
+};
+
+// 待发送的一个数据报
+struct OutDatagram {
+  std::string_view data;
+  InetAddress peer;
+};
+
+struct UdpStats {
+  uint64_t datagramsIn = 0;
+  uint64_t bytesIn = 0;
+  uint64_t recvCalls = 0;
+  uint64_t truncated = 0;  // 超过接收缓冲区被截断的数据报
+  uint64_t datagramsOut = 0;
+  uint64_t bytesOut = 0;
+  uint64_t sendCalls = 0;
+  uint64_t sendDropped = 0;  // 发送缓冲区满等原因被丢弃的数据报
+};
+
+// 一次可读事件中收到的全部数据报
+using DatagramsCallback = std::function<void(
+    UdpSocket*, const Datagram* datagrams, size_t count, Unix::Timestamp)>;
+
+// 绑定到 EventLoop 的 UDP socket, 只能在 loop 线程中使用
+// 用 recvmmsg 一次系统调用收取一批数据报, 放在预先分配的一块缓冲区里, 批量交给回调
+// 用 sendmmsg 批量发送; 可选 UDP_GRO 接收内核合并的报文, 用 UDP_SEGMENT 一次发送
+// 多个等长的分段. 发送缓冲区满时数据报直接丢弃, 不排队
+class UdpSocket : Noncopyable {
+ public:
+  static const int kDefaultBatch = 64;
+  static const size_t kDefaultMaxDatagramSize = 2048;
+  // 开启 GRO 后一个接收槽位要能放下合并后的报文
+  static const size_t kGroBufferSize = 64 * 1024;
+
+  UdpSocket(EventLoop* loop, const InetAddress& bindAddr,
+            bool reuseport = false);
+  ~UdpSocket();
+
+  void SetDatagramsCallback(DatagramsCallback cb) {
+    datagramsCallback_ = std::move(cb);
+  }
+  /// 一次 recvmmsg 最多收取的数据报数. Must be called before Start
+  void SetBatch(int batch) { batch_ = batch; }
+  /// 接收缓冲区中每个数据报的槽位大小, 超出的部分被截断. Must be called before Start
+  void SetMaxDatagramSize(size_t size) { maxDatagramSize_ = size; }
+  /// 开启 UDP_GRO, 内核把同一个流的多个数据报合并后一次交上来,
+  /// 交给回调前按分段大小拆回单个数据报. Must be called before Start
+  bool EnableGro();
+  /// SO_RCVBUF, 高速率接收时避免内核队列溢出
+  bool SetReceiveBuffer(int bytes);
+
+  void Start();
+  void Stop();
+
+  /// 返回成功交给内核的数据报数, 剩下的被丢弃
+  size_t SendBatch(const OutDatagram* datagrams, size_t count);
+  bool SendTo(std::string_view data, const InetAddress& peer);
+  /// 把 data 按 segmentSize 切分成多个数据报发给同一个 peer, 最后一段可以较短
+  /// 支持 UDP_SEGMENT 时一次系统调用交给内核(或网卡)切分, 否则退化为 sendmmsg
+  bool SendSegments(std::string_view data, size_t segmentSize,
+                    const InetAddress& peer);
+
+  int Fd() const { return socket_.Fd(); }
+  EventLoop* GetLoop() const { return loop_; }
+  const InetAddress& LocalAddress() const { return localAddr_; }
+  const UdpStats& Stats() const { return stats_; }
+
+ private:
+  void HandleRead(Unix::Timestamp receiveTime);
+  void AllocateBuffers();
+  // 把第 i 个接收槽位中的报文按 GRO 分段大小拆开追加到 datagrams_
+  void Split(size_t i, size_t len);
+
+  EventLoop* loop_;
+  Socket socket_;
+  Channel channel_;
+  InetAddress localAddr_;
+  int batch_;
+  size_t maxDatagramSize_;
+  bool gro_;
+  bool gso_;  // 内核或网卡不支持 UDP_SEGMENT 时关闭
+  bool started_;
+  DatagramsCallback datagramsCallback_;
+  UdpStats stats_;
+
+  // recvmmsg 用的缓冲区, Start 时一次分配, 之后重复使用
+  std::vector<char> buffer_;
+  std::vector<char> control_;
+  std::vector<struct mmsghdr> msgs_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct sockaddr_in6> peers_;
+  std::vector<Datagram> datagrams_;
+};
+
+}  // namespace rnet::network
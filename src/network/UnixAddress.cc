@@ -0,0 +1,41 @@
+#include "network/UnixAddress.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "log/Logger.h"
+
+namespace rnet::network {
+
+UnixAddress::UnixAddress(std::string_view path) {
+  MemZero(&addr_, sizeof addr_);
+  addr_.sun_family = AF_UNIX;
+  bool abstract = !path.empty() && path.front() == '@';
+  // 文件系统路径要留一个字节给结尾的 '\0', 抽象地址的长度就是名字的长度
+  if (path.empty() || path.size() + (abstract ? 0 : 1) > sizeof addr_.sun_path) {
+    LOG_FATAL << "UnixAddress - invalid path '" << path << "'";
+  }
+  std::memcpy(addr_.sun_path, path.data(), path.size());
+  if (abstract) {
+    addr_.sun_path[0] = '\0';
+  }
+  len_ = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) +
+                                path.size() + (abstract ? 0 : 1));
+}
+
+std::string UnixAddress::ToString() const {
+  size_t size = len_ - offsetof(struct sockaddr_un, sun_path);
+  if (Abstract()) {
+    return "@" + std::string(addr_.sun_path + 1, size - 1);
+  }
+  return std::string(addr_.sun_path, size - 1);
+}
+
+InetAddress UnixAddress::AsInetAddress() {
+  struct sockaddr_in6 addr;
+  MemZero(&addr, sizeof addr);
+  addr.sin6_family = AF_UNIX;
+  return InetAddress(addr);
+}
+
+}  // namespace rnet::network
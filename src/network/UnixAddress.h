@@ -0,0 +1,37 @@
+#pragma once
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <string>
+#include <string_view>
+
+#include "base/Common.h"
+#include "network/NetAddress.h"
+namespace rnet::network {
+
+// AF_UNIX 地址. 以 '@' 开头的名字属于 Linux 的抽象命名空间,
+// 不在文件系统中创建文件, 最后一个引用关闭时自动消失
+class UnixAddress : public Copyable {
+ public:
+  /// @c path 超过 sun_path 的长度时 abort
+  explicit UnixAddress(std::string_view path);
+
+  const struct sockaddr* GetSockAddr() const {
+    return static_cast<const struct sockaddr*>(
+        implicit_cast<const void*>(&addr_));
+  }
+  socklen_t Length() const { return len_; }
+  bool Abstract() const { return addr_.sun_path[0] == '\0'; }
+  /// 文件系统路径, 抽象地址带上开头的 '@'
+  std::string ToString() const;
+
+  /// unix socket 连接的本端和对端地址仍然用 InetAddress 表示:
+  /// 地址族为 AF_UNIX, 其余字段为 0, ToIpPort 返回 "unix"
+  static InetAddress AsInetAddress();
+
+ private:
+  struct sockaddr_un addr_;
+  socklen_t len_;
+};
+
+}  // namespace rnet::network
@@ -0,0 +1,138 @@
+#include "unix/CpuSet.h"
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "file/File.h"
+
+namespace rnet::Unix {
+namespace {
+  // <numaif.h> 属于 libnuma, 这里直接用系统调用
+  constexpr int kMpolPreferred = 1;
+
+  std::string ReadSysFile( const char* path ) {
+    std::string result;
+    if ( file::ReadFile( path, 4096, &result ) != 0 ) {
+      result.clear();
+    }
+    while ( !result.empty() && ( result.back() == '\n' || result.back() == ' ' ) ) {
+      result.pop_back();
+    }
+    return result;
+  }
+}  // namespace
+
+std::vector< int > ParseCpuList( std::string_view list ) {
+  std::vector< int > cpus;
+  while ( !list.empty() ) {
+    size_t      comma = list.find( ',' );
+    std::string item{ list.substr( 0, comma ) };
+    list = comma == std::string_view::npos ? std::string_view{} : list.substr( comma + 1 );
+
+    char* end   = nullptr;
+    long  first = ::strtol( item.c_str(), &end, 10 );
+    long  last  = first;
+    if ( end == item.c_str() ) {
+      return {};
+    }
+    if ( *end == '-' ) {
+      const char* begin = end + 1;
+      last              = ::strtol( begin, &end, 10 );
+      if ( end == begin ) {
+        return {};
+      }
+    }
+    if ( *end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE ) {
+      return {};
+    }
+    for ( long cpu = first; cpu <= last; ++cpu ) {
+      cpus.push_back( static_cast< int >( cpu ) );
+    }
+  }
+  std::sort( cpus.begin(), cpus.end() );
+  cpus.erase( std::unique( cpus.begin(), cpus.end() ), cpus.end() );
+  return cpus;
+}
+
+std::string FormatCpuList( const std::vector< int >& cpus ) {
+  std::string result;
+  size_t      i = 0;
+  while ( i < cpus.size() ) {
+    size_t j = i;
+    while ( j + 1 < cpus.size() && cpus[ j + 1 ] == cpus[ j ] + 1 ) {
+      ++j;
+    }
+    if ( !result.empty() ) {
+      result += ',';
+    }
+    result += std::to_string( cpus[ i ] );
+    if ( j > i ) {
+      result += '-';
+      result += std::to_string( cpus[ j ] );
+    }
+    i = j + 1;
+  }
+  return result;
+}
+
+std::vector< int > AllowedCpus() {
+  std::vector< int > cpus;
+  cpu_set_t          set;
+  CPU_ZERO( &set );
+  if ( ::sched_getaffinity( 0, sizeof set, &set ) == 0 ) {
+    for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+      if ( CPU_ISSET( cpu, &set ) ) {
+        cpus.push_back( cpu );
+      }
+    }
+  }
+  return cpus;
+}
+
+int CurrentCpu() {
+  return ::sched_getcpu();
+}
+
+int NumNumaNodes() {
+  std::vector< int > nodes = ParseCpuList( ReadSysFile( "/sys/devices/system/node/online" ) );
+  return nodes.empty() ? 1 : nodes.back() + 1;
+}
+
+int NumaNodeOfCpu( int cpu ) {
+  int nodes = NumNumaNodes();
+  for ( int node = 0; node < nodes; ++node ) {
+    char path[ 64 ];
+    snprintf( path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node );
+    std::vector< int > cpus = ParseCpuList( ReadSysFile( path ) );
+    if ( std::binary_search( cpus.begin(), cpus.end(), cpu ) ) {
+      return node;
+    }
+  }
+  return 0;
+}
+
+bool SetThreadAffinity( const std::vector< int >& cpus ) {
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  for ( int cpu : cpus ) {
+    if ( cpu >= 0 && cpu < CPU_SETSIZE ) {
+      CPU_SET( cpu, &set );
+    }
+  }
+  return !cpus.empty() && ::sched_setaffinity( 0, sizeof set, &set ) == 0;
+}
+
+bool PreferNumaNode( int node ) {
+  if ( node < 0 || node >= static_cast< int >( sizeof( unsigned long ) * 8 ) ) {
+    return false;
+  }
+  unsigned long mask = 1UL << node;
+  return ::syscall( SYS_set_mempolicy, kMpolPreferred, &mask, sizeof( mask ) * 8 + 1 ) == 0;
+}
+
+}  // namespace rnet::Unix
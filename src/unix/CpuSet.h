@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+// cpu 亲和性与 numa 节点查询, 用于把 io 线程固定到指定的 cpu 上
+// numa 信息读 /sys/devices/system, 不依赖 libnuma, 非 numa 机器上全部视为节点 0
+namespace rnet::Unix {
+
+/// 解析内核 cpulist 格式, 如 "0-3,8,10-11", 格式错误返回空
+std::vector< int > ParseCpuList( std::string_view list );
+
+/// 转回 cpulist 格式, 用于日志
+std::string FormatCpuList( const std::vector< int >& cpus );
+
+/// 当前进程允许运行的 cpu, 受 taskset/cgroup cpuset 限制
+std::vector< int > AllowedCpus();
+
+/// 当前线程正在运行的 cpu
+int CurrentCpu();
+
+int NumNumaNodes();
+
+/// cpu 所在的 numa 节点, 未知时返回 0
+int NumaNodeOfCpu( int cpu );
+
+/// 把当前线程固定在 cpus 上
+bool SetThreadAffinity( const std::vector< int >& cpus );
+
+/// 当前线程此后分配的内存优先从 node 上取 (MPOL_PREFERRED)
+/// 已经分配过物理页的内存不受影响
+bool PreferNumaNode( int node );
+
+}  // namespace rnet::Unix
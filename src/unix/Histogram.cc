@@ -0,0 +1,87 @@
+#include "unix/Histogram.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace rnet::Unix {
+
+Histogram::Histogram() : count_(0), sum_(0), max_(0) {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+int Histogram::BucketIndex(uint64_t value) {
+  if (value < static_cast<uint64_t>(kLinearBuckets)) {
+    return static_cast<int>(value);
+  }
+  int exponent = 63 - __builtin_clzll(value);
+  if (exponent > kMaxExponent) {
+    return kNumBuckets - 1;
+  }
+  int sub = static_cast<int>(value >> (exponent - kSubBucketBits)) &
+            (kSubBuckets - 1);
+  return kLinearBuckets + (exponent - kSubBucketBits - 1) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::BucketUpperBound(int index) {
+  if (index < kLinearBuckets) {
+    return static_cast<uint64_t>(index);
+  }
+  int exponent = (index - kLinearBuckets) / kSubBuckets + kSubBucketBits + 1;
+  auto sub = static_cast<uint64_t>((index - kLinearBuckets) % kSubBuckets);
+  int shift = exponent - kSubBucketBits;
+  return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+double Histogram::Mean() const {
+  uint64_t count = Count();
+  return count == 0 ? 0.0
+                    : static_cast<double>(Sum()) / static_cast<double>(count);
+}
+
+uint64_t Histogram::Percentile(double q) const {
+  uint64_t counts[kNumBuckets];
+  uint64_t total = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  q = std::min(std::max(q, 0.0), 1.0);
+  auto rank = static_cast<uint64_t>(q * static_cast<double>(total));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return std::min(BucketUpperBound(i), Max());
+    }
+  }
+  return Max();
+}
+
+std::string Histogram::ToString(std::string_view name) const {
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "%.*s count=%" PRIu64 " mean=%.1f p50=%" PRIu64 " p90=%" PRIu64
+           " p99=%" PRIu64 " p999=%" PRIu64 " max=%" PRIu64,
+           static_cast<int>(name.size()), name.data(), Count(), Mean(),
+           Percentile(0.5), Percentile(0.9), Percentile(0.99),
+           Percentile(0.999), Max());
+  return buf;
+}
+
+void Histogram::Reset() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace rnet::Unix
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "base/Common.h"
+
+namespace rnet::Unix {
+
+// HDR 风格的对数线性直方图, 记录非负整数(通常是微秒或个数)
+// 小于 16 的值精确记录, 更大的值每个 2 的幂区间分成 8 个桶, 相对误差不超过 12.5%
+// 只允许一个线程写(通常是所属的 loop 线程), 写入是普通的 relaxed load/store, 没有锁和 RMW,
+// 任意线程可以同时读取, 读到的是近似一致的快照
+class Histogram : Noncopyable {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kLinearBuckets = 2 * kSubBuckets;
+  // 超过 2^40 的值记到最后一个桶
+  static constexpr int kMaxExponent = 40;
+  static constexpr int kNumBuckets =
+      kLinearBuckets + (kMaxExponent - kSubBucketBits) * kSubBuckets;
+
+  Histogram();
+
+  void Record(uint64_t value) {
+    Add(&buckets_[BucketIndex(value)], 1);
+    Add(&count_, 1);
+    Add(&sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t Sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+  double Mean() const;
+  /// q 取 [0, 1], 返回第 q 分位所在桶的上界, 没有记录时返回 0
+  uint64_t Percentile(double q) const;
+
+  /// "name count=.. mean=.. p50=.. p90=.. p99=.. p999=.. max=.."
+  std::string ToString(std::string_view name) const;
+
+  /// 只能由写线程调用
+  void Reset();
+
+  static int BucketIndex(uint64_t value);
+  /// 桶内最大的值
+  static uint64_t BucketUpperBound(int index);
+
+ private:
+  static void Add(std::atomic<uint64_t>* counter, uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n,
+                   std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> buckets_[kNumBuckets];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+
+}  // namespace rnet::Unix
@@ -0,0 +1,153 @@
+#include "unix/TaskPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "unix/CpuSet.h"
+#include "unix/ProcssInfo.h"
+
+using namespace rnet;
+using namespace rnet::thread;
+
+namespace {
+// 找不到任务时先自旋几轮再睡眠, 任务密集时避免频繁的 futex 唤醒
+constexpr int kSpinRounds = 64;
+
+thread_local TaskPool* tCurrentPool = nullptr;
+thread_local size_t    tWorkerIndex = 0;
+}  // namespace
+
+struct TaskPool::Worker {
+  explicit Worker( Thread::ThreadFunc func, const std::string& threadName ) : thread( std::move( func ), threadName ), randomState( reinterpret_cast< uintptr_t >( this ) | 1 ) {}
+
+  size_t NextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return static_cast< size_t >( randomState );
+  }
+
+  Thread                     thread;
+  WorkStealingDeque< Task* > deque;
+  uint64_t                   randomState;
+};
+
+TaskPool::TaskPool( const std::string& nameArg ) : name( nameArg ), pending_( 0 ), steals_( 0 ), sleepers_( 0 ), running_( false ) {}
+
+TaskPool::~TaskPool() {
+  if ( running_ ) {
+    Stop();
+  }
+}
+
+int TaskPool::DefaultNumThreads() {
+  auto cpus   = static_cast< int >( Unix::AllowedCpus().size() );
+  int  others = Unix::NumThreads() - 1;  // 不算调用者自己
+  return std::max( 1, cpus - std::max( 0, others ) );
+}
+
+void TaskPool::Start( int numThreads ) {
+  assert( workers_.empty() );
+  if ( numThreads <= 0 ) {
+    numThreads = DefaultNumThreads();
+  }
+  running_ = true;
+  for ( int i = 0; i < numThreads; ++i ) {
+    char buf[ name.size() + 32 ];
+    snprintf( buf, sizeof buf, "%s%d", name.c_str(), i );
+    workers_.push_back( std::make_unique< Worker >( std::bind( &TaskPool::WorkerLoop, this, static_cast< size_t >( i ) ), std::string( buf ) ) );
+  }
+  // 全部 Worker 构造完再启动, 窃取时会遍历 workers_
+  for ( auto& worker : workers_ ) {
+    worker->thread.Start();
+  }
+}
+
+void TaskPool::Stop() {
+  {
+    std::lock_guard lock( mutex_ );
+    running_ = false;
+  }
+  cond_.notify_all();
+  for ( auto& worker : workers_ ) {
+    worker->thread.Join();
+  }
+  workers_.clear();
+}
+
+void TaskPool::Submit( Task task ) {
+  auto* item = new Task( std::move( task ) );
+  pending_.fetch_add( 1 );
+  if ( tCurrentPool == this ) {
+    workers_[ tWorkerIndex ]->deque.Push( item );
+  }
+  else {
+    std::lock_guard lock( mutex_ );
+    injected_.push_back( item );
+  }
+  // pending_ 与 sleepers_ 都是 seq_cst, 工作线程睡眠前会在锁内重新检查 pending_, 不会丢失唤醒
+  if ( sleepers_.load() > 0 ) {
+    std::lock_guard lock( mutex_ );
+    cond_.notify_one();
+  }
+}
+
+// 顺序: 自己的队列 -> 注入队列 -> 随机选一个其他工作线程开始依次窃取
+bool TaskPool::TryTake( Worker* self, Task** task ) {
+  if ( self->deque.Pop( task ) ) {
+    return true;
+  }
+  {
+    std::lock_guard lock( mutex_ );
+    if ( !injected_.empty() ) {
+      *task = injected_.front();
+      injected_.pop_front();
+      return true;
+    }
+  }
+  size_t n     = workers_.size();
+  size_t start = self->NextRandom() % n;
+  for ( size_t i = 0; i < n; ++i ) {
+    Worker* victim = workers_[ ( start + i ) % n ].get();
+    if ( victim != self && victim->deque.Steal( task ) ) {
+      steals_.fetch_add( 1, std::memory_order_relaxed );
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskPool::Run( Task* task ) {
+  pending_.fetch_sub( 1 );
+  std::unique_ptr< Task > holder( task );
+  ( *task )();
+}
+
+void TaskPool::WorkerLoop( size_t index ) {
+  tCurrentPool = this;
+  tWorkerIndex = index;
+  Worker* self = workers_[ index ].get();
+  Task*   task = nullptr;
+  int     idle = 0;
+  while ( true ) {
+    if ( TryTake( self, &task ) ) {
+      idle = 0;
+      Run( task );
+      continue;
+    }
+    if ( ++idle < kSpinRounds ) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock lock( mutex_ );
+    if ( !running_ && pending_.load() == 0 ) {
+      break;
+    }
+    sleepers_.fetch_add( 1 );
+    cond_.wait( lock, [ this ] { return pending_.load() > 0 || !running_; } );
+    sleepers_.fetch_sub( 1 );
+    idle = 0;
+  }
+  tCurrentPool = nullptr;
+}
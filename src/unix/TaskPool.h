@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/Common.h"
+#include "unix/Thread.h"
+#include "unix/WorkStealingDeque.h"
+
+namespace rnet::thread {
+
+// 计算线程池, 每个工作线程一个 Chase-Lev 队列, 空闲线程从其他线程的队列尾部窃取任务
+// 工作线程内提交的任务(任务再拆分子任务)进入自己的队列, 不加锁
+// 其他线程(如 io 线程)提交的任务进入一个共享的注入队列, 由工作线程取走
+// 用于把 json 解析, 加解密等 cpu 密集的工作移出 io 线程, 见 network/Offload.h
+class TaskPool : Noncopyable {
+public:
+  using Task = std::function< void() >;
+
+  explicit TaskPool( const std::string& nameArg = std::string( "TaskPool" ) );
+  ~TaskPool();
+
+  // numThreads <= 0 时使用 DefaultNumThreads()
+  void Start( int numThreads = 0 );
+  // 已经提交的任务执行完之后再退出
+  void Stop();
+
+  // 可在任意线程调用
+  void Submit( Task task );
+
+  int NumThreads() const {
+    return static_cast< int >( workers_.size() );
+  }
+  // 已提交但还没有开始执行的任务数
+  int64_t Pending() const {
+    return pending_.load( std::memory_order_relaxed );
+  }
+  // 窃取成功的次数
+  int64_t Steals() const {
+    return steals_.load( std::memory_order_relaxed );
+  }
+
+  // 进程可用的 cpu 数(考虑 taskset/cpuset)减去已经存在的其他线程数, 至少为 1
+  // 在 io 线程都启动之后调用, 计算线程正好占满剩下的 cpu
+  static int DefaultNumThreads();
+
+private:
+  struct Worker;
+
+  void WorkerLoop( size_t index );
+  bool TryTake( Worker* self, Task** task );
+  void Run( Task* task );
+
+  const std::string                        name;
+  std::vector< std::unique_ptr< Worker > > workers_;
+  std::mutex                               mutex_;
+  std::condition_variable                  cond_;
+  std::deque< Task* >                      injected_;  // guarded by mutex_
+  std::atomic< int64_t >                   pending_;
+  std::atomic< int64_t >                   steals_;
+  std::atomic< int >                       sleepers_;
+  std::atomic< bool >                      running_;
+};
+
+}  // namespace rnet::thread
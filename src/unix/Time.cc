@@ -1,6 +1,7 @@
 #include "Time.h"
 
 #include <sys/time.h>
+#include <time.h>
 
 #include <cassert>
 #include <cinttypes>
@@ -43,3 +44,10 @@ Timestamp Timestamp::Now() {
   int64_t seconds = tv.tv_sec;
   return Timestamp( seconds * kMicroSecondsPerSecond + tv.tv_usec );
 }
+
+Timestamp Timestamp::NowCoarse() {
+  struct timespec ts;
+  clock_gettime( CLOCK_REALTIME_COARSE, &ts );
+  int64_t seconds = ts.tv_sec;
+  return Timestamp( seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000 );
+}
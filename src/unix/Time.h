@@ -49,6 +49,12 @@ public:
   /// Get time of now.
   ///
   static Timestamp Now();
+  ///
+  /// Get time of now from CLOCK_REALTIME_COARSE.
+  ///
+  /// Resolution is one jiffy (1-4ms) but it is read from vDSO without
+  /// touching the hardware clock, suitable for log timestamps.
+  static Timestamp NowCoarse();
   static Timestamp Invalid() {
     return Timestamp();
   }
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "base/Common.h"
+
+namespace rnet::thread {
+
+// Chase-Lev 工作窃取双端队列, 按 Lê et al. "Correct and Efficient Work-Stealing for Weak Memory Models" 实现
+// 只有拥有者线程可以 Push/Pop (在 bottom 端, 后进先出), 其他线程只能 Steal (在 top 端, 先进先出)
+// 元素必须是平凡可复制的类型, 一般存指针
+// 容量不够时翻倍, 旧数组可能还在被窃取者读取, 保留到析构时再释放
+template < typename T > class WorkStealingDeque : Noncopyable {
+  static_assert( std::is_trivially_copyable_v< T >, "WorkStealingDeque stores T in std::atomic" );
+
+public:
+  explicit WorkStealingDeque( int64_t capacity = 256 ) : top_( 0 ), bottom_( 0 ) {
+    assert( capacity > 0 && ( capacity & ( capacity - 1 ) ) == 0 );
+    garbage_.push_back( std::make_unique< Array >( capacity ) );
+    array_.store( garbage_.back().get(), std::memory_order_relaxed );
+  }
+
+  // owner only
+  void Push( T item ) {
+    int64_t b = bottom_.load( std::memory_order_relaxed );
+    int64_t t = top_.load( std::memory_order_acquire );
+    Array*  a = array_.load( std::memory_order_relaxed );
+    if ( b - t > a->capacity - 1 ) {
+      a = Grow( a, b, t );
+    }
+    a->Put( b, item );
+    std::atomic_thread_fence( std::memory_order_release );
+    bottom_.store( b + 1, std::memory_order_relaxed );
+  }
+
+  // owner only
+  bool Pop( T* item ) {
+    int64_t b = bottom_.load( std::memory_order_relaxed ) - 1;
+    Array*  a = array_.load( std::memory_order_relaxed );
+    bottom_.store( b, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t t = top_.load( std::memory_order_relaxed );
+
+    bool ok = t <= b;
+    if ( ok ) {
+      *item = a->Get( b );
+      if ( t == b ) {
+        // 只剩最后一个, 和窃取者竞争
+        ok = top_.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+        bottom_.store( b + 1, std::memory_order_relaxed );
+      }
+    }
+    else {
+      bottom_.store( b + 1, std::memory_order_relaxed );
+    }
+    return ok;
+  }
+
+  // any thread
+  bool Steal( T* item ) {
+    int64_t t = top_.load( std::memory_order_acquire );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t b = bottom_.load( std::memory_order_acquire );
+    if ( t >= b ) {
+      return false;
+    }
+    Array* a = array_.load( std::memory_order_acquire );
+    T      x = a->Get( t );
+    if ( !top_.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+      return false;
+    }
+    *item = x;
+    return true;
+  }
+
+  // 近似值, 只用于统计和调度判断
+  int64_t Size() const {
+    int64_t b = bottom_.load( std::memory_order_relaxed );
+    int64_t t = top_.load( std::memory_order_relaxed );
+    return b > t ? b - t : 0;
+  }
+
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+private:
+  struct Array {
+    explicit Array( int64_t capacityArg ) : capacity( capacityArg ), mask( capacityArg - 1 ), buffer( new std::atomic< T >[ static_cast< size_t >( capacityArg ) ] ) {}
+
+    void Put( int64_t index, T item ) {
+      buffer[ index & mask ].store( item, std::memory_order_relaxed );
+    }
+    T Get( int64_t index ) const {
+      return buffer[ index & mask ].load( std::memory_order_relaxed );
+    }
+
+    const int64_t                         capacity;
+    const int64_t                         mask;
+    std::unique_ptr< std::atomic< T >[] > buffer;
+  };
+
+  Array* Grow( Array* old, int64_t b, int64_t t ) {
+    auto bigger = std::make_unique< Array >( old->capacity * 2 );
+    for ( int64_t i = t; i < b; ++i ) {
+      bigger->Put( i, old->Get( i ) );
+    }
+    Array* a = bigger.get();
+    garbage_.push_back( std::move( bigger ) );
+    array_.store( a, std::memory_order_release );
+    return a;
+  }
+
+  // top_ 被窃取者修改, bottom_ 只被拥有者修改, 分开放在不同的 cache line
+  alignas( 64 ) std::atomic< int64_t >   top_;
+  alignas( 64 ) std::atomic< int64_t >   bottom_;
+  std::atomic< Array* >                   array_;
+  std::vector< std::unique_ptr< Array > > garbage_;  // owner only
+};
+
+}  // namespace rnet::thread
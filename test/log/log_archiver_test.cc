@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "log/LogArchiver.h"
+
+using namespace rnet;
+using namespace rnet::log;
+
+namespace {
+
+// 在临时目录中运行, LogArchiver 按当前目录查找滚动的文件
+class TempDir {
+public:
+  TempDir() {
+    char tmpl[] = "/tmp/rnet_archiver_XXXXXX";
+    path_       = ::mkdtemp( tmpl );
+    char cwd[ PATH_MAX ];
+    oldCwd_ = ::getcwd( cwd, sizeof cwd );
+    EXPECT_EQ( 0, ::chdir( path_.c_str() ) );
+  }
+  ~TempDir() {
+    EXPECT_EQ( 0, ::chdir( oldCwd_.c_str() ) );
+    std::filesystem::remove_all( path_ );
+  }
+
+private:
+  std::string path_;
+  std::string oldCwd_;
+};
+
+void WriteFile( const std::string& name, const std::string& content ) {
+  FILE* fp = ::fopen( name.c_str(), "we" );
+  ASSERT_NE( nullptr, fp );
+  ::fwrite( content.data(), 1, content.size(), fp );
+  ::fclose( fp );
+}
+
+bool Exists( const std::string& name ) {
+  struct stat st;
+  return ::stat( name.c_str(), &st ) == 0;
+}
+
+std::string RolledName( int index ) {
+  char buf[ 64 ];
+  snprintf( buf, sizeof buf, "app.20261019-0000%02d.host.1.%06d.log", index, index );
+  return buf;
+}
+
+}  // namespace
+
+// 压缩后只留下 .gz, 内容与原文件相同
+TEST( LOG_ARCHIVER_TEST, COMPRESS ) {
+  TempDir     dir;
+  std::string content;
+  for ( int i = 0; i < 1000; ++i ) {
+    content += "line " + std::to_string( i ) + "\n";
+  }
+  std::string name = RolledName( 1 );
+  WriteFile( name, content );
+
+  LogArchiver archiver( "app", LogArchiver::Options() );
+  archiver.Start();
+  archiver.Submit( name );
+  archiver.Stop();
+
+  EXPECT_FALSE( Exists( name ) );
+  EXPECT_FALSE( Exists( name + ".gz.tmp" ) );
+  ASSERT_TRUE( Exists( name + ".gz" ) );
+  gzFile in = ::gzopen( ( name + ".gz" ).c_str(), "rb" );
+  ASSERT_NE( nullptr, in );
+  std::string decompressed( content.size() + 1, '\0' );
+  int         n = ::gzread( in, decompressed.data(), static_cast< unsigned >( decompressed.size() ) );
+  ::gzclose( in );
+  ASSERT_EQ( static_cast< int >( content.size() ), n );
+  decompressed.resize( static_cast< size_t >( n ) );
+  EXPECT_EQ( content, decompressed );
+}
+
+// 按文件数保留最新的几个, 正在写的文件和其他前缀的文件不动
+TEST( LOG_ARCHIVER_TEST, RETAIN_MAX_FILES ) {
+  TempDir dir;
+  for ( int i = 1; i <= 5; ++i ) {
+    WriteFile( RolledName( i ), "x" );
+  }
+  WriteFile( "other.20261019-000000.host.1.000001.log", "x" );
+  std::string active = RolledName( 6 );
+  WriteFile( active, "x" );
+
+  LogArchiver::Options options;
+  options.compress = false;
+  options.maxFiles = 2;
+  LogArchiver archiver( "app", options );
+  archiver.SetActiveFile( active );
+  archiver.Start();
+  archiver.Submit( RolledName( 5 ) );
+  archiver.Stop();
+
+  EXPECT_FALSE( Exists( RolledName( 1 ) ) );
+  EXPECT_FALSE( Exists( RolledName( 2 ) ) );
+  EXPECT_FALSE( Exists( RolledName( 3 ) ) );
+  EXPECT_TRUE( Exists( RolledName( 4 ) ) );
+  EXPECT_TRUE( Exists( RolledName( 5 ) ) );
+  EXPECT_TRUE( Exists( active ) );
+  EXPECT_TRUE( Exists( "other.20261019-000000.host.1.000001.log" ) );
+}
+
+// 从新到旧累计大小, 超过上限的旧文件删除, 压缩后的文件同样计入
+TEST( LOG_ARCHIVER_TEST, RETAIN_MAX_BYTES ) {
+  TempDir dir;
+  for ( int i = 1; i <= 4; ++i ) {
+    WriteFile( RolledName( i ), std::string( 100, 'x' ) );
+  }
+  WriteFile( RolledName( 5 ) + ".gz", std::string( 100, 'x' ) );
+
+  LogArchiver::Options options;
+  options.compress      = false;
+  options.maxTotalBytes = 250;
+  LogArchiver archiver( "app", options );
+  archiver.Start();
+  archiver.Submit( RolledName( 4 ) );
+  archiver.Stop();
+
+  EXPECT_FALSE( Exists( RolledName( 1 ) ) );
+  EXPECT_FALSE( Exists( RolledName( 2 ) ) );
+  EXPECT_FALSE( Exists( RolledName( 3 ) ) );
+  EXPECT_TRUE( Exists( RolledName( 4 ) ) );
+  EXPECT_TRUE( Exists( RolledName( 5 ) + ".gz" ) );
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "log/Logger.h"
+#include "unix/Thread.h"
+
+using namespace rnet;
+using namespace rnet::log;
+
+namespace {
+std::vector< std::string > gLines;
+
+void CaptureOutput( const char* msg, size_t len ) {
+  gLines.emplace_back( msg, len );
+}
+}  // namespace
+
+TEST( LOG_LIMITER_TEST, EVERY_N ) {
+  Logger::SetOutput( CaptureOutput );
+  gLines.clear();
+  for ( int i = 0; i < 10; ++i ) {
+    LOG_EVERY_N( warn, 3 ) << "every " << i;
+  }
+  ASSERT_EQ( 4u, gLines.size() );
+  EXPECT_NE( gLines[ 0 ].find( "every 0" ), std::string::npos );
+  EXPECT_EQ( gLines[ 0 ].find( "suppressed" ), std::string::npos );
+  EXPECT_NE( gLines[ 1 ].find( "[suppressed 2 messages] every 3" ), std::string::npos );
+}
+
+TEST( LOG_LIMITER_TEST, FIRST_N ) {
+  Logger::SetOutput( CaptureOutput );
+  gLines.clear();
+  for ( int i = 0; i < 10; ++i ) {
+    LOG_FIRST_N( error, 2 ) << "first " << i;
+  }
+  ASSERT_EQ( 2u, gLines.size() );
+  EXPECT_NE( gLines[ 1 ].find( "first 1" ), std::string::npos );
+}
+
+TEST( LOG_LIMITER_TEST, EVERY_T ) {
+  Logger::SetOutput( CaptureOutput );
+  gLines.clear();
+  for ( int i = 0; i < 1000; ++i ) {
+    LOG_EVERY_T( syserr, 60 ) << "storm";
+  }
+  EXPECT_EQ( 1u, gLines.size() );
+
+  LogEveryT state;
+  int64_t   suppressed = -1;
+  EXPECT_TRUE( state.ShouldLog( 0.01, &suppressed ) );
+  EXPECT_EQ( 0, suppressed );
+  EXPECT_FALSE( state.ShouldLog( 0.01, &suppressed ) );
+  EXPECT_FALSE( state.ShouldLog( 0.01, &suppressed ) );
+  thread::SleepUsec( 50 * 1000 );
+  EXPECT_TRUE( state.ShouldLog( 0.01, &suppressed ) );
+  EXPECT_EQ( 2, suppressed );
+}
+
+TEST( LOG_LIMITER_TEST, TOKEN_BUCKET ) {
+  Logger::SetOutput( CaptureOutput );
+  gLines.clear();
+  for ( int i = 0; i < 100; ++i ) {
+    LOG_RATE_LIMITED( error, 1, 5 ) << "bucket";
+  }
+  // 突发5条之后全部丢弃
+  EXPECT_EQ( 5u, gLines.size() );
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "log/LogModule.h"
+#include "log/Logger.h"
+
+using namespace rnet;
+using namespace rnet::log;
+
+namespace {
+std::string gLastLine;
+
+void CaptureOutput( const char* msg, size_t len ) {
+  gLastLine.assign( msg, len );
+}
+}  // namespace
+
+TEST( LOG_MODULE_TEST, FILE_AND_MODULE_LEVEL ) {
+  Logger::SetOutput( CaptureOutput );
+  Logger::SetLogLevel( Logger::info );
+
+  gLastLine.clear();
+  LOG_DEBUG << "hidden";
+  EXPECT_TRUE( gLastLine.empty() );
+
+  // 本文件位于 test/log 目录,模块名为 log
+  LogModule::SetLevel( "log", Logger::debug );
+  LOG_DEBUG << "module";
+  EXPECT_NE( gLastLine.find( "module" ), std::string::npos );
+
+  // 文件级别优先于模块级别
+  LogModule::SetLevel( "log_module_test.cc", Logger::warn );
+  gLastLine.clear();
+  LOG_INFO << "hidden";
+  EXPECT_TRUE( gLastLine.empty() );
+
+  LogModule::ResetLevel( "log_module_test.cc" );
+  LogModule::ResetLevel( "log" );
+  gLastLine.clear();
+  LOG_DEBUG << "hidden";
+  EXPECT_TRUE( gLastLine.empty() );
+}
+
+TEST( LOG_MODULE_TEST, APPLY_SPEC ) {
+  Logger::SetOutput( CaptureOutput );
+  Logger::SetLogLevel( Logger::info );
+
+  EXPECT_FALSE( LogModule::ApplySpec( "log=verbose" ) );
+  EXPECT_FALSE( LogModule::ApplySpec( "log" ) );
+  EXPECT_TRUE( LogModule::ApplySpec( " log = TRACE , network=error" ) );
+
+  gLastLine.clear();
+  LOG_TRACE << "spec";
+  EXPECT_NE( gLastLine.find( "spec" ), std::string::npos );
+
+  LogModule::ResetLevel( "log" );
+  LogModule::ResetLevel( "network" );
+}
+
+TEST( LOG_MODULE_TEST, GLOBAL_LEVEL_PROPAGATES ) {
+  Logger::SetOutput( CaptureOutput );
+  Logger::SetLogLevel( Logger::error );
+  gLastLine.clear();
+  LOG_WARN << "hidden";
+  EXPECT_TRUE( gLastLine.empty() );
+
+  Logger::SetLogLevel( Logger::info );
+  LOG_WARN << "warn";
+  EXPECT_NE( gLastLine.find( "warn" ), std::string::npos );
+}
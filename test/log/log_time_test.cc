@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "log/Logger.h"
+#include "unix/Time.h"
+
+using namespace rnet;
+using namespace rnet::log;
+
+namespace {
+std::vector< std::string > gLines;
+Unix::Timestamp            gNow;
+
+void CaptureOutput( const char* msg, size_t len ) {
+  gLines.emplace_back( msg, len );
+}
+
+Unix::Timestamp FakeNow() {
+  return gNow;
+}
+
+// 在 us 微秒时刻打一条日志, 返回时间前缀
+std::string PrefixAt( int64_t us ) {
+  gNow = Unix::Timestamp( us );
+  gLines.clear();
+  LOG_INFO << "tick";
+  return gLines.empty() ? std::string() : gLines[ 0 ].substr( 0, 26 );
+}
+}  // namespace
+
+// 秒以上部分缓存, 跨秒时重建, 同一秒内只改写微秒
+TEST( LOG_TIME_TEST, PREFIX_ACROSS_SECONDS ) {
+  Logger::SetOutput( CaptureOutput );
+  Logger::SetTimeFunc( FakeNow );
+  const int64_t kSecond = Unix::Timestamp::kMicroSecondsPerSecond;
+
+  EXPECT_EQ( "20231114 22:13:20.999999Z ", PrefixAt( 1700000000 * kSecond + 999999 ) );
+  EXPECT_EQ( "20231114 22:13:21.000000Z ", PrefixAt( 1700000001 * kSecond ) );
+  EXPECT_EQ( "20231114 22:13:21.000042Z ", PrefixAt( 1700000001 * kSecond + 42 ) );
+  // 时间回退到上一秒同样要重建
+  EXPECT_EQ( "20231114 22:13:20.000007Z ", PrefixAt( 1700000000 * kSecond + 7 ) );
+  // 跨年
+  EXPECT_EQ( "20231231 23:59:59.500000Z ", PrefixAt( 1704067199 * kSecond + 500000 ) );
+  EXPECT_EQ( "20240101 00:00:00.000001Z ", PrefixAt( 1704067200 * kSecond + 1 ) );
+
+  Logger::SetTimeFunc( Unix::Timestamp::Now );
+}
+
+// 粗粒度时钟和 gettimeofday 相差不超过几个 jiffy
+TEST( LOG_TIME_TEST, COARSE_CLOCK ) {
+  Unix::Timestamp coarse = Unix::Timestamp::NowCoarse();
+  Unix::Timestamp now    = Unix::Timestamp::Now();
+  EXPECT_TRUE( coarse.Valid() );
+  EXPECT_LT( std::fabs( Unix::TimeDifference( now, coarse ) ), 0.1 );
+
+  Logger::SetOutput( CaptureOutput );
+  Logger::SetTimeFunc( Unix::Timestamp::NowCoarse );
+  gLines.clear();
+  LOG_INFO << "coarse";
+  Logger::SetTimeFunc( Unix::Timestamp::Now );
+  ASSERT_EQ( 1u, gLines.size() );
+  // 只比较日期, 时分秒可能正好跨过边界
+  EXPECT_EQ( now.ToFormattedString( false ).substr( 0, 8 ), gLines[ 0 ].substr( 0, 8 ) );
+}
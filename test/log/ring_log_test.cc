@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "log/RingLogFile.h"
+
+using namespace rnet;
+using namespace rnet::log;
+
+namespace {
+std::vector< std::string > ReadRecords( const std::string& filename ) {
+  std::vector< std::string > records;
+  EXPECT_TRUE( RingLogFile::ReadAll( filename, [ &records ]( std::string_view record ) { records.emplace_back( record ); } ) );
+  return records;
+}
+}  // namespace
+
+TEST( RING_LOG_TEST, WRAP_KEEPS_NEWEST ) {
+  std::string filename = "ring_log_test.ring";
+  ::unlink( filename.c_str() );
+  {
+    RingLogFile ring( filename, 4096, false );
+    for ( int i = 0; i < 1000; ++i ) {
+      std::string line = "line " + std::to_string( i ) + "\n";
+      ring.Append( line.data(), static_cast< int >( line.size() ) );
+    }
+  }
+  auto records = ReadRecords( filename );
+  ASSERT_FALSE( records.empty() );
+  EXPECT_LT( records.size(), 1000u );
+  EXPECT_EQ( "line 999\n", records.back() );
+  // 剩下的是连续的最新记录
+  int first = std::stoi( records.front().substr( 5 ) );
+  for ( size_t i = 0; i < records.size(); ++i ) {
+    EXPECT_EQ( "line " + std::to_string( first + static_cast< int >( i ) ) + "\n", records[ i ] );
+  }
+  ::unlink( filename.c_str() );
+}
+
+TEST( RING_LOG_TEST, REOPEN_APPENDS ) {
+  std::string filename = "ring_log_reopen_test.ring";
+  ::unlink( filename.c_str() );
+  {
+    RingLogFile ring( filename, 8192 );
+    ring.Append( "before restart\n", 15 );
+  }
+  {
+    RingLogFile ring( filename, 8192 );
+    ring.Append( "after restart\n", 14 );
+  }
+  auto records = ReadRecords( filename );
+  ASSERT_EQ( 2u, records.size() );
+  EXPECT_EQ( "before restart\n", records[ 0 ] );
+  EXPECT_EQ( "after restart\n", records[ 1 ] );
+  ::unlink( filename.c_str() );
+}
+
+// AsyncLogging 整块写入, 比 ring 还大时按行保留最新的部分
+TEST( RING_LOG_TEST, LARGE_APPEND_SPLITS_ON_LINES ) {
+  std::string filename = "ring_log_large_test.ring";
+  ::unlink( filename.c_str() );
+  std::string small, large;
+  for ( int i = 0; i < 500; ++i ) {
+    small += "small " + std::to_string( i ) + "\n";
+  }
+  for ( int i = 0; i < 10000; ++i ) {
+    large += "large " + std::to_string( i ) + "\n";
+  }
+  {
+    RingLogFile ring( filename, 16384, false );
+    ring.Append( small.data(), static_cast< int >( small.size() ) );
+    auto records = ReadRecords( filename );
+    ASSERT_GT( records.size(), 1u );
+    std::string joined;
+    for ( const auto& record : records ) {
+      EXPECT_EQ( '\n', record.back() );
+      joined += record;
+    }
+    EXPECT_EQ( small, joined );
+
+    ring.Append( large.data(), static_cast< int >( large.size() ) );
+  }
+  auto        records = ReadRecords( filename );
+  std::string joined;
+  for ( const auto& record : records ) {
+    EXPECT_EQ( '\n', record.back() );
+    joined += record;
+  }
+  // 保留下来的是 small 的一段后缀接上 large 的一段后缀, 都从行首开始, large 部分超过半个 ring
+  size_t pos = joined.find( "large " );
+  ASSERT_NE( std::string::npos, pos );
+  std::string older = joined.substr( 0, pos ), newer = joined.substr( pos );
+  EXPECT_GT( newer.size(), 16384u / 2 );
+  ASSERT_LE( newer.size(), large.size() );
+  EXPECT_EQ( 0, large.compare( large.size() - newer.size(), newer.size(), newer ) );
+  ASSERT_LE( older.size(), small.size() );
+  EXPECT_EQ( 0, small.compare( small.size() - older.size(), older.size(), older ) );
+  EXPECT_TRUE( older.empty() || older.compare( 0, 6, "small " ) == 0 );
+  ::unlink( filename.c_str() );
+}
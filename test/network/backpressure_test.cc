@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "loopback.h"
+#include "network/EventLoop.h"
+#include "network/TcpConnection.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+namespace {
+
+// 尽量写满对端, 返回写入的字节数
+size_t Flood( int fd ) {
+  static const std::string chunk( 64 * 1024, 'x' );
+  size_t                   total = 0;
+  ssize_t                  n;
+  while ( ( n = ::write( fd, chunk.data(), chunk.size() ) ) > 0 ) {
+    total += static_cast< size_t >( n );
+  }
+  return total;
+}
+
+size_t Drain( int fd ) {
+  char    buf[ 64 * 1024 ];
+  size_t  total = 0;
+  ssize_t n;
+  while ( ( n = ::read( fd, buf, sizeof buf ) ) > 0 ) {
+    total += static_cast< size_t >( n );
+  }
+  return total;
+}
+
+void RunFor( EventLoop* loop, double seconds ) {
+  loop->RunAfter( seconds, [ loop ] { loop->Quit(); } );
+  loop->Loop();
+}
+
+}  // namespace
+
+// 回复在 outputBuffer 中积压时暂停读请求, 对端读走回复后恢复
+TEST( BACKPRESSURE_TEST, PAUSE_ON_OWN_OUTPUT ) {
+  EventLoop        loop;
+  int              client = -1;
+  TcpConnectionPtr conn;
+  ASSERT_NO_FATAL_FAILURE( MakeConnection( &loop, "self", &conn, &client, SOCK_NONBLOCK ) );
+  conn->SetBackpressure( 256 * 1024, 64 * 1024 );
+  std::string reply( 16 * 1024 * 1024, 'r' );
+  conn->SetMessageCallback( [ &reply ]( const TcpConnectionPtr& c, file::Buffer* buf, Unix::Timestamp ) {
+    buf->RetrieveAll();
+    c->Send( reply );
+  } );
+  conn->ConnectEstablished();
+
+  ASSERT_EQ( 1, ::write( client, "a", 1 ) );
+  RunFor( &loop, 0.05 );
+  EXPECT_TRUE( conn->ReadPaused() );
+  EXPECT_TRUE( conn->IsReading() );
+  EXPECT_EQ( 1u, conn->Stats().readPauses );
+
+  // 暂停期间的请求留在内核里
+  ASSERT_EQ( 1, ::write( client, "b", 1 ) );
+  RunFor( &loop, 0.02 );
+  EXPECT_EQ( 1u, conn->Stats().messagesReceived );
+
+  size_t received = 0;
+  loop.RunEvery( 0.001, [ & ] {
+    received += Drain( client );
+    if ( conn->Stats().messagesReceived == 2 ) {
+      loop.Quit();
+    }
+  } );
+  loop.Loop();
+  EXPECT_EQ( 2u, conn->Stats().messagesReceived );
+  EXPECT_GE( received, reply.size() );
+
+  conn->ConnectDestroyed();
+  ::close( client );
+}
+
+// 转发时下游积压, 暂停上游; 下游关闭后上游恢复
+TEST( BACKPRESSURE_TEST, PAUSE_LINKED_SOURCE ) {
+  EventLoop        loop;
+  int              upClient   = -1;
+  int              downClient = -1;
+  TcpConnectionPtr up;
+  TcpConnectionPtr down;
+  ASSERT_NO_FATAL_FAILURE( MakeConnection( &loop, "up", &up, &upClient, SOCK_NONBLOCK ) );
+  ASSERT_NO_FATAL_FAILURE( MakeConnection( &loop, "down", &down, &downClient, SOCK_NONBLOCK ) );
+  down->SetBackpressure( 256 * 1024, 64 * 1024 );
+  down->SetBackpressureSource( up );
+  up->SetMessageCallback( [ &down ]( const TcpConnectionPtr&, file::Buffer* buf, Unix::Timestamp ) { down->Send( buf ); } );
+  up->ConnectEstablished();
+  down->ConnectEstablished();
+
+  size_t sent = 0;
+  loop.RunEvery( 0.001, [ & ] { sent += Flood( upClient ); } );
+  RunFor( &loop, 0.2 );
+  EXPECT_TRUE( up->ReadPaused() );
+  EXPECT_FALSE( down->ReadPaused() );
+  EXPECT_LT( up->Stats().bytesReceived, sent );
+  // 超过高水位的部分最多是暂停前的最后一次读
+  EXPECT_LT( down->OutputBuffer()->ReadableBytes(), 512u * 1024 );
+
+  down->ConnectDestroyed();
+  EXPECT_FALSE( up->ReadPaused() );
+  up->ConnectDestroyed();
+  ::close( upClient );
+  ::close( downClient );
+}
+
+// inputBuffer 积压到上限时暂停读, 取走数据后恢复
+TEST( BACKPRESSURE_TEST, PAUSE_ON_INPUT_LIMIT ) {
+  EventLoop        loop;
+  int              client = -1;
+  TcpConnectionPtr conn;
+  ASSERT_NO_FATAL_FAILURE( MakeConnection( &loop, "input", &conn, &client, SOCK_NONBLOCK ) );
+  conn->SetMaxInputBuffer( 4096 );
+  conn->SetMessageCallback( []( const TcpConnectionPtr&, file::Buffer*, Unix::Timestamp ) {} );
+  conn->ConnectEstablished();
+
+  size_t sent = Flood( client );
+  RunFor( &loop, 0.05 );
+  EXPECT_TRUE( conn->ReadPaused() );
+  EXPECT_GE( conn->InputBuffer()->ReadableBytes(), 4096u );
+  EXPECT_LT( conn->InputBuffer()->ReadableBytes(), sent );
+
+  conn->InputBuffer()->RetrieveAll();
+  conn->InputConsumed();
+  EXPECT_FALSE( conn->ReadPaused() );
+  RunFor( &loop, 0.02 );
+  EXPECT_GT( conn->Stats().messagesReceived, 1u );
+
+  conn->ConnectDestroyed();
+  ::close( client );
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "loopback.h"
+#include "network/EventLoop.h"
+#include "network/TcpConnection.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+// 计数, 写阻塞和高水位时间, 以及按流量排序
+TEST( CONNECTION_STATS_TEST, COUNTERS_AND_TOP ) {
+  EventLoop        loop;
+  int              quietClient = -1;
+  int              busyClient  = -1;
+  TcpConnectionPtr quiet;
+  TcpConnectionPtr busy;
+  ASSERT_NO_FATAL_FAILURE( MakeConnection( &loop, "quiet", &quiet, &quietClient ) );
+  ASSERT_NO_FATAL_FAILURE( MakeConnection( &loop, "busy", &busy, &busyClient ) );
+  busy->SetHighWaterMarkCallback( []( const TcpConnectionPtr&, size_t ) {}, 64 * 1024 );
+  quiet->ConnectEstablished();
+  busy->ConnectEstablished();
+  EXPECT_EQ( 2u, loop.Connections()->Size() );
+
+  ASSERT_EQ( 5, ::write( quietClient, "hello", 5 ) );
+  // 对端不读, 写满内核缓冲区后剩余数据进入 outputBuffer 并超过高水位
+  std::string big( 16 * 1024 * 1024, 'x' );
+  busy->Send( big );
+  busy->Send( big );
+  loop.RunAfter( 0.05, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  const ConnectionStats& quietStats = quiet->Stats();
+  EXPECT_EQ( 5u, quietStats.bytesReceived );
+  EXPECT_EQ( 1u, quietStats.messagesReceived );
+  EXPECT_TRUE( quietStats.creationTime.Valid() );
+  EXPECT_TRUE( quietStats.lastReceiveTime.Valid() );
+
+  const ConnectionStats& busyStats = busy->Stats();
+  EXPECT_EQ( 2u, busyStats.messagesSent );
+  EXPECT_EQ( 1u, busyStats.writeStalls );
+  EXPECT_GE( busyStats.writeCalls, 1u );
+  EXPECT_LT( busyStats.bytesSent, 2u * big.size() );
+  EXPECT_TRUE( busyStats.highWaterSince.Valid() );
+  EXPECT_GE( busyStats.HighWaterMarkUs( Unix::Timestamp::Now() ), 40 * 1000 );
+
+  loop.Connections()->SampleTcpInfo();
+  EXPECT_GT( busy->Stats().cwnd, 0u );
+  EXPECT_TRUE( busy->Stats().tcpInfoTime.Valid() );
+
+  std::vector< ConnectionSample > top = loop.Connections()->Top( 1, ConnectionSet::kBytesTotal );
+  ASSERT_EQ( 1u, top.size() );
+  EXPECT_EQ( "busy", top[ 0 ].name );
+  top = loop.Connections()->Top( 10, ConnectionSet::kBytesReceived );
+  ASSERT_EQ( 2u, top.size() );
+  EXPECT_EQ( "quiet", top[ 0 ].name );
+  EXPECT_NE( std::string::npos, ConnectionSet::ToString( top ).find( "bytes_in=5 " ) );
+
+  busy->ConnectDestroyed();
+  EXPECT_EQ( 1u, loop.Connections()->Size() );
+  quiet->ConnectDestroyed();
+  EXPECT_EQ( 0u, loop.Connections()->Size() );
+  ::close( quietClient );
+  ::close( busyClient );
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "network/Connector.h"
+#include "network/EventLoop.h"
+#include "network/NetAddress.h"
+#include "network/SocketOps.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+namespace {
+
+// 监听 127.0.0.1 上内核分配的端口, 从不 accept
+int ListenLoopback( int backlog, uint16_t* port ) {
+  int                fd   = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  struct sockaddr_in addr = {};
+  addr.sin_family         = AF_INET;
+  addr.sin_addr.s_addr    = htonl( INADDR_LOOPBACK );
+  socklen_t len           = sizeof addr;
+  EXPECT_EQ( 0, ::bind( fd, reinterpret_cast< struct sockaddr* >( &addr ), len ) );
+  EXPECT_EQ( 0, ::listen( fd, backlog ) );
+  ::getsockname( fd, reinterpret_cast< struct sockaddr* >( &addr ), &len );
+  *port = ntohs( addr.sin_port );
+  return fd;
+}
+
+// backlog 0 的监听 socket, 全连接队列被占满后内核丢弃新的 SYN, 模拟黑洞
+int BlackHole( uint16_t* port, int* filler ) {
+  int listenfd = ListenLoopback( 0, port );
+  *filler      = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  InetAddress addr( "127.0.0.1", *port );
+  EXPECT_EQ( 0, ::connect( *filler, addr.GetSockAddr(), sizeof( struct sockaddr_in ) ) );
+  return listenfd;
+}
+
+}  // namespace
+
+// 第一个地址丢弃 SYN, 错开间隔后第二个地址胜出, 不必等 SYN 重传
+TEST( CONNECTOR_TEST, BLACKHOLE_FALLBACK ) {
+  uint16_t holePort = 0, goodPort = 0;
+  int      filler   = -1;
+  int      hole     = BlackHole( &holePort, &filler );
+  int      good     = ListenLoopback( 16, &goodPort );
+
+  EventLoop loop;
+  auto      connector = std::make_shared< Connector >( &loop, std::vector< InetAddress >{ InetAddress( "127.0.0.1", holePort ), InetAddress( "127.0.0.1", goodPort ) } );
+  connector->SetAttemptDelay( 0.05 );
+  double          elapsed = -1;
+  Unix::Timestamp start   = Unix::Timestamp::Now();
+  connector->SetNewConnectionCallback( [ & ]( int sockfd ) {
+    elapsed = Unix::TimeDifference( Unix::Timestamp::Now(), start );
+    sockets::Close( sockfd );
+    // 让被放弃的尝试完成清理
+    loop.QueueInLoop( [ &loop ] { loop.Quit(); } );
+  } );
+  connector->Start();
+  loop.RunAfter( 3.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_GE( elapsed, 0.04 );
+  EXPECT_LT( elapsed, 0.5 );
+  EXPECT_EQ( goodPort, connector->ServerAddress().Port() );
+  ::close( good );
+  ::close( hole );
+  ::close( filler );
+}
+
+// 连接被拒绝时立即尝试下一个地址, 不等错开间隔
+TEST( CONNECTOR_TEST, REFUSED_SKIPS_DELAY ) {
+  uint16_t closedPort = 0, goodPort = 0;
+  ::close( ListenLoopback( 1, &closedPort ) );
+  int good = ListenLoopback( 16, &goodPort );
+
+  EventLoop loop;
+  auto      connector = std::make_shared< Connector >( &loop, std::vector< InetAddress >{ InetAddress( "127.0.0.1", closedPort ), InetAddress( "127.0.0.1", goodPort ) } );
+  connector->SetAttemptDelay( 10.0 );
+  bool connected = false;
+  connector->SetNewConnectionCallback( [ & ]( int sockfd ) {
+    connected = true;
+    sockets::Close( sockfd );
+    loop.QueueInLoop( [ &loop ] { loop.Quit(); } );
+  } );
+  connector->Start();
+  loop.RunAfter( 1.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_TRUE( connected );
+  EXPECT_EQ( goodPort, connector->ServerAddress().Port() );
+  connector->Stop();
+  ::close( good );
+}
+
+// 所有地址都在握手中被放弃, Stop 之后不再回调
+TEST( CONNECTOR_TEST, STOP_ABORTS_ATTEMPTS ) {
+  uint16_t port1 = 0, port2 = 0;
+  int      filler1 = -1, filler2 = -1;
+  int      hole1   = BlackHole( &port1, &filler1 );
+  int      hole2   = BlackHole( &port2, &filler2 );
+
+  EventLoop loop;
+  auto      connector = std::make_shared< Connector >( &loop, std::vector< InetAddress >{ InetAddress( "127.0.0.1", port1 ), InetAddress( "127.0.0.1", port2 ) } );
+  connector->SetAttemptDelay( 0.01 );
+  bool connected = false;
+  connector->SetNewConnectionCallback( [ & ]( int ) { connected = true; } );
+  connector->Start();
+  loop.RunAfter( 0.05, [ & ] { connector->Stop(); } );
+  loop.RunAfter( 0.1, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_FALSE( connected );
+  ::close( hole1 );
+  ::close( hole2 );
+  ::close( filler1 );
+  ::close( filler2 );
+}
+
+// 候选地址按族交替, 族内保持顺序
+TEST( CONNECTOR_TEST, INTERLEAVE_FAMILIES ) {
+  EventLoop loop;
+  Connector connector( &loop, { InetAddress( "::1", 1, true ), InetAddress( "::1", 2, true ), InetAddress( "::1", 3, true ), InetAddress( "127.0.0.1", 4 ) } );
+  const std::vector< InetAddress >& addrs = connector.ServerAddresses();
+  ASSERT_EQ( 4u, addrs.size() );
+  EXPECT_EQ( 1, addrs[ 0 ].Port() );
+  EXPECT_EQ( 4, addrs[ 1 ].Port() );
+  EXPECT_EQ( 2, addrs[ 2 ].Port() );
+  EXPECT_EQ( 3, addrs[ 3 ].Port() );
+  EXPECT_EQ( AF_INET, addrs[ 1 ].Family() );
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "loopback.h"
+#include "network/Coroutine.h"
+#include "network/EventLoop.h"
+#include "network/NetAddress.h"
+#include "network/TcpServer.h"
+#include "unix/Thread.h"
+
+// Coroutine.h 只在 C++20 下生效, 见 test/CMakeLists.txt
+#if defined( __cpp_impl_coroutine )
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+namespace {
+
+// 一条消息: 一行头部, 然后是 4 字节的内容, 原样拼起来发回
+CoTask Serve( TcpConnectionPtr conn, int* served, bool* sawClose ) {
+  CoConnection co( conn );
+  while ( auto line = co_await co.ReadUntil( "\r\n" ) ) {
+    auto body = co_await co.Read( 4 );
+    if ( !body ) {
+      break;
+    }
+    ++*served;
+    if ( !co_await co.Write( *line + "|" + *body ) ) {
+      break;
+    }
+  }
+  *sawClose = co.Closed();
+}
+
+// 先发一小段 (立即写完), 再发一大段 (要等对端读走), 记下恢复时 outputBuffer 里剩的字节数
+CoTask WriteSmallThenLarge( TcpConnectionPtr conn, size_t large, size_t* pending, bool* done ) {
+  CoConnection co( conn );
+  if ( !co_await co.Write( "hi" ) ) {
+    co_return;
+  }
+  if ( co_await co.Write( std::string( large, 'x' ) ) ) {
+    *pending = conn->OutputBuffer()->ReadableBytes();
+    *done    = true;
+  }
+}
+
+// 每次只写一小段, 中间停顿让服务端分多次读到
+void SendInPieces( int fd, std::initializer_list< const char* > pieces ) {
+  for ( const char* piece : pieces ) {
+    ::send( fd, piece, strlen( piece ), MSG_NOSIGNAL );
+    thread::SleepUsec( 20 * 1000 );
+  }
+}
+
+}  // namespace
+
+// 一条消息分几次到达, 读协程等到数据齐了才恢复, 不会被当成连接关闭
+TEST( COROUTINE_TEST, MESSAGE_IN_SEVERAL_WRITES ) {
+  EventLoop   loop;
+  TcpServer   server( &loop, InetAddress( 0, true ), "co" );
+  InetAddress addr     = BoundAddress( server );
+  int         served   = 0;
+  bool        sawClose = false;
+  server.SetConnectionCallback( [ & ]( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      Serve( conn, &served, &sawClose );
+    }
+  } );
+  server.Start();
+
+  const std::string expected = "hello|abcdnext|wxyz";
+  std::string       reply;
+  std::thread       client( [ & ] {
+    int fd = ConnectTo( addr );
+    ASSERT_GE( fd, 0 );
+    SendInPieces( fd, { "he", "llo\r", "\n", "ab", "c", "d" } );
+    SendInPieces( fd, { "next\r\nwxyz" } );
+    char buf[ 64 ];
+    while ( reply.size() < expected.size() ) {
+      ssize_t n = ::recv( fd, buf, sizeof buf, 0 );
+      if ( n <= 0 ) {
+        break;
+      }
+      reply.append( buf, static_cast< size_t >( n ) );
+    }
+    // 关闭时消息只到了一半, 读协程拿到 nullopt
+    SendInPieces( fd, { "half\r\nab" } );
+    ::close( fd );
+    loop.RunAfter( 0.1, [ &loop ] { loop.Quit(); } );
+  } );
+  loop.RunAfter( 5.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+  client.join();
+
+  EXPECT_EQ( expected, reply );
+  EXPECT_EQ( 2, served );
+  EXPECT_TRUE( sawClose );
+}
+
+// 第一次 Write 留下的 writeComplete 不能让第二次 Write 在数据写进内核之前返回
+TEST( COROUTINE_TEST, SMALL_THEN_LARGE_WRITE ) {
+  constexpr size_t kLarge = 8 * 1024 * 1024;
+  EventLoop        loop;
+  TcpServer        server( &loop, InetAddress( 0, true ), "co" );
+  InetAddress      addr    = BoundAddress( server );
+  size_t           pending = 1;
+  bool             done    = false;
+  server.SetConnectionCallback( [ & ]( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      WriteSmallThenLarge( conn, kLarge, &pending, &done );
+    }
+  } );
+  server.Start();
+
+  size_t      received = 0;
+  std::thread client( [ & ] {
+    int fd = ConnectTo( addr );
+    ASSERT_GE( fd, 0 );
+    // 先不读, 让大段数据积压在服务端的 outputBuffer 里
+    thread::SleepUsec( 100 * 1000 );
+    char buf[ 64 * 1024 ];
+    while ( received < kLarge + 2 ) {
+      ssize_t n = ::recv( fd, buf, sizeof buf, 0 );
+      if ( n <= 0 ) {
+        break;
+      }
+      received += static_cast< size_t >( n );
+    }
+    ::close( fd );
+    loop.RunAfter( 0.05, [ &loop ] { loop.Quit(); } );
+  } );
+  loop.RunAfter( 5.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+  client.join();
+
+  EXPECT_EQ( kLarge + 2, received );
+  EXPECT_TRUE( done );
+  EXPECT_EQ( 0u, pending );
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loopback.h"
+#include "network/EventLoop.h"
+#include "network/LoopThread.h"
+#include "network/TcpConnection.h"
+#include "unix/Thread.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+// 多个线程并发发送, 每个线程内的顺序不变, 发送被合并成较少的 writev
+TEST( CROSS_THREAD_SEND_TEST, ORDER_AND_BATCHING ) {
+  constexpr int    kThreads  = 4;
+  constexpr int    kMessages = 20000;
+  EventLoopThread  loopThread( nullptr, "send" );
+  EventLoop*       loop   = loopThread.StartLoop();
+  int              client = -1;
+  TcpConnectionPtr conn;
+  {
+    thread::CountDownLatch latch( 1 );
+    loop->RunInLoop( [ & ] {
+      // 失败时 conn 为空, 也要放行等待的主线程
+      MakeConnection( loop, "send", &conn, &client );
+      if ( conn ) {
+        conn->ConnectEstablished();
+      }
+      latch.CountDown();
+    } );
+    latch.Wait();
+  }
+  ASSERT_TRUE( conn );
+
+  std::vector< std::thread > producers;
+  for ( int t = 0; t < kThreads; ++t ) {
+    producers.emplace_back( [ t, &conn ] {
+      for ( int i = 0; i < kMessages; ++i ) {
+        conn->Send( std::to_string( t ) + ":" + std::to_string( i ) + "\n" );
+      }
+    } );
+  }
+
+  std::vector< int > next( kThreads, 0 );
+  std::string        pending;
+  int                received = 0;
+  char               buf[ 64 * 1024 ];
+  while ( received < kThreads * kMessages ) {
+    ssize_t n = ::read( client, buf, sizeof buf );
+    ASSERT_GT( n, 0 );
+    pending.append( buf, static_cast< size_t >( n ) );
+    size_t start = 0;
+    size_t end;
+    while ( ( end = pending.find( '\n', start ) ) != std::string::npos ) {
+      size_t colon = pending.find( ':', start );
+      int    t     = std::stoi( pending.substr( start, colon - start ) );
+      int    i     = std::stoi( pending.substr( colon + 1, end - colon - 1 ) );
+      ASSERT_EQ( next[ t ], i );
+      ++next[ t ];
+      ++received;
+      start = end + 1;
+    }
+    pending.erase( 0, start );
+  }
+  for ( auto& producer : producers ) {
+    producer.join();
+  }
+
+  thread::CountDownLatch latch( 1 );
+  loop->RunInLoop( [ & ] {
+    EXPECT_EQ( static_cast< uint64_t >( kThreads * kMessages ), conn->Stats().messagesSent );
+    EXPECT_LT( conn->Stats().writeCalls, conn->Stats().messagesSent );
+    conn->ConnectDestroyed();
+    latch.CountDown();
+  } );
+  latch.Wait();
+  ::close( client );
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "loopback.h"
+#include "network/EventLoop.h"
+#include "network/TcpConnection.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+namespace {
+
+void MakeDeferred( EventLoop* loop, TcpConnectionPtr* conn, int* client ) {
+  ASSERT_NO_FATAL_FAILURE( MakeConnection( loop, "deferred", conn, client, SOCK_NONBLOCK ) );
+  ( *conn )->SetDeferredFlush( true );
+}
+
+std::string ReadAll( int fd ) {
+  std::string result;
+  char        buf[ 4096 ];
+  ssize_t     n;
+  while ( ( n = ::read( fd, buf, sizeof buf ) ) > 0 ) {
+    result.append( buf, static_cast< size_t >( n ) );
+  }
+  return result;
+}
+
+void RunFor( EventLoop* loop, double seconds ) {
+  loop->RunAfter( seconds, [ loop ] { loop->Quit(); } );
+  loop->Loop();
+}
+
+}  // namespace
+
+// 一个回调中的多次 Send 合并成一次 write
+TEST( DEFERRED_FLUSH_TEST, COALESCE_SENDS ) {
+  EventLoop        loop;
+  int              client = -1;
+  TcpConnectionPtr conn;
+  ASSERT_NO_FATAL_FAILURE( MakeDeferred( &loop, &conn, &client ) );
+  conn->SetMessageCallback( []( const TcpConnectionPtr& c, file::Buffer* buf, Unix::Timestamp ) {
+    buf->RetrieveAll();
+    c->Send( "header;" );
+    c->Send( "body;" );
+    c->Send( "trailer\n" );
+    EXPECT_EQ( 0u, c->Stats().writeCalls );
+  } );
+  conn->ConnectEstablished();
+
+  ASSERT_EQ( 1, ::write( client, "q", 1 ) );
+  RunFor( &loop, 0.02 );
+  EXPECT_EQ( "header;body;trailer\n", ReadAll( client ) );
+  EXPECT_EQ( 3u, conn->Stats().messagesSent );
+  EXPECT_EQ( 1u, conn->Stats().writeCalls );
+  EXPECT_EQ( 0u, conn->OutputBuffer()->ReadableBytes() );
+
+  conn->ConnectDestroyed();
+  ::close( client );
+}
+
+// Shutdown 等延迟的数据写完后才关闭写端
+TEST( DEFERRED_FLUSH_TEST, SHUTDOWN_AFTER_FLUSH ) {
+  EventLoop        loop;
+  int              client = -1;
+  TcpConnectionPtr conn;
+  ASSERT_NO_FATAL_FAILURE( MakeDeferred( &loop, &conn, &client ) );
+  conn->ConnectEstablished();
+  loop.RunInLoop( [ &conn ] {
+    conn->Send( "last words" );
+    conn->Shutdown();
+  } );
+  RunFor( &loop, 0.02 );
+
+  EXPECT_EQ( "last words", ReadAll( client ) );
+  char c;
+  EXPECT_EQ( 0, ::read( client, &c, 1 ) );
+
+  // 对端关闭后连接走正常的关闭流程
+  bool closed = false;
+  conn->SetCloseCallback( [ &closed ]( const TcpConnectionPtr& ) { closed = true; } );
+  ::close( client );
+  RunFor( &loop, 0.02 );
+  EXPECT_TRUE( closed );
+  conn->ConnectDestroyed();
+}
+
+// 延迟写完成后 writeComplete 立即执行, 不等下一次 poll 超时
+TEST( DEFERRED_FLUSH_TEST, WRITE_COMPLETE_AFTER_FLUSH ) {
+  EventLoop        loop;
+  int              client = -1;
+  TcpConnectionPtr conn;
+  ASSERT_NO_FATAL_FAILURE( MakeDeferred( &loop, &conn, &client ) );
+  Unix::Timestamp received;
+  Unix::Timestamp completed;
+  conn->SetMessageCallback( [ &received ]( const TcpConnectionPtr& c, file::Buffer* buf, Unix::Timestamp when ) {
+    buf->RetrieveAll();
+    received = when;
+    c->Send( "reply" );
+  } );
+  conn->SetWriteCompleteCallback( [ &loop, &completed ]( const TcpConnectionPtr& ) {
+    completed = Unix::Timestamp::Now();
+    loop.Quit();
+  } );
+  conn->ConnectEstablished();
+
+  ASSERT_EQ( 1, ::write( client, "q", 1 ) );
+  // 兜底, 修复前要等 10s 的 poll 超时
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+  ASSERT_TRUE( completed.Valid() );
+  EXPECT_LT( Unix::TimeDifference( completed, received ), 0.1 );
+  EXPECT_EQ( "reply", ReadAll( client ) );
+
+  // iteration end 任务中再注册的任务同样不会被耽搁
+  completed = Unix::Timestamp();
+  loop.RunInLoop( [ &loop, &completed ] {
+    loop.RunAtIterationEnd( [ &loop, &completed ] {
+      loop.RunAtIterationEnd( [ &loop, &completed ] {
+        completed = Unix::Timestamp::Now();
+        loop.Quit();
+      } );
+    } );
+  } );
+  Unix::Timestamp start = Unix::Timestamp::Now();
+  loop.Loop();
+  ASSERT_TRUE( completed.Valid() );
+  EXPECT_LT( Unix::TimeDifference( completed, start ), 0.1 );
+
+  conn->ConnectDestroyed();
+  ::close( client );
+}
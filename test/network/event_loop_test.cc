@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include "loopback.h"
+#include "network/EventLoop.h"
+#include "network/LoopThread.h"
+#include "network/TcpConnection.h"
+#include "unix/Thread.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+// 自旋预算足够长时, 其他线程投递的任务都在自旋期间被发现
+TEST( EVENT_LOOP_TEST, BUSY_POLL_SPIN_HITS ) {
+  EventLoopThread thread( []( EventLoop* loop ) { loop->SetBusyPoll( 200 * 1000 ); }, "busy" );
+  EventLoop*      loop = thread.StartLoop();
+  for ( int i = 0; i < 20; ++i ) {
+    thread::CountDownLatch latch( 1 );
+    loop->RunInLoop( [ &latch ] { latch.CountDown(); } );
+    latch.Wait();
+  }
+  EXPECT_EQ( 200 * 1000, loop->BusyPollUs() );
+  EXPECT_GE( loop->SpinHits(), 20u );
+}
+
+// 没有事件时自旋预算用完, 转为阻塞等待
+TEST( EVENT_LOOP_TEST, BUSY_POLL_FALLS_BACK_TO_BLOCKING ) {
+  EventLoopThread thread( []( EventLoop* loop ) { loop->SetBusyPoll( 100 ); }, "busy" );
+  EventLoop*      loop = thread.StartLoop();
+  thread::SleepUsec( 50 * 1000 );
+  thread::CountDownLatch latch( 1 );
+  loop->RunInLoop( [ &latch ] { latch.CountDown(); } );
+  latch.Wait();
+  EXPECT_GE( loop->SpinMisses(), 1u );
+}
+
+// 定时器, 跨线程任务和 poll 的统计都能从其他线程读到
+TEST( EVENT_LOOP_TEST, STATS ) {
+  EventLoopThread        thread( nullptr, "stats" );
+  EventLoop*             loop = thread.StartLoop();
+  thread::CountDownLatch timerLatch( 1 );
+  loop->RunAfter( 0.01, [ &timerLatch ] { timerLatch.CountDown(); } );
+  timerLatch.Wait();
+  for ( int i = 0; i < 10; ++i ) {
+    thread::CountDownLatch latch( 1 );
+    loop->QueueInLoop( [ &latch ] { latch.CountDown(); } );
+    latch.Wait();
+  }
+  // 再走一轮, 保证上面的统计都已经写完
+  thread::CountDownLatch latch( 1 );
+  loop->QueueInLoop( [ &latch ] { latch.CountDown(); } );
+  latch.Wait();
+  thread::SleepUsec( 10 * 1000 );
+
+  const LoopStats& stats = loop->Stats();
+  EXPECT_GE( stats.eventsPerPoll.Count(), 11u );
+  EXPECT_EQ( stats.eventsPerPoll.Count(), stats.pollWaitUs.Count() );
+  EXPECT_GE( stats.pendingFunctorsDepth.Count(), 10u );
+  EXPECT_EQ( 1u, stats.timerLatenessUs.Count() );
+  // 第一次等待包含定时器的 10ms
+  EXPECT_GE( stats.pollWaitUs.Max(), 5000u );
+
+  std::string text = loop->StatsString();
+  EXPECT_NE( std::string::npos, text.find( "poll_wait_us count=" ) );
+  EXPECT_NE( std::string::npos, text.find( "timer_lateness_us count=1 " ) );
+  EXPECT_NE( std::string::npos, text.find( "slowest_callback" ) );
+
+  loop->ResetStats();
+  thread::SleepUsec( 10 * 1000 );
+  EXPECT_EQ( 0u, stats.timerLatenessUs.Count() );
+}
+
+// 同一次到期的定时器, 后执行的那个要算上前面回调占用的时间
+TEST( EVENT_LOOP_TEST, TIMER_LATENESS_PER_TIMER ) {
+  EventLoop       loop;
+  Unix::Timestamp when = Unix::AddTime( Unix::Timestamp::Now(), 0.01 );
+  // 同一时刻的定时器执行顺序不确定, 两个都睡 20ms
+  for ( int i = 0; i < 2; ++i ) {
+    loop.RunAt( when, [] { thread::SleepUsec( 20 * 1000 ); } );
+  }
+  loop.RunAt( Unix::AddTime( when, 0.05 ), [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_EQ( 3u, loop.Stats().timerLatenessUs.Count() );
+  EXPECT_GE( loop.Stats().timerLatenessUs.Max(), 15000u );
+}
+
+// 连接的引用由 loop 持有, 没有走到 ConnectDestroyed 的连接在 loop 析构时释放
+TEST( EVENT_LOOP_TEST, RELEASE_CONNECTIONS ) {
+  std::weak_ptr< TcpConnection > weak;
+  int                            client = -1;
+  bool                           closed = false;
+  {
+    EventLoop        loop;
+    TcpConnectionPtr conn;
+    ASSERT_NO_FATAL_FAILURE( MakeConnection( &loop, "leak", &conn, &client ) );
+    conn->SetConnectionCallback( [ &closed ]( const TcpConnectionPtr& c ) { closed = !c->Connected(); } );
+    conn->ConnectEstablished();
+    EXPECT_EQ( 1u, loop.Connections()->Size() );
+    weak = conn;
+    conn.reset();
+    EXPECT_FALSE( weak.expired() );
+  }
+  EXPECT_TRUE( weak.expired() );
+  // 析构时不再调用用户回调
+  EXPECT_FALSE( closed );
+  char c;
+  EXPECT_EQ( 0, ::read( client, &c, 1 ) );
+  ::close( client );
+}
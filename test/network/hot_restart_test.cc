@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loopback.h"
+#include "network/EventLoop.h"
+#include "network/HotRestart.h"
+#include "network/LoopThread.h"
+#include "network/NetAddress.h"
+#include "network/SocketOps.h"
+#include "network/TcpConnection.h"
+#include "network/TcpServer.h"
+#include "network/UnixAddress.h"
+#include "unix/Thread.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+namespace {
+
+void RunSync( EventLoop* loop, const std::function< void() >& func ) {
+  thread::CountDownLatch latch( 1 );
+  loop->RunInLoop( [ &func, &latch ] {
+    func();
+    latch.CountDown();
+  } );
+  latch.Wait();
+}
+
+// 每收到一个字节回复一个 tag, 用来区分是哪个"进程"在处理
+MessageCallback Reply( char tag ) {
+  return [ tag ]( const TcpConnectionPtr& conn, file::Buffer* buf, Unix::Timestamp ) {
+    conn->Send( std::string( buf->ReadableBytes(), tag ) );
+    buf->RetrieveAll();
+  };
+}
+
+char Exchange( int fd ) {
+  char c = 0;
+  if ( ::send( fd, "x", 1, MSG_NOSIGNAL ) != 1 || ::recv( fd, &c, 1, 0 ) != 1 ) {
+    return 0;
+  }
+  return c;
+}
+
+}  // namespace
+
+// 持续建立短连接的同时完成一次重启: 没有连接被拒绝或者中断,
+// 空闲的长连接交给新进程继续使用, 旧进程排空后回调
+TEST( HOT_RESTART_TEST, ZERO_REFUSED_UNDER_LOAD ) {
+  InetAddress     addr;
+  UnixAddress     control( "@rnet_hot_restart_" + std::to_string( ::getpid() ) );
+  EventLoopThread oldThread( nullptr, "old" );
+  EventLoopThread newThread( nullptr, "new" );
+  EventLoop*      oldLoop = oldThread.StartLoop();
+  EventLoop*      newLoop = newThread.StartLoop();
+
+  std::unique_ptr< TcpServer >        oldServer;
+  std::unique_ptr< HotRestartServer > oldRestart;
+  std::atomic< bool >                 drained( false );
+  RunSync( oldLoop, [ & ] {
+    oldServer = std::make_unique< TcpServer >( oldLoop, InetAddress( 0, true ), "echo" );
+    oldServer->SetMessageCallback( Reply( '1' ) );
+    oldServer->Start();
+    addr = BoundAddress( *oldServer );
+    oldRestart = std::make_unique< HotRestartServer >( oldLoop, control );
+    oldRestart->AddServer( oldServer.get() );
+    oldRestart->SetHandOffIdleConnections( true );
+    oldRestart->SetDrainTimeout( 1.0 );
+    oldRestart->SetDrainedCallback( [ &drained ] { drained = true; } );
+    oldRestart->Start();
+  } );
+
+  int idle = ConnectTo( addr );
+  ASSERT_GE( idle, 0 );
+  EXPECT_EQ( '1', Exchange( idle ) );
+
+  std::atomic< bool >        stop( false );
+  std::atomic< int >         refused( 0 ), broken( 0 ), served( 0 );
+  std::vector< std::thread > clients;
+  for ( int i = 0; i < 4; ++i ) {
+    clients.emplace_back( [ & ] {
+      while ( !stop ) {
+        int fd = ConnectTo( addr );
+        if ( fd < 0 ) {
+          ++( errno == ECONNREFUSED ? refused : broken );
+          continue;
+        }
+        ++( Exchange( fd ) != 0 ? served : broken );
+        ::close( fd );
+        // 控制速率, 不要耗尽本地端口
+        std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
+      }
+    } );
+  }
+  std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+
+  std::unique_ptr< TcpServer >        newServer;
+  std::unique_ptr< HotRestartServer > newRestart;
+  size_t                              adopted = 0;
+  RunSync( newLoop, [ & ] {
+    HotRestartClient client( control );
+    ASSERT_TRUE( client.Fetch() );
+    int fd = client.TakeListenFd( "echo" );
+    ASSERT_GE( fd, 0 );
+    newServer = std::make_unique< TcpServer >( newLoop, fd, "echo" );
+    newServer->SetMessageCallback( Reply( '2' ) );
+    newServer->Start();
+    EXPECT_EQ( addr.ToIpPort(), newServer->IpPort() );
+    ASSERT_TRUE( client.Ready() );
+    for ( int conn : client.TakeConnections( "echo" ) ) {
+      newServer->AdoptConnection( conn );
+      ++adopted;
+    }
+    // 旧进程已经释放了控制地址, 新进程接着为下一次重启做准备
+    newRestart = std::make_unique< HotRestartServer >( newLoop, control );
+    newRestart->AddServer( newServer.get() );
+    newRestart->Start();
+  } );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+  stop = true;
+  for ( auto& t : clients ) {
+    t.join();
+  }
+  for ( int i = 0; i < 100 && !drained; ++i ) {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  }
+
+  EXPECT_EQ( 0, refused.load() );
+  EXPECT_EQ( 0, broken.load() );
+  EXPECT_GT( served.load(), 0 );
+  EXPECT_TRUE( drained );
+  EXPECT_GE( adopted, 1u );
+  EXPECT_EQ( '2', Exchange( idle ) );
+  ::close( idle );
+
+  RunSync( oldLoop, [ & ] {
+    EXPECT_EQ( 0u, oldServer->NumConnections() );
+    oldRestart.reset();
+    oldServer.reset();
+  } );
+  // 旧进程的监听 socket 已经关闭, 新进程仍然可以接受连接
+  int after = ConnectTo( addr );
+  ASSERT_GE( after, 0 );
+  EXPECT_EQ( '2', Exchange( after ) );
+  ::close( after );
+  RunSync( newLoop, [ & ] {
+    newRestart.reset();
+    newServer.reset();
+  } );
+}
+
+// 连接没有自己关闭时, 到期后强制关闭
+TEST( HOT_RESTART_TEST, DRAIN_TIMEOUT ) {
+  InetAddress     addr;
+  EventLoopThread loopThread( nullptr, "drain" );
+  EventLoop*      loop = loopThread.StartLoop();
+  std::unique_ptr< TcpServer > server;
+  std::atomic< bool >          drained( false );
+  RunSync( loop, [ & ] {
+    server = std::make_unique< TcpServer >( loop, InetAddress( 0, true ), "echo" );
+    server->SetMessageCallback( Reply( '1' ) );
+    server->Start();
+    addr = BoundAddress( *server );
+  } );
+  int fd = ConnectTo( addr );
+  ASSERT_GE( fd, 0 );
+  EXPECT_EQ( '1', Exchange( fd ) );
+
+  server->Drain( 0.1, [ &drained ] { drained = true; } );
+  for ( int i = 0; i < 100 && !drained; ++i ) {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  }
+  EXPECT_TRUE( drained );
+  char c;
+  EXPECT_EQ( 0, ::recv( fd, &c, 1, 0 ) );
+  ::close( fd );
+  // 停止 accept 之后监听 socket 已经关闭
+  EXPECT_LT( ConnectTo( addr ), 0 );
+  EXPECT_EQ( ECONNREFUSED, errno );
+  RunSync( loop, [ & ] { server.reset(); } );
+}
+
+// 空闲连接多于一条消息能带的 fd 数时分几批发送, 全部交给新进程
+TEST( HOT_RESTART_TEST, HAND_OFF_MANY_IDLE ) {
+  const size_t    kIdle = sockets::kMaxFdsPerMessage + 50;
+  InetAddress     addr;
+  UnixAddress     control( "@rnet_hot_restart_many_" + std::to_string( ::getpid() ) );
+  EventLoopThread oldThread( nullptr, "old" );
+  EventLoopThread newThread( nullptr, "new" );
+  EventLoop*      oldLoop = oldThread.StartLoop();
+  EventLoop*      newLoop = newThread.StartLoop();
+
+  std::unique_ptr< TcpServer >        oldServer;
+  std::unique_ptr< HotRestartServer > oldRestart;
+  std::atomic< bool >                 drained( false );
+  RunSync( oldLoop, [ & ] {
+    oldServer = std::make_unique< TcpServer >( oldLoop, InetAddress( 0, true ), "echo" );
+    oldServer->SetMessageCallback( Reply( '1' ) );
+    oldServer->Start();
+    addr       = BoundAddress( *oldServer );
+    oldRestart = std::make_unique< HotRestartServer >( oldLoop, control );
+    oldRestart->AddServer( oldServer.get() );
+    oldRestart->SetHandOffIdleConnections( true );
+    oldRestart->SetDrainedCallback( [ &drained ] { drained = true; } );
+    oldRestart->Start();
+  } );
+
+  std::vector< int > idle;
+  for ( size_t i = 0; i < kIdle; ++i ) {
+    int fd = ConnectTo( addr );
+    ASSERT_GE( fd, 0 );
+    ASSERT_EQ( '1', Exchange( fd ) );
+    idle.push_back( fd );
+  }
+
+  std::unique_ptr< TcpServer > newServer;
+  size_t                       adopted = 0;
+  RunSync( newLoop, [ & ] {
+    HotRestartClient client( control );
+    ASSERT_TRUE( client.Fetch() );
+    newServer = std::make_unique< TcpServer >( newLoop, client.TakeListenFd( "echo" ), "echo" );
+    newServer->SetMessageCallback( Reply( '2' ) );
+    newServer->Start();
+    ASSERT_TRUE( client.Ready() );
+    for ( int conn : client.TakeConnections( "echo" ) ) {
+      newServer->AdoptConnection( conn );
+      ++adopted;
+    }
+  } );
+  for ( int i = 0; i < 100 && !drained; ++i ) {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  }
+
+  EXPECT_TRUE( drained );
+  EXPECT_EQ( kIdle, adopted );
+  for ( int fd : idle ) {
+    EXPECT_EQ( '2', Exchange( fd ) );
+    ::close( fd );
+  }
+  RunSync( oldLoop, [ & ] {
+    oldRestart.reset();
+    oldServer.reset();
+  } );
+  RunSync( newLoop, [ & ] { newServer.reset(); } );
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+
+#include "network/IdTable.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+TEST( ID_TABLE_TEST, INSERT_FIND_ERASE ) {
+  IdTable< std::shared_ptr< int > > table( 4 );
+  for ( uint64_t id = 1; id <= 100; ++id ) {
+    table.Insert( id, std::make_shared< int >( static_cast< int >( id ) ) );
+  }
+  EXPECT_EQ( 100u, table.Size() );
+  EXPECT_GE( table.Capacity(), 200u );
+  for ( uint64_t id = 1; id <= 100; ++id ) {
+    auto* value = table.Find( id );
+    ASSERT_NE( nullptr, value );
+    EXPECT_EQ( static_cast< int >( id ), **value );
+  }
+  EXPECT_EQ( nullptr, table.Find( 101 ) );
+  EXPECT_EQ( 1u, table.Erase( 50 ) );
+  EXPECT_EQ( 0u, table.Erase( 50 ) );
+  EXPECT_EQ( nullptr, table.Find( 50 ) );
+  EXPECT_EQ( 99u, table.Size() );
+}
+
+// 删除后向后移位, 随机增删和 std::map 的结果保持一致
+TEST( ID_TABLE_TEST, RANDOM_CHURN ) {
+  IdTable< uint64_t >                  table;
+  std::map< uint64_t, uint64_t >       expected;
+  std::mt19937_64                      rng( 42 );
+  std::uniform_int_distribution< int > op( 0, 2 );
+  for ( int i = 0; i < 100000; ++i ) {
+    uint64_t id = rng() % 2048 + 1;
+    if ( op( rng ) == 0 ) {
+      EXPECT_EQ( expected.erase( id ), table.Erase( id ) );
+    }
+    else {
+      table.Insert( id, id * 3 );
+      expected[ id ] = id * 3;
+    }
+  }
+  ASSERT_EQ( expected.size(), table.Size() );
+  size_t visited = 0;
+  table.ForEach( [ & ]( uint64_t id, uint64_t value ) {
+    ++visited;
+    ASSERT_EQ( 1u, expected.count( id ) );
+    EXPECT_EQ( expected[ id ], value );
+  } );
+  EXPECT_EQ( expected.size(), visited );
+  table.Clear();
+  EXPECT_TRUE( table.Empty() );
+  EXPECT_EQ( nullptr, table.Find( expected.begin()->first ) );
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#include "network/EventLoop.h"
+#include "network/LoopThreadPool.h"
+#include "unix/Thread.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+namespace {
+
+// 等所有 io loop 进入 Loop(): 在此之前 Quit 会被 Loop() 开头的 quit_ = false 覆盖,
+// 线程池析构时 join 不返回
+void WaitLoopsRunning( EventLoopThreadPool* pool ) {
+  for ( EventLoop* loop : pool->GetAllLoops() ) {
+    thread::CountDownLatch latch( 1 );
+    loop->RunInLoop( [ &latch ] { latch.CountDown(); } );
+    latch.Wait();
+  }
+}
+
+// 阻塞 loop 直到析构, 期间投递给它的任务都留在队列里
+class BlockLoop {
+public:
+  explicit BlockLoop( EventLoop* loop ) : started_( 1 ), release_( 1 ) {
+    loop->RunInLoop( [ this ] {
+      started_.CountDown();
+      release_.Wait();
+    } );
+    started_.Wait();
+  }
+  ~BlockLoop() {
+    release_.CountDown();
+  }
+
+private:
+  thread::CountDownLatch started_;
+  thread::CountDownLatch release_;
+};
+
+}  // namespace
+
+TEST( LOOP_THREAD_POOL_TEST, ROUND_ROBIN ) {
+  EventLoop           base;
+  EventLoopThreadPool pool( &base, "rr" );
+  pool.SetThreadNum( 3 );
+  pool.Start();
+  WaitLoopsRunning( &pool );
+  std::vector< EventLoop* > loops = pool.GetAllLoops();
+  for ( int i = 0; i < 6; ++i ) {
+    EXPECT_EQ( loops[ static_cast< size_t >( i % 3 ) ], pool.GetNextLoop() );
+  }
+}
+
+// 选连接数最少的 loop, 相同时从上一次选中的下一个开始轮流
+TEST( LOOP_THREAD_POOL_TEST, LEAST_CONNECTIONS ) {
+  EventLoop           base;
+  EventLoopThreadPool pool( &base, "least" );
+  pool.SetThreadNum( 3 );
+  pool.SetStrategy( EventLoopThreadPool::kLeastConnections );
+  pool.Start();
+  WaitLoopsRunning( &pool );
+  std::vector< EventLoop* > loops = pool.GetAllLoops();
+  loops[ 0 ]->AdjustConnections( 2 );
+  loops[ 2 ]->AdjustConnections( 1 );
+  EXPECT_EQ( loops[ 1 ], pool.GetNextLoop() );
+  loops[ 1 ]->AdjustConnections( 3 );
+  EXPECT_EQ( loops[ 2 ], pool.GetNextLoop() );
+  loops[ 2 ]->AdjustConnections( 2 );
+  EXPECT_EQ( loops[ 0 ], pool.GetNextLoop() );
+
+  for ( EventLoop* loop : loops ) {
+    loop->AdjustConnections( -loop->NumConnections() );
+  }
+  std::set< EventLoop* > picked;
+  for ( int i = 0; i < 3; ++i ) {
+    picked.insert( pool.GetNextLoop() );
+  }
+  EXPECT_EQ( 3u, picked.size() );
+}
+
+// 被阻塞的 loop 任务队列变长, 不再被选中
+TEST( LOOP_THREAD_POOL_TEST, LEAST_QUEUE_SIZE ) {
+  EventLoop           base;
+  EventLoopThreadPool pool( &base, "queue" );
+  pool.SetThreadNum( 3 );
+  pool.SetStrategy( EventLoopThreadPool::kLeastQueueSize );
+  pool.Start();
+  WaitLoopsRunning( &pool );
+  std::vector< EventLoop* > loops = pool.GetAllLoops();
+  BlockLoop                 block( loops[ 0 ] );
+  for ( int i = 0; i < 5; ++i ) {
+    loops[ 0 ]->QueueInLoop( [] {} );
+  }
+  EXPECT_EQ( 5u, loops[ 0 ]->QueueSize() );
+  for ( int i = 0; i < 10; ++i ) {
+    EXPECT_NE( loops[ 0 ], pool.GetNextLoop() );
+  }
+}
+
+// 一直没有回到 epoll_wait 的 loop 忙碌占比为 1000, 两个中总是选另一个
+TEST( LOOP_THREAD_POOL_TEST, POWER_OF_TWO_BUSY ) {
+  EventLoop           base;
+  EventLoopThreadPool pool( &base, "p2c" );
+  pool.SetThreadNum( 2 );
+  pool.SetStrategy( EventLoopThreadPool::kPowerOfTwoBusy );
+  pool.Start();
+  WaitLoopsRunning( &pool );
+  std::vector< EventLoop* > loops = pool.GetAllLoops();
+  BlockLoop                 block( loops[ 1 ] );
+  thread::SleepUsec( 150 * 1000 );
+  EXPECT_EQ( 1000, loops[ 1 ]->BusyPermille() );
+  for ( int i = 0; i < 20; ++i ) {
+    EXPECT_EQ( loops[ 0 ], pool.GetNextLoop() );
+  }
+}
+
+TEST( LOOP_THREAD_POOL_TEST, CUSTOM_SELECTOR ) {
+  EventLoop           base;
+  EventLoopThreadPool pool( &base, "custom" );
+  pool.SetThreadNum( 3 );
+  pool.SetStrategy( EventLoopThreadPool::kLeastConnections );
+  pool.SetLoopSelector( []( const std::vector< EventLoop* >& loops ) { return loops.size() - 1; } );
+  pool.Start();
+  WaitLoopsRunning( &pool );
+  std::vector< EventLoop* > loops = pool.GetAllLoops();
+  for ( int i = 0; i < 3; ++i ) {
+    EXPECT_EQ( loops[ 2 ], pool.GetNextLoop() );
+  }
+  // GetLoopForHash 不受策略影响
+  EXPECT_EQ( loops[ 1 ], pool.GetLoopForHash( 4 ) );
+}
@@ -0,0 +1,99 @@
+#pragma once
+// 网络测试共用的辅助函数: 在回环地址上直接建立 tcp 连接, 选择端口, 阻塞地连接服务端
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "network/EventLoop.h"
+#include "network/NetAddress.h"
+#include "network/SocketOps.h"
+#include "network/TcpConnection.h"
+#include "network/TcpServer.h"
+
+namespace rnet::network::test {
+
+// 回环地址上建立一对 tcp 连接, *server 为非阻塞的服务端一侧, *client 为对端.
+// clientFlags 是创建 client 时附加的标志, 例如 SOCK_NONBLOCK.
+// 任何一步失败都是致命错误, 调用处用 ASSERT_NO_FATAL_FAILURE 包住
+inline void LoopbackPair( int* server, int* client, int clientFlags = 0 ) {
+  *server = -1;
+  *client = -1;
+  int listenFd = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  ASSERT_GE( listenFd, 0 ) << "socket: " << strerror( errno );
+  struct sockaddr_in addr {};
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  socklen_t len        = sizeof addr;
+  auto*     sa         = reinterpret_cast< struct sockaddr* >( &addr );
+  ASSERT_EQ( 0, ::bind( listenFd, sa, len ) ) << "bind: " << strerror( errno );
+  ASSERT_EQ( 0, ::listen( listenFd, 4 ) ) << "listen: " << strerror( errno );
+  ASSERT_EQ( 0, ::getsockname( listenFd, sa, &len ) ) << "getsockname: " << strerror( errno );
+
+  *client = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC | clientFlags, 0 );
+  ASSERT_GE( *client, 0 ) << "socket: " << strerror( errno );
+  // 非阻塞的 client 可能返回 EINPROGRESS, 握手由下面的 accept 等待完成
+  int ret = ::connect( *client, sa, len );
+  ASSERT_TRUE( ret == 0 || errno == EINPROGRESS ) << "connect: " << strerror( errno );
+  *server = ::accept4( listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC );
+  ASSERT_GE( *server, 0 ) << "accept4: " << strerror( errno );
+  ::close( listenFd );
+}
+
+// 在 LoopbackPair 的服务端一侧构造连接, 还没有 ConnectEstablished. 在 loop 线程调用
+inline void MakeConnection( EventLoop* loop, const std::string& name, TcpConnectionPtr* conn, int* client, int clientFlags = 0 ) {
+  int server = -1;
+  ASSERT_NO_FATAL_FAILURE( LoopbackPair( &server, client, clientFlags ) );
+  *conn = std::make_shared< TcpConnection >( loop, name, server, InetAddress( 0 ), InetAddress( 0 ) );
+  ( *conn )->SetConnectionCallback( DefaultConnectionCallback );
+  ( *conn )->SetMessageCallback( DefaultMessageCallback );
+}
+
+// 监听 InetAddress( 0, true ) 的服务端实际绑定的地址, 由内核选端口, 并行跑的测试不会冲突
+inline InetAddress BoundAddress( const TcpServer& server ) {
+  return InetAddress( sockets::GetLocalAddr( server.ListenFd() ) );
+}
+
+// kReusePortPerLoop 每个 loop 各自 bind, 不能用 0 端口, 先借内核选一个当前空闲的端口
+inline uint16_t UnusedPort() {
+  int                fd = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  struct sockaddr_in addr {};
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  socklen_t len        = sizeof addr;
+  auto*     sa         = reinterpret_cast< struct sockaddr* >( &addr );
+  uint16_t  port       = 0;
+  if ( fd >= 0 && ::bind( fd, sa, len ) == 0 && ::getsockname( fd, sa, &len ) == 0 ) {
+    port = ntohs( addr.sin_port );
+  }
+  if ( fd >= 0 ) {
+    ::close( fd );
+  }
+  return port;
+}
+
+// 阻塞的客户端, 读超时 2 秒. 连接失败返回 -1, errno 为 connect 的错误
+inline int ConnectTo( const InetAddress& addr ) {
+  int fd = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  if ( fd < 0 ) {
+    return -1;
+  }
+  struct timeval tv = { 2, 0 };
+  ::setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv );
+  if ( ::connect( fd, addr.GetSockAddr(), sizeof( struct sockaddr_in ) ) < 0 ) {
+    int savedErrno = errno;
+    ::close( fd );
+    errno = savedErrno;
+    return -1;
+  }
+  return fd;
+}
+
+}  // namespace rnet::network::test
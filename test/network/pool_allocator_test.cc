@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "network/PoolAllocator.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+namespace {
+struct alignas( kCacheLineSize ) Object {
+  int value;
+  explicit Object( int v ) : value( v ) {}
+};
+}  // namespace
+
+// 同一线程释放后再分配, 拿到的是同一块内存, 且按缓存行对齐
+TEST( POOL_ALLOCATOR_TEST, REUSE_AND_ALIGN ) {
+  auto  first = std::allocate_shared< Object >( PoolAllocator< Object >(), 1 );
+  void* addr  = first.get();
+  EXPECT_EQ( 0u, reinterpret_cast< uintptr_t >( addr ) % kCacheLineSize );
+  first.reset();
+
+  auto second = std::allocate_shared< Object >( PoolAllocator< Object >(), 2 );
+  EXPECT_EQ( addr, second.get() );
+  EXPECT_EQ( 2, second->value );
+}
+
+// 块缓存在释放它的线程: 别的线程释放的块本线程拿不回来, 只有那个线程能复用
+TEST( POOL_ALLOCATOR_TEST, CACHED_BY_RELEASING_THREAD ) {
+  auto  object = std::allocate_shared< Object >( PoolAllocator< Object >(), 1 );
+  void* addr   = object.get();
+  void* reused = nullptr;
+  std::thread( [ &object, &reused ] {
+    object.reset();
+    auto again = std::allocate_shared< Object >( PoolAllocator< Object >(), 2 );
+    reused     = again.get();
+  } ).join();
+  EXPECT_EQ( addr, reused );
+
+  auto other = std::allocate_shared< Object >( PoolAllocator< Object >(), 3 );
+  EXPECT_NE( addr, other.get() );
+}
@@ -0,0 +1,295 @@
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "network/Channel.h"
+#include "network/EventLoop.h"
+#include "network/NetAddress.h"
+#include "network/Resolver.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+namespace {
+
+// 本地的 DNS 桩服务, 在测试的 loop 中应答 A 查询
+class StubDns {
+ public:
+  struct Record {
+    int                        rcode = 0;
+    std::vector< std::string > ips;
+    uint32_t                   ttl        = 60;
+    uint32_t                   soaMinimum = 0;  // 非 0 时在 authority 中带 SOA
+  };
+
+  explicit StubDns( EventLoop* loop ) : fd_( ::socket( AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 ) ), channel_( loop, fd_ ) {
+    struct sockaddr_in addr = {};
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl( INADDR_LOOPBACK );
+    socklen_t len           = sizeof addr;
+    ::bind( fd_, reinterpret_cast< struct sockaddr* >( &addr ), len );
+    ::getsockname( fd_, reinterpret_cast< struct sockaddr* >( &addr ), &len );
+    address_ = InetAddress( addr );
+    channel_.SetReadCallback( [ this ]( Unix::Timestamp ) { HandleRead(); } );
+    channel_.EnableReading();
+  }
+
+  ~StubDns() {
+    channel_.DisableAll();
+    channel_.Remove();
+    ::close( fd_ );
+  }
+
+  const InetAddress& Address() const { return address_; }
+  void               Set( const std::string& name, const Record& record ) { records_[ name ] = record; }
+  // 丢弃接下来的 n 个查询
+  void Drop( int n ) { drop_ = n; }
+  // 应答中的问题改成 AAAA 查询, 名字不变
+  void MismatchQuestionType( bool on ) { mismatch_ = on; }
+  int  Queries() const { return queries_; }
+
+ private:
+  static void Put16( std::string* out, uint32_t value ) {
+    out->push_back( static_cast< char >( value >> 8 & 0xff ) );
+    out->push_back( static_cast< char >( value & 0xff ) );
+  }
+  static void Put32( std::string* out, uint32_t value ) {
+    Put16( out, value >> 16 );
+    Put16( out, value & 0xffff );
+  }
+
+  void HandleRead() {
+    char               buf[ 512 ];
+    struct sockaddr_in peer = {};
+    socklen_t          len  = sizeof peer;
+    ssize_t            n    = ::recvfrom( fd_, buf, sizeof buf, 0, reinterpret_cast< struct sockaddr* >( &peer ), &len );
+    if ( n < 12 ) {
+      return;
+    }
+    ++queries_;
+    if ( drop_ > 0 ) {
+      --drop_;
+      return;
+    }
+    // 解析问题中的名字
+    std::string name;
+    size_t      pos = 12;
+    while ( buf[ pos ] != 0 ) {
+      size_t labelLen = static_cast< size_t >( buf[ pos ] );
+      if ( !name.empty() ) {
+        name += '.';
+      }
+      name.append( buf + pos + 1, labelLen );
+      pos += labelLen + 1;
+    }
+    pos += 5;
+
+    Record record;
+    auto   it = records_.find( name );
+    if ( it == records_.end() ) {
+      record.rcode = 3;
+    }
+    else {
+      record = it->second;
+    }
+    std::string response( buf, pos );
+    if ( mismatch_ ) {
+      response[ pos - 4 ] = 0;
+      response[ pos - 3 ] = 28;
+    }
+    response[ 2 ] = static_cast< char >( 0x81 );
+    response[ 3 ] = static_cast< char >( 0x80 | record.rcode );
+    response[ 6 ] = 0;
+    response[ 7 ] = static_cast< char >( record.ips.size() );
+    response[ 9 ] = record.soaMinimum > 0 ? 1 : 0;
+    for ( const auto& ip : record.ips ) {
+      Put16( &response, 0xc00c );
+      Put16( &response, 1 );
+      Put16( &response, 1 );
+      Put32( &response, record.ttl );
+      Put16( &response, 4 );
+      struct in_addr addr;
+      ::inet_pton( AF_INET, ip.c_str(), &addr );
+      response.append( reinterpret_cast< const char* >( &addr ), 4 );
+    }
+    if ( record.soaMinimum > 0 ) {
+      Put16( &response, 0xc00c );
+      Put16( &response, 6 );
+      Put16( &response, 1 );
+      Put32( &response, 3600 );
+      Put16( &response, 22 );
+      response.append( 2, '\0' );  // mname, rname
+      for ( int i = 0; i < 4; ++i ) {
+        Put32( &response, 1 );
+      }
+      Put32( &response, record.soaMinimum );
+    }
+    ::sendto( fd_, response.data(), response.size(), 0, reinterpret_cast< struct sockaddr* >( &peer ), len );
+  }
+
+  int                             fd_;
+  Channel                         channel_;
+  InetAddress                     address_;
+  std::map< std::string, Record > records_;
+  int                             drop_     = 0;
+  int                             queries_  = 0;
+  bool                            mismatch_ = false;
+};
+
+}  // namespace
+
+// 同名的并发查询合并为一次, 之后命中缓存
+TEST( RESOLVER_TEST, COALESCE_AND_CACHE ) {
+  EventLoop       loop;
+  StubDns         stub( &loop );
+  StubDns::Record record;
+  record.ips = { "10.0.0.1", "10.0.0.2" };
+  stub.Set( "svc.test", record );
+
+  auto     cache = std::make_shared< DnsCache >();
+  Resolver resolver( &loop, stub.Address(), Resolver::Options(), cache );
+  std::vector< std::string > first, second, cached;
+  resolver.Resolve( "svc.test", 80, [ & ]( const std::vector< InetAddress >& addrs ) {
+    for ( const auto& addr : addrs ) {
+      first.push_back( addr.ToIpPort() );
+    }
+  } );
+  resolver.Resolve( "SVC.test.", 81, [ & ]( const std::vector< InetAddress >& addrs ) {
+    for ( const auto& addr : addrs ) {
+      second.push_back( addr.ToIpPort() );
+    }
+    // 回调中再查询, 缓存命中时直接回调
+    resolver.Resolve( "svc.test", 82, [ & ]( const std::vector< InetAddress >& hit ) {
+      for ( const auto& addr : hit ) {
+        cached.push_back( addr.ToIpPort() );
+      }
+    } );
+    loop.Quit();
+  } );
+  EXPECT_EQ( 1u, resolver.PendingQueries() );
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_EQ( 1, stub.Queries() );
+  EXPECT_EQ( ( std::vector< std::string >{ "10.0.0.1:80", "10.0.0.2:80" } ), first );
+  EXPECT_EQ( ( std::vector< std::string >{ "10.0.0.1:81", "10.0.0.2:81" } ), second );
+  EXPECT_EQ( ( std::vector< std::string >{ "10.0.0.1:82", "10.0.0.2:82" } ), cached );
+  EXPECT_EQ( 0u, resolver.PendingQueries() );
+}
+
+// NXDOMAIN 按 SOA 的 MINIMUM 缓存, 再次查询不发包
+TEST( RESOLVER_TEST, NEGATIVE_CACHE ) {
+  EventLoop       loop;
+  StubDns         stub( &loop );
+  StubDns::Record record;
+  record.rcode      = 3;
+  record.soaMinimum = 30;
+  stub.Set( "missing.test", record );
+
+  auto     cache = std::make_shared< DnsCache >();
+  Resolver resolver( &loop, stub.Address(), Resolver::Options(), cache );
+  int      failures = 0;
+  resolver.Resolve( "missing.test", 80, [ & ]( const std::vector< InetAddress >& addrs ) {
+    failures += addrs.empty();
+    loop.Quit();
+  } );
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+  resolver.Resolve( "missing.test", 80, [ & ]( const std::vector< InetAddress >& addrs ) { failures += addrs.empty(); } );
+
+  EXPECT_EQ( 2, failures );
+  EXPECT_EQ( 1, stub.Queries() );
+  std::vector< InetAddress > addrs;
+  EXPECT_EQ( DnsCache::kNegative, cache->Lookup( "missing.test/A", Unix::AddTime( Unix::Timestamp::Now(), 29 ), &addrs ) );
+  EXPECT_EQ( DnsCache::kMiss, cache->Lookup( "missing.test/A", Unix::AddTime( Unix::Timestamp::Now(), 31 ), &addrs ) );
+}
+
+// 丢包时超时重发, 全部超时后失败且不缓存
+TEST( RESOLVER_TEST, RETRY_AND_TIMEOUT ) {
+  EventLoop       loop;
+  StubDns         stub( &loop );
+  StubDns::Record record;
+  record.ips = { "10.0.0.3" };
+  stub.Set( "flaky.test", record );
+  stub.Drop( 1 );
+
+  Resolver::Options options;
+  options.timeout  = 0.05;
+  options.attempts = 2;
+  auto        cache = std::make_shared< DnsCache >();
+  Resolver    resolver( &loop, stub.Address(), options, cache );
+  std::string flaky;
+  resolver.Resolve( "flaky.test", 80, [ & ]( const std::vector< InetAddress >& addrs ) {
+    ASSERT_EQ( 1u, addrs.size() );
+    flaky = addrs[ 0 ].ToIp();
+    stub.Drop( 2 );
+    resolver.Resolve( "lost.test", 80, [ & ]( const std::vector< InetAddress >& lost ) {
+      EXPECT_TRUE( lost.empty() );
+      loop.Quit();
+    } );
+  } );
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_EQ( "10.0.0.3", flaky );
+  EXPECT_EQ( 4, stub.Queries() );
+  EXPECT_EQ( 1u, cache->Size() );
+}
+
+// 问题的类型不同的应答不是这个查询的, 丢弃后按超时处理
+TEST( RESOLVER_TEST, IGNORE_MISMATCHED_QUESTION ) {
+  EventLoop       loop;
+  StubDns         stub( &loop );
+  StubDns::Record record;
+  record.ips = { "10.0.0.4" };
+  stub.Set( "other.test", record );
+  stub.MismatchQuestionType( true );
+
+  Resolver::Options options;
+  options.timeout  = 0.05;
+  options.attempts = 1;
+  Resolver resolver( &loop, stub.Address(), options, std::make_shared< DnsCache >() );
+  bool     done = false;
+  resolver.Resolve( "other.test", 80, [ & ]( const std::vector< InetAddress >& addrs ) {
+    EXPECT_TRUE( addrs.empty() );
+    done = true;
+    loop.Quit();
+  } );
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_TRUE( done );
+  EXPECT_EQ( 1, stub.Queries() );
+}
+
+// 记录按 TTL 过期
+TEST( RESOLVER_TEST, CACHE_TTL ) {
+  DnsCache        cache;
+  Unix::Timestamp now = Unix::Timestamp::Now();
+  cache.Insert( "a.test/A", { InetAddress( "10.0.0.1", 0 ) }, 1.0, now );
+  std::vector< InetAddress > addrs;
+  EXPECT_EQ( DnsCache::kHit, cache.Lookup( "a.test/A", Unix::AddTime( now, 0.5 ), &addrs ) );
+  ASSERT_EQ( 1u, addrs.size() );
+  EXPECT_EQ( "10.0.0.1", addrs[ 0 ].ToIp() );
+  EXPECT_EQ( DnsCache::kMiss, cache.Lookup( "a.test/A", Unix::AddTime( now, 1.5 ), &addrs ) );
+  EXPECT_EQ( 0u, cache.Size() );
+}
+
+// IP 字面量不发查询
+TEST( RESOLVER_TEST, IP_LITERAL ) {
+  EventLoop   loop;
+  StubDns     stub( &loop );
+  Resolver    resolver( &loop, stub.Address() );
+  std::string v4, v6;
+  resolver.Resolve( "127.0.0.1", 8080, [ & ]( const std::vector< InetAddress >& addrs ) { v4 = addrs.at( 0 ).ToIpPort(); } );
+  resolver.Resolve( "::1", 8080, [ & ]( const std::vector< InetAddress >& addrs ) { v6 = addrs.at( 0 ).ToIpPort(); }, AF_INET6 );
+  EXPECT_EQ( "127.0.0.1:8080", v4 );
+  EXPECT_EQ( "[::1]:8080", v6 );
+  EXPECT_EQ( 0u, resolver.PendingQueries() );
+}
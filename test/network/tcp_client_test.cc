@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "loopback.h"
+#include "network/ConnectionPool.h"
+#include "network/EventLoop.h"
+#include "network/NetAddress.h"
+#include "network/TcpClient.h"
+#include "network/TcpConnection.h"
+#include "network/TcpServer.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+namespace {
+
+void Echo( const TcpConnectionPtr& conn, file::Buffer* buf, Unix::Timestamp ) {
+  conn->Send( buf );
+}
+
+}  // namespace
+
+// 连接, 收发, 主动断开
+TEST( TCP_CLIENT_TEST, ECHO ) {
+  EventLoop   loop;
+  TcpServer   server( &loop, InetAddress( 0, true ), "echo" );
+  InetAddress addr = BoundAddress( server );
+  server.SetMessageCallback( Echo );
+  server.Start();
+
+  TcpClient   client( &loop, addr, "client" );
+  std::string received;
+  bool        down = false;
+  client.SetConnectionCallback( [ & ]( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      conn->Send( "hello" );
+    }
+    else {
+      down = true;
+      loop.Quit();
+    }
+  } );
+  client.SetMessageCallback( [ & ]( const TcpConnectionPtr&, file::Buffer* buf, Unix::Timestamp ) {
+    received += buf->RetrieveAllAsString();
+    client.Disconnect();
+  } );
+  client.Connect();
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_EQ( "hello", received );
+  EXPECT_TRUE( down );
+  EXPECT_FALSE( client.Connection() );
+}
+
+// 预热, 按未完成请求数选择, 扩容, 空闲收缩
+TEST( TCP_CLIENT_TEST, CONNECTION_POOL ) {
+  EventLoop   loop;
+  TcpServer   server( &loop, InetAddress( 0, true ), "echo" );
+  InetAddress addr = BoundAddress( server );
+  server.SetMessageCallback( Echo );
+  server.Start();
+
+  ConnectionPool::Options options;
+  options.minSize             = 2;
+  options.maxSize             = 3;
+  options.healthCheckInterval = 0.05;
+  options.idleTimeout         = 0.1;
+  ConnectionPool pool( &loop, addr, "pool", options );
+  int            healthChecks = 0;
+  pool.SetHealthCheck( [ &healthChecks ]( const TcpConnectionPtr& conn ) {
+    ++healthChecks;
+    return conn->Connected();
+  } );
+  pool.Start();
+  EXPECT_EQ( 2u, pool.Size() );
+  EXPECT_FALSE( pool.Acquire() );
+
+  TcpConnectionPtr a, b, c;
+  loop.RunAfter( 0.03, [ & ] {
+    EXPECT_EQ( 2u, pool.ConnectedCount() );
+    a = pool.Acquire();
+    b = pool.Acquire();
+    // 两个连接都有一个未完成的请求, 再取时扩容
+    c = pool.Acquire();
+    EXPECT_EQ( 3u, pool.Size() );
+  } );
+  loop.RunAfter( 0.06, [ & ] {
+    EXPECT_EQ( 3u, pool.ConnectedCount() );
+    pool.Release( a );
+    pool.Release( b );
+    pool.Release( c );
+    EXPECT_EQ( 0, pool.Outstanding( a ) );
+  } );
+  size_t sizeAfterIdle = 0;
+  loop.RunAfter( 0.4, [ & ] {
+    sizeAfterIdle = pool.Size();
+    pool.Stop();
+    EXPECT_EQ( 0u, pool.Size() );
+  } );
+  // 留出时间让断开的连接走完关闭流程
+  loop.RunAfter( 0.45, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  ASSERT_TRUE( a && b && c );
+  EXPECT_NE( a, b );
+  EXPECT_TRUE( c == a || c == b );
+  EXPECT_GT( healthChecks, 0 );
+  EXPECT_EQ( 2u, sizeAfterIdle );
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "loopback.h"
+#include "network/EventLoop.h"
+#include "network/NetAddress.h"
+#include "network/TcpClient.h"
+#include "network/TcpConnection.h"
+#include "network/TcpServer.h"
+
+using namespace rnet;
+using namespace rnet::network;
+using namespace rnet::network::test;
+
+namespace {
+
+void Echo( const TcpConnectionPtr& conn, file::Buffer* buf, Unix::Timestamp ) {
+  conn->Send( buf );
+}
+
+// 阻塞地连接, 发一个字节并等回显
+bool EchoByte( const InetAddress& addr ) {
+  int fd = ConnectTo( addr );
+  if ( fd < 0 ) {
+    return false;
+  }
+  char c  = 0;
+  bool ok = ::send( fd, "x", 1, MSG_NOSIGNAL ) == 1 && ::recv( fd, &c, 1, 0 ) == 1 && c == 'x';
+  ::close( fd );
+  return ok;
+}
+
+}  // namespace
+
+// 批量大小不合法时按 1 处理, 不会一个连接都不 accept 而让 loop 空转
+TEST( TCP_SERVER_TEST, ACCEPT_BATCH_AT_LEAST_ONE ) {
+  EventLoop   loop;
+  TcpServer   server( &loop, InetAddress( 0, true ), "echo" );
+  InetAddress addr = BoundAddress( server );
+  server.SetAcceptBatch( 0 );
+  server.SetMessageCallback( Echo );
+  server.Start();
+
+  TcpClient   client( &loop, addr, "client" );
+  std::string received;
+  client.SetConnectionCallback( [ & ]( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      conn->Send( "hello" );
+    }
+    else {
+      loop.Quit();
+    }
+  } );
+  client.SetMessageCallback( [ & ]( const TcpConnectionPtr&, file::Buffer* buf, Unix::Timestamp ) {
+    received += buf->RetrieveAllAsString();
+    client.Disconnect();
+  } );
+  client.Connect();
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_EQ( "hello", received );
+}
+
+// 每个 io loop 有自己的监听 socket, 连接在 accept 它的 loop 上处理, 不经过 base loop
+TEST( TCP_SERVER_TEST, REUSEPORT_PER_LOOP ) {
+  EventLoop   loop;
+  InetAddress addr( UnusedPort(), true );
+  TcpServer   server( &loop, addr, "echo", TcpServer::kReusePortPerLoop );
+  server.SetThreadNum( 4 );
+  std::mutex                  mutex;
+  std::map< EventLoop*, int > perLoop;
+  server.SetConnectionCallback( [ & ]( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      conn->GetLoop()->AssertInLoopThread();
+      std::lock_guard lock( mutex );
+      ++perLoop[ conn->GetLoop() ];
+    }
+  } );
+  server.SetMessageCallback( Echo );
+  server.Start();
+  // 没有单个的监听 socket 可以交出
+  EXPECT_EQ( -1, server.ListenFd() );
+
+  const int kConnections = 64;
+  for ( int i = 0; i < kConnections; ++i ) {
+    ASSERT_TRUE( EchoByte( addr ) );
+  }
+
+  std::lock_guard lock( mutex );
+  int             total = 0;
+  for ( const auto& [ ioLoop, count ] : perLoop ) {
+    EXPECT_NE( &loop, ioLoop );
+    total += count;
+  }
+  EXPECT_EQ( kConnections, total );
+  // 内核按四元组哈希分配, 64 个连接全落在同一个 loop 上几乎不可能
+  EXPECT_GT( perLoop.size(), 1u );
+}
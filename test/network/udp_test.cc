@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "network/EventLoop.h"
+#include "network/NetAddress.h"
+#include "network/UdpServer.h"
+#include "network/UdpSocket.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+namespace {
+
+int ClientSocket() {
+  int                fd   = ::socket( AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0 );
+  struct sockaddr_in addr = {};
+  addr.sin_family         = AF_INET;
+  addr.sin_addr.s_addr    = htonl( INADDR_LOOPBACK );
+  ::bind( fd, reinterpret_cast< struct sockaddr* >( &addr ), sizeof addr );
+  return fd;
+}
+
+void SendFrom( int fd, const std::string& data, const InetAddress& to ) {
+  ::sendto( fd, data.data(), data.size(), 0, to.GetSockAddr(), sizeof( struct sockaddr_in ) );
+}
+
+}  // namespace
+
+// 积压的数据报一次 recvmmsg 批量收取, 用 sendmmsg 原样回复
+TEST( UDP_TEST, BATCH_ECHO ) {
+  EventLoop loop;
+  UdpSocket server( &loop, InetAddress( "127.0.0.1", 0 ) );
+  size_t    received = 0, largestBatch = 0;
+  server.SetDatagramsCallback( [ & ]( UdpSocket* socket, const Datagram* datagrams, size_t count, Unix::Timestamp ) {
+    std::vector< OutDatagram > replies;
+    for ( size_t i = 0; i < count; ++i ) {
+      replies.push_back( { std::string_view( datagrams[ i ].data, datagrams[ i ].size ), datagrams[ i ].peer } );
+    }
+    EXPECT_EQ( count, socket->SendBatch( replies.data(), replies.size() ) );
+    received += count;
+    largestBatch = std::max( largestBatch, count );
+    if ( received == 100 ) {
+      loop.Quit();
+    }
+  } );
+  server.Start();
+
+  int client = ClientSocket();
+  for ( int i = 0; i < 100; ++i ) {
+    SendFrom( client, "msg" + std::to_string( i ), server.LocalAddress() );
+  }
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_EQ( 100u, received );
+  EXPECT_GT( largestBatch, 1u );
+  EXPECT_LT( server.Stats().recvCalls, 100u );
+  EXPECT_EQ( 100u, server.Stats().datagramsOut );
+
+  char buf[ 64 ];
+  for ( int i = 0; i < 100; ++i ) {
+    ssize_t n = ::recv( client, buf, sizeof buf, MSG_DONTWAIT );
+    ASSERT_GT( n, 0 );
+    EXPECT_EQ( "msg" + std::to_string( i ), std::string( buf, static_cast< size_t >( n ) ) );
+  }
+  ::close( client );
+}
+
+// 分段发送: 有 UDP_SEGMENT 时一次交给内核, 接收端开启 GRO 时按分段大小拆回
+TEST( UDP_TEST, SEGMENTS ) {
+  EventLoop loop;
+  UdpSocket receiver( &loop, InetAddress( "127.0.0.1", 0 ) );
+  UdpSocket sender( &loop, InetAddress( "127.0.0.1", 0 ) );
+  receiver.EnableGro();
+  std::vector< std::string > segments;
+  receiver.SetDatagramsCallback( [ & ]( UdpSocket*, const Datagram* datagrams, size_t count, Unix::Timestamp ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      segments.emplace_back( datagrams[ i ].data, datagrams[ i ].size );
+      EXPECT_EQ( sender.LocalAddress().ToIpPort(), datagrams[ i ].peer.ToIpPort() );
+    }
+    if ( segments.size() == 10 ) {
+      loop.Quit();
+    }
+  } );
+  receiver.Start();
+
+  std::string payload;
+  for ( char c = 'a'; c < 'a' + 10; ++c ) {
+    payload.append( c == 'a' + 9 ? 50 : 100, c );
+  }
+  EXPECT_TRUE( sender.SendSegments( payload, 100, receiver.LocalAddress() ) );
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  ASSERT_EQ( 10u, segments.size() );
+  EXPECT_EQ( std::string( 100, 'a' ), segments[ 0 ] );
+  EXPECT_EQ( std::string( 50, 'j' ), segments[ 9 ] );
+  EXPECT_EQ( 10u, sender.Stats().datagramsOut );
+}
+
+// 多个 io loop 共享一个端口, 不同源端口的数据报分散到各个 loop
+TEST( UDP_TEST, REUSEPORT_SERVER ) {
+  EventLoop           loop;
+  UdpServer           server( &loop, InetAddress( "127.0.0.1", 0 ), "udp" );
+  std::atomic< int >  received( 0 );
+  server.SetThreadNum( 2 );
+  server.SetDatagramsCallback( [ &received ]( UdpSocket*, const Datagram*, size_t count, Unix::Timestamp ) { received += static_cast< int >( count ); } );
+  server.Start();
+  ASSERT_NE( 0, server.ListenAddress().Port() );
+
+  std::vector< int > clients;
+  for ( int i = 0; i < 16; ++i ) {
+    clients.push_back( ClientSocket() );
+    for ( int j = 0; j < 10; ++j ) {
+      SendFrom( clients.back(), "x", server.ListenAddress() );
+    }
+  }
+  loop.RunEvery( 0.01, [ & ] {
+    if ( received == 160 ) {
+      loop.Quit();
+    }
+  } );
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_EQ( 160, received.load() );
+  for ( int fd : clients ) {
+    ::close( fd );
+  }
+}
@@ -0,0 +1,195 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "network/EventLoop.h"
+#include "network/TcpClient.h"
+#include "network/TcpConnection.h"
+#include "network/TcpServer.h"
+#include "network/UnixAddress.h"
+
+using namespace rnet;
+using namespace rnet::network;
+
+namespace {
+
+std::string TestPath( const char* name ) {
+  return "/tmp/rnet_" + std::string( name ) + "_" + std::to_string( ::getpid() ) + ".sock";
+}
+
+void Echo( const TcpConnectionPtr& conn, file::Buffer* buf, Unix::Timestamp ) {
+  conn->Send( buf );
+}
+
+// 连上后发送 hello, 收到回显后断开, 返回收到的内容
+std::string EchoOnce( EventLoop* loop, TcpClient* client ) {
+  std::string received;
+  client->SetConnectionCallback( [ loop ]( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      EXPECT_EQ( AF_UNIX, conn->PeerAddress().Family() );
+      EXPECT_EQ( "unix", conn->PeerAddress().ToIpPort() );
+      conn->Send( "hello" );
+    }
+    else {
+      loop->Quit();
+    }
+  } );
+  client->SetMessageCallback( [ &received, client ]( const TcpConnectionPtr&, file::Buffer* buf, Unix::Timestamp ) {
+    received += buf->RetrieveAllAsString();
+    client->Disconnect();
+  } );
+  client->Connect();
+  loop->RunAfter( 2.0, [ loop ] { loop->Quit(); } );
+  loop->Loop();
+  return received;
+}
+
+}  // namespace
+
+TEST( UNIX_SOCKET_TEST, ADDRESS ) {
+  UnixAddress path( "/tmp/a.sock" );
+  EXPECT_FALSE( path.Abstract() );
+  EXPECT_EQ( "/tmp/a.sock", path.ToString() );
+  UnixAddress abstract( "@rnet" );
+  EXPECT_TRUE( abstract.Abstract() );
+  EXPECT_EQ( "@rnet", abstract.ToString() );
+  EXPECT_LT( abstract.Length(), path.Length() );
+}
+
+// 文件系统路径, 残留的 socket 文件在 bind 前删除
+TEST( UNIX_SOCKET_TEST, STREAM_ECHO ) {
+  std::string path = TestPath( "stream" );
+  {
+    UnixAddress stale( path );
+    int         fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+    ASSERT_EQ( 0, ::bind( fd, stale.GetSockAddr(), stale.Length() ) );
+    ::close( fd );
+  }
+  EventLoop   loop;
+  UnixAddress addr( path );
+  TcpServer   server( &loop, addr, "unix" );
+  server.SetMessageCallback( Echo );
+  server.Start();
+  EXPECT_EQ( path, server.IpPort() );
+
+  TcpClient client( &loop, addr, "client" );
+  EXPECT_EQ( "hello", EchoOnce( &loop, &client ) );
+  ::unlink( path.c_str() );
+}
+
+// 路径上是普通文件或者还有服务在监听时不删除, 直接退出 (日志写到 stdout, 不检查输出)
+TEST( UNIX_SOCKET_TEST, KEEP_PATH_IN_USE ) {
+  std::string path = TestPath( "busy" );
+  int         fd   = ::open( path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0600 );
+  ASSERT_GE( fd, 0 );
+  ::close( fd );
+  EXPECT_DEATH(
+    {
+      EventLoop loop;
+      TcpServer server( &loop, UnixAddress( path ), "unix" );
+    },
+    "" );
+  struct stat st;
+  EXPECT_EQ( 0, ::stat( path.c_str(), &st ) );
+  ::unlink( path.c_str() );
+
+  EventLoop   loop;
+  UnixAddress addr( path );
+  TcpServer   server( &loop, addr, "unix" );
+  server.Start();
+  EXPECT_DEATH( { TcpServer other( &loop, addr, "unix" ); }, "" );
+  EXPECT_EQ( 0, ::stat( path.c_str(), &st ) );
+  ::unlink( path.c_str() );
+}
+
+TEST( UNIX_SOCKET_TEST, SEQPACKET_ECHO ) {
+  EventLoop   loop;
+  UnixAddress addr( "@rnet_seqpacket_" + std::to_string( ::getpid() ) );
+  TcpServer   server( &loop, addr, "unix", SOCK_SEQPACKET );
+  server.SetMessageCallback( Echo );
+  server.Start();
+
+  TcpClient client( &loop, addr, "client", SOCK_SEQPACKET );
+  EXPECT_EQ( "hello", EchoOnce( &loop, &client ) );
+}
+
+// 服务端还没有监听 (路径不存在) 时按退避重试
+TEST( UNIX_SOCKET_TEST, CONNECT_BEFORE_LISTEN ) {
+  std::string path = TestPath( "late" );
+  ::unlink( path.c_str() );
+  EventLoop                    loop;
+  UnixAddress                  addr( path );
+  TcpClient                    client( &loop, addr, "client" );
+  std::unique_ptr< TcpServer > server;
+  loop.RunAfter( 0.1, [ & ] {
+    server = std::make_unique< TcpServer >( &loop, addr, "unix" );
+    server->SetMessageCallback( Echo );
+    server->Start();
+  } );
+  EXPECT_EQ( "hello", EchoOnce( &loop, &client ) );
+  ::unlink( path.c_str() );
+}
+
+// 客户端把管道的写端发给服务端, 服务端通过收到的 fd 写入, 客户端从读端读出
+TEST( UNIX_SOCKET_TEST, FD_PASSING ) {
+  EventLoop   loop;
+  UnixAddress addr( "@rnet_fds_" + std::to_string( ::getpid() ) );
+  TcpServer   server( &loop, addr, "unix" );
+  std::string message;
+  size_t      fdsReceived = 0;
+  server.SetConnectionCallback( []( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      conn->SetFdPassing( true );
+    }
+  } );
+  server.SetMessageCallback( [ & ]( const TcpConnectionPtr& conn, file::Buffer* buf, Unix::Timestamp ) {
+    message += buf->RetrieveAllAsString();
+    std::vector< int > fds = conn->TakeReceivedFds();
+    fdsReceived += fds.size();
+    for ( int fd : fds ) {
+      EXPECT_EQ( 4, ::write( fd, "pipe", 4 ) );
+      ::close( fd );
+    }
+    conn->Send( "done" );
+  } );
+  server.Start();
+
+  int pipefd[ 2 ];
+  ASSERT_EQ( 0, ::pipe( pipefd ) );
+  TcpClient client( &loop, addr, "client" );
+  bool      sent = false;
+  client.SetConnectionCallback( [ & ]( const TcpConnectionPtr& conn ) {
+    if ( conn->Connected() ) {
+      sent = conn->SendWithFds( "fd", &pipefd[ 1 ], 1 );
+      // 对端拿到的是内核复制的一份, 这里可以立即关闭
+      ::close( pipefd[ 1 ] );
+    }
+    else {
+      loop.Quit();
+    }
+  } );
+  client.SetMessageCallback( [ &client ]( const TcpConnectionPtr&, file::Buffer* buf, Unix::Timestamp ) {
+    buf->RetrieveAll();
+    client.Disconnect();
+  } );
+  client.Connect();
+  loop.RunAfter( 2.0, [ &loop ] { loop.Quit(); } );
+  loop.Loop();
+
+  EXPECT_TRUE( sent );
+  EXPECT_EQ( "fd", message );
+  EXPECT_EQ( 1u, fdsReceived );
+  char    buf[ 16 ];
+  ssize_t n = ::read( pipefd[ 0 ], buf, sizeof buf );
+  ASSERT_EQ( 4, n );
+  EXPECT_EQ( "pipe", std::string( buf, 4 ) );
+  // 写端全部关闭, 读到文件结尾
+  EXPECT_EQ( 0, ::read( pipefd[ 0 ], buf, sizeof buf ) );
+  ::close( pipefd[ 0 ] );
+}
@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "unix/CpuSet.h"
+
+using namespace rnet;
+
+TEST(CPU_SET_TEST, PARSE_AND_FORMAT) {
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}),
+            Unix::ParseCpuList("0-3,8,10-11"));
+  EXPECT_EQ((std::vector<int>{1, 2}), Unix::ParseCpuList("2,1,2"));
+  EXPECT_TRUE(Unix::ParseCpuList("3-1").empty());
+  EXPECT_TRUE(Unix::ParseCpuList("a").empty());
+  EXPECT_EQ("0-3,8,10-11", Unix::FormatCpuList({0, 1, 2, 3, 8, 10, 11}));
+}
+
+TEST(CPU_SET_TEST, PIN_THREAD) {
+  std::vector<int> allowed = Unix::AllowedCpus();
+  ASSERT_FALSE(allowed.empty());
+  int cpu = allowed.back();
+  std::thread t([cpu] {
+    ASSERT_TRUE(Unix::SetThreadAffinity({cpu}));
+    EXPECT_EQ(cpu, Unix::CurrentCpu());
+    EXPECT_EQ(std::vector<int>{cpu}, Unix::AllowedCpus());
+    EXPECT_GE(Unix::NumaNodeOfCpu(cpu), 0);
+  });
+  t.join();
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "unix/Histogram.h"
+
+using namespace rnet;
+using namespace rnet::Unix;
+
+TEST( HISTOGRAM_TEST, BUCKET_BOUNDS ) {
+  for ( uint64_t v = 0; v < 100000; v = v * 3 / 2 + 1 ) {
+    int index = Histogram::BucketIndex( v );
+    EXPECT_LE( v, Histogram::BucketUpperBound( index ) );
+    // 上界与值的相对误差不超过 1/8
+    EXPECT_LE( Histogram::BucketUpperBound( index ) - v, v / 8 ) << v;
+    if ( index > 0 ) {
+      EXPECT_GT( v, Histogram::BucketUpperBound( index - 1 ) );
+    }
+  }
+  EXPECT_EQ( Histogram::kNumBuckets - 1, Histogram::BucketIndex( UINT64_MAX ) );
+}
+
+TEST( HISTOGRAM_TEST, PERCENTILES ) {
+  Histogram histogram;
+  EXPECT_EQ( 0u, histogram.Percentile( 0.99 ) );
+  for ( uint64_t v = 1; v <= 1000; ++v ) {
+    histogram.Record( v );
+  }
+  EXPECT_EQ( 1000u, histogram.Count() );
+  EXPECT_EQ( 1000u, histogram.Max() );
+  EXPECT_DOUBLE_EQ( 500.5, histogram.Mean() );
+  EXPECT_NEAR( 500.0, static_cast< double >( histogram.Percentile( 0.5 ) ), 500 / 8 );
+  EXPECT_NEAR( 990.0, static_cast< double >( histogram.Percentile( 0.99 ) ), 990 / 8 );
+  EXPECT_EQ( 1000u, histogram.Percentile( 1.0 ) );
+  EXPECT_EQ( 0u, histogram.ToString( "latency_us" ).find( "latency_us count=1000 " ) );
+
+  histogram.Reset();
+  EXPECT_EQ( 0u, histogram.Count() );
+  EXPECT_EQ( 0u, histogram.Max() );
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "unix/TaskPool.h"
+#include "unix/WorkStealingDeque.h"
+
+using namespace rnet;
+using namespace rnet::thread;
+
+TEST( TASK_POOL_TEST, DEQUE_ORDER ) {
+  WorkStealingDeque< int > deque( 2 );
+  for ( int i = 0; i < 10; ++i ) {
+    deque.Push( i );
+  }
+  int value = -1;
+  ASSERT_TRUE( deque.Steal( &value ) );
+  EXPECT_EQ( 0, value );
+  ASSERT_TRUE( deque.Pop( &value ) );
+  EXPECT_EQ( 9, value );
+  EXPECT_EQ( 8, deque.Size() );
+  while ( deque.Pop( &value ) ) {
+  }
+  EXPECT_FALSE( deque.Steal( &value ) );
+}
+
+// 拥有者一边 push/pop, 多个窃取者同时 steal, 每个元素恰好被取走一次
+TEST( TASK_POOL_TEST, DEQUE_CONCURRENT_STEAL ) {
+  constexpr int                      kItems = 200000;
+  WorkStealingDeque< int >           deque( 16 );
+  std::vector< std::atomic< int > >  taken( kItems );
+  std::atomic< bool >                done{ false };
+  std::vector< std::thread >         thieves;
+  for ( int i = 0; i < 3; ++i ) {
+    thieves.emplace_back( [ & ] {
+      int value = 0;
+      while ( !done.load() || !deque.Empty() ) {
+        if ( deque.Steal( &value ) ) {
+          taken[ static_cast< size_t >( value ) ].fetch_add( 1 );
+        }
+      }
+    } );
+  }
+  int value = 0;
+  for ( int i = 0; i < kItems; ++i ) {
+    deque.Push( i );
+    if ( i % 3 == 0 && deque.Pop( &value ) ) {
+      taken[ static_cast< size_t >( value ) ].fetch_add( 1 );
+    }
+  }
+  while ( deque.Pop( &value ) ) {
+    taken[ static_cast< size_t >( value ) ].fetch_add( 1 );
+  }
+  done = true;
+  for ( auto& t : thieves ) {
+    t.join();
+  }
+  for ( int i = 0; i < kItems; ++i ) {
+    ASSERT_EQ( 1, taken[ static_cast< size_t >( i ) ].load() ) << i;
+  }
+}
+
+namespace {
+// 每个任务再拆成两个子任务, 子任务在工作线程内提交, 走本线程的队列
+void Split( TaskPool* pool, int depth, std::atomic< int >* leaves, CountDownLatch* latch ) {
+  if ( depth == 0 ) {
+    leaves->fetch_add( 1 );
+    latch->CountDown();
+    return;
+  }
+  pool->Submit( [ = ] { Split( pool, depth - 1, leaves, latch ); } );
+  pool->Submit( [ = ] { Split( pool, depth - 1, leaves, latch ); } );
+}
+}  // namespace
+
+TEST( TASK_POOL_TEST, NESTED_TASKS ) {
+  TaskPool pool;
+  pool.Start( 4 );
+  std::atomic< int > leaves{ 0 };
+  CountDownLatch     latch( 1 << 12 );
+  pool.Submit( [ & ] { Split( &pool, 12, &leaves, &latch ); } );
+  latch.Wait();
+  EXPECT_EQ( 1 << 12, leaves.load() );
+  pool.Stop();
+  EXPECT_EQ( 0, pool.Pending() );
+}
+
+TEST( TASK_POOL_TEST, STOP_DRAINS ) {
+  TaskPool           pool;
+  std::atomic< int > count{ 0 };
+  pool.Start( 2 );
+  for ( int i = 0; i < 1000; ++i ) {
+    pool.Submit( [ &count ] { count.fetch_add( 1 ); } );
+  }
+  pool.Stop();
+  EXPECT_EQ( 1000, count.load() );
+  EXPECT_GE( TaskPool::DefaultNumThreads(), 1 );
+}